@@ -0,0 +1,37 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Host client of the Tezos Baking app."""
+
+from tezos_baking_client.client import (
+    BakingClient,
+    CapabilityTag,
+    DeviceError,
+    Feature,
+    PreparedMessage,
+    SnapshotTag,
+)
+from tezos_baking_client.transport import LedgerCommTransport, Transport
+
+__all__ = [
+    "BakingClient",
+    "CapabilityTag",
+    "DeviceError",
+    "Feature",
+    "LedgerCommTransport",
+    "PreparedMessage",
+    "SnapshotTag",
+    "Transport",
+]
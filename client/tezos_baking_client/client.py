@@ -0,0 +1,399 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Module providing the host client of the Tezos Baking app."""
+
+from enum import Enum, IntEnum
+from typing import Callable, Dict, List, Optional, Sequence, Tuple, TypeVar, Union
+
+from tezos_baking_client.transport import Transport
+
+CLA: int = 0x80
+MAX_APDU_SIZE: int = 235
+MAX_BATCH_SIZE: int = 4
+SNAPSHOT_PAGE_SIZE: int = 200
+
+
+class Ins(IntEnum):
+    """Class representing the instructions used by the host client."""
+
+    VERSION                   = 0x00
+    GET_PUBLIC_KEY            = 0x02
+    SIGN                      = 0x04
+    GIT                       = 0x09
+    QUERY_ALL_HWM             = 0x0b
+    QUERY_AUTH_KEY_WITH_CURVE = 0x0d
+    SIGN_BATCH                = 0x10
+    QUERY_SNAPSHOT            = 0x14
+
+
+class P1(IntEnum):
+    """Class representing the packet index."""
+
+    FIRST       = 0x00
+    NEXT        = 0x01
+    WITH_KEY    = 0x02
+    FETCH       = 0x03
+    LAST_MARKER = 0x80
+
+
+class StatusCode(IntEnum):
+    """Class representing the status codes handled by the host client."""
+
+    OK                = 0x9000
+    WRONG_PARAM       = 0x6b00
+    INVALID_INS       = 0x6d00
+    STALE_LEVEL_ROUND = 0x9102  # refused by the HWM, can be dropped
+
+
+class SnapshotTag(IntEnum):
+    """Class representing the tags of the QUERY_SNAPSHOT entries."""
+
+    VERSION        = 0x01
+    GIT            = 0x02
+    MAIN_CHAIN_ID  = 0x03
+    MAIN_HWM       = 0x04
+    TEST_HWM       = 0x05
+    AUTHORIZED_KEY = 0x08
+
+
+class CapabilityTag(IntEnum):
+    """Class representing the tags of the capabilities returned by VERSION."""
+
+    INSTRUCTIONS = 0x01
+    CURVES       = 0x02
+    OPTIONS      = 0x03
+    LIMITS       = 0x04
+
+
+# P1 of VERSION requesting the capabilities
+P1_VERSION_CAPABILITIES = 0x01
+
+# Option of the capabilities for the key and the message in the same SIGN APDU
+CAPABILITY_SIGN_WITH_KEY = 0x01
+
+
+class Feature(Enum):
+    """Class representing the instructions the host client uses when available."""
+
+    SIGN_WITH_KEY  = "sign-with-key"
+    SIGN_BATCH     = "sign-batch"
+    QUERY_SNAPSHOT = "query-snapshot"
+
+
+# Status codes of an older app which does not know an instruction or a P1
+UNSUPPORTED_STATUSES = (StatusCode.INVALID_INS, StatusCode.WRONG_PARAM)
+
+# Instruction, P1, P2 and data of an APDU
+Apdu = Tuple[int, int, int, bytes]
+
+T = TypeVar("T")
+
+
+class DeviceError(Exception):
+    """Class representing an error status code returned by the device."""
+
+    def __init__(self, status: int, data: bytes = b'') -> None:
+        super().__init__(f"Device error 0x{status:04x}")
+        self.status = status
+        self.data = data
+
+
+def _split(data: bytes) -> List[bytes]:
+    """Split data in as many APDUs as needed."""
+    return [data[i:i + MAX_APDU_SIZE]
+            for i in range(0, len(data), MAX_APDU_SIZE)] or [b'']
+
+
+class PreparedMessage:
+    """Class representing a message to sign with the authorized key.
+
+    The APDUs are serialized once, before the message is signed, for
+    the current and for the older apps."""
+
+    message: bytes
+    with_key: List[Apdu]
+    selected: List[Apdu]
+
+    def __init__(self, message: bytes) -> None:
+        self.message = message
+
+        # An empty path selects the authorized key
+        packets = _split(b'\x00' + message)
+        self.with_key = [(Ins.SIGN, P1.WITH_KEY, 0x00, packets[0])] + \
+            [(Ins.SIGN, P1.NEXT, 0x00, packet) for packet in packets[1:]]
+        self.with_key[-1] = self._last(self.with_key[-1])
+
+        self.selected = [(Ins.SIGN, P1.NEXT, 0x00, packet) for packet in _split(message)]
+        self.selected[-1] = self._last(self.selected[-1])
+
+    @staticmethod
+    def _last(apdu: Apdu) -> Apdu:
+        ins, p1, p2, data = apdu
+        return (ins, p1 | P1.LAST_MARKER, p2, data)
+
+
+class BakingClient:
+    """Class representing a client of the Tezos Baking app.
+
+    The client keeps its connection open, and uses the merged key
+    selection, the batches and the snapshots of the app. The
+    capabilities of the app are read before the first request: the
+    instructions it does not advertise are never sent. An older app
+    does not advertise its capabilities, each of these instructions is
+    then tried once: if the app does not know it, the client falls back
+    on the instructions of the older apps for the rest of the
+    connection."""
+
+    capabilities: Optional[Dict[int, bytes]]
+
+    def __init__(self, transport: Transport) -> None:
+        self._transport = transport
+        self._features: Dict[Feature, Optional[bool]] = {feature: None for feature in Feature}
+        self._select_apdu: Optional[Apdu] = None
+        self._negotiated = False
+        self.capabilities = None
+
+    def __enter__(self) -> 'BakingClient':
+        return self
+
+    def __exit__(self, *_) -> None:
+        self.close()
+
+    def close(self) -> None:
+        """Close the connection."""
+        self._transport.close()
+
+    def supports(self, feature: Feature) -> Optional[bool]:
+        """Return if the app supports a feature, None if not tried yet."""
+        return self._features[feature]
+
+    def _exchange(self, ins: int, p1: int = 0x00, p2: int = 0x00, data: bytes = b'') -> bytes:
+        assert len(data) <= MAX_APDU_SIZE, "Apdu too large"
+
+        status, response = self._transport.exchange(CLA, ins, p1, p2, data)
+        if status != StatusCode.OK:
+            raise DeviceError(status, response)
+
+        return response
+
+    def _send(self, apdus: Sequence[Apdu]) -> bytes:
+        response = b''
+        for (ins, p1, p2, data) in apdus:
+            response = self._exchange(ins, p1, p2, data)
+        return response
+
+    def negotiate(self) -> None:
+        """Read the capabilities of the app, in a single exchange.
+
+        The advertised instructions are still tried first, an app can
+        refuse them for a key, such as batches for a BLS12-381 key."""
+
+        self._negotiated = True
+
+        try:
+            data = self._exchange(Ins.VERSION, P1_VERSION_CAPABILITIES)
+        except DeviceError as error:
+            # Older apps refuse any P1
+            if error.status != StatusCode.WRONG_PARAM:
+                raise
+            return
+
+        # Older apps ignore the P1
+        if len(data) <= 4:
+            return
+
+        capabilities: Dict[int, bytes] = {}
+        offset = 5  # version and format version
+        while offset < len(data):
+            tag, size = data[offset], data[offset + 1]
+            capabilities[tag] = data[offset + 2:offset + 2 + size]
+            offset += 2 + size
+        self.capabilities = capabilities
+
+        instructions = int.from_bytes(capabilities.get(CapabilityTag.INSTRUCTIONS, b''), 'big')
+        options = capabilities.get(CapabilityTag.OPTIONS, b'\x00')[0]
+        advertised = {
+            Feature.SIGN_WITH_KEY: (options & CAPABILITY_SIGN_WITH_KEY) != 0,
+            Feature.SIGN_BATCH: ((instructions >> Ins.SIGN_BATCH) & 1) != 0,
+            Feature.QUERY_SNAPSHOT: ((instructions >> Ins.QUERY_SNAPSHOT) & 1) != 0,
+        }
+        for feature, is_advertised in advertised.items():
+            if not is_advertised:
+                self._features[feature] = False
+
+    def _with_fallback(self,
+                       feature: Feature,
+                       run: Callable[[], T],
+                       fallback: Callable[[], T]) -> T:
+        """Run with a feature, or with the fallback if it is not supported.
+
+        A feature is only considered as not supported if the fallback
+        succeeds where it failed, the instructions refused with an
+        unsupported status having no effect."""
+
+        if not self._negotiated:
+            self.negotiate()
+
+        if self._features[feature] is False:
+            return fallback()
+
+        try:
+            result = run()
+        except DeviceError as error:
+            if self._features[feature] or error.status not in UNSUPPORTED_STATUSES:
+                raise
+            result = fallback()
+            self._features[feature] = False
+            return result
+
+        self._features[feature] = True
+        return result
+
+    def version(self) -> Tuple[int, int, int, int]:
+        """Return the app kind, the major, the minor and the patch versions."""
+        data = self._exchange(Ins.VERSION)
+        return (data[0], data[1], data[2], data[3])
+
+    def git(self) -> str:
+        """Return the commit of the app."""
+        return self._exchange(Ins.GIT).rstrip(b'\x00').decode('utf-8')
+
+    def authorized_key(self) -> Tuple[int, bytes]:
+        """Return the curve and the serialized path of the authorized key."""
+        data = self._exchange(Ins.QUERY_AUTH_KEY_WITH_CURVE)
+        return (data[0], data[1:])
+
+    def get_public_key(self, curve: int, path: bytes) -> bytes:
+        """Return the public key of a serialized path, without prompt."""
+        return self._exchange(Ins.GET_PUBLIC_KEY, p2=curve, data=path)
+
+    @staticmethod
+    def prepare(message: bytes) -> PreparedMessage:
+        """Serialize a message in advance, to sign it as soon as needed."""
+        return PreparedMessage(message)
+
+    def _sign_selected(self, prepared: PreparedMessage) -> bytes:
+        if self._select_apdu is None:
+            curve, path = self.authorized_key()
+            self._select_apdu = (Ins.SIGN, P1.FIRST, curve, path)
+        return self._send([self._select_apdu] + prepared.selected)
+
+    def sign(self, message: Union[bytes, PreparedMessage]) -> bytes:
+        """Sign a message with the authorized key.
+
+        The key is selected in the APDU of the message if the app
+        supports it."""
+
+        prepared = message if isinstance(message, PreparedMessage) else PreparedMessage(message)
+
+        return self._with_fallback(Feature.SIGN_WITH_KEY,
+                                   lambda: self._send(prepared.with_key),
+                                   lambda: self._sign_selected(prepared))
+
+    def _sign_batch(self, messages: Sequence[bytes]) -> List[bytes]:
+        # Split the batch on message boundaries
+        packets: List[bytes] = []
+        packet: bytes = b''
+        for message in messages:
+            item = len(message).to_bytes(1, 'big') + message
+            if len(packet) + len(item) > MAX_APDU_SIZE:
+                packets.append(packet)
+                packet = b''
+            packet += item
+        packets.append(packet)
+
+        data: bytes = b''
+        for i, packet in enumerate(packets):
+            p1: int = P1.FIRST if i == 0 else P1.NEXT
+            if i == len(packets) - 1:
+                p1 |= P1.LAST_MARKER
+            data = self._exchange(Ins.SIGN_BATCH, p1, data=packet)
+
+        signatures: List[bytes] = []
+        while True:
+            offset = 0
+            while offset < len(data):
+                size = data[offset]
+                signatures.append(data[offset + 1:offset + 1 + size])
+                offset += 1 + size
+            if len(signatures) >= len(messages):
+                return signatures
+            data = self._exchange(Ins.SIGN_BATCH, P1.FETCH)
+
+    def sign_batch(self, messages: Sequence[bytes]) -> List[bytes]:
+        """Sign baking messages with the authorized key, in order.
+
+        The messages are sent in batches if the app supports it, each
+        batch being refused as a whole. Otherwise they are signed one
+        after the other."""
+
+        signatures: List[bytes] = []
+        for i in range(0, len(messages), MAX_BATCH_SIZE):
+            batch = messages[i:i + MAX_BATCH_SIZE]
+            signatures += self._with_fallback(
+                Feature.SIGN_BATCH,
+                lambda batch=batch: self._sign_batch(batch),
+                lambda batch=batch: [self.sign(message) for message in batch])
+        return signatures
+
+    def _snapshot(self) -> Dict[int, List[bytes]]:
+        raw_data = b''
+        page_index = 0
+        while True:
+            page = self._exchange(Ins.QUERY_SNAPSHOT, page_index)
+            raw_data += page
+            page_index += 1
+            if len(page) < SNAPSHOT_PAGE_SIZE:
+                break
+
+        entries: Dict[int, List[bytes]] = {}
+        offset = 1  # format version
+        while offset < len(raw_data):
+            tag, size = raw_data[offset], raw_data[offset + 1]
+            entries.setdefault(tag, []).append(raw_data[offset + 2:offset + 2 + size])
+            offset += 2 + size
+        return entries
+
+    def _legacy_snapshot(self) -> Dict[int, List[bytes]]:
+        """Build the main entries of a snapshot with the older instructions.
+
+        The HWM flags are unknown and left unset."""
+
+        entries: Dict[int, List[bytes]] = {
+            SnapshotTag.VERSION: [self._exchange(Ins.VERSION)],
+            SnapshotTag.GIT: [self._exchange(Ins.GIT)],
+        }
+
+        data = self._exchange(Ins.QUERY_ALL_HWM)
+        # Older apps do not return the rounds
+        hwm_size = 8 if len(data) == 20 else 4
+        main_hwm = data[:hwm_size].ljust(8, b'\x00') + b'\x00'
+        test_hwm = data[hwm_size:2 * hwm_size].ljust(8, b'\x00') + b'\x00'
+        entries[SnapshotTag.MAIN_HWM] = [main_hwm]
+        entries[SnapshotTag.TEST_HWM] = [test_hwm]
+        entries[SnapshotTag.MAIN_CHAIN_ID] = [data[2 * hwm_size:]]
+
+        curve, path = self.authorized_key()
+        if path[0] != 0:
+            entries[SnapshotTag.AUTHORIZED_KEY] = [bytes([curve]) + path]
+
+        return entries
+
+    def snapshot(self) -> Dict[int, List[bytes]]:
+        """Return the values of the app state, by snapshot tag.
+
+        Older apps only provide the main entries."""
+        return self._with_fallback(Feature.QUERY_SNAPSHOT, self._snapshot, self._legacy_snapshot)
@@ -0,0 +1,57 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Module providing the transports of the host client."""
+
+from typing import Optional, Protocol, Tuple
+
+
+class Transport(Protocol):
+    """Interface of a connection to the device."""
+
+    def exchange(self, cla: int, ins: int, p1: int, p2: int, data: bytes) -> Tuple[int, bytes]:
+        """Send an APDU and return the status word and the response data."""
+
+    def close(self) -> None:
+        """Close the connection."""
+
+
+class LedgerCommTransport:
+    """Persistent connection to a device, or to Speculos, through ledgercomm.
+
+    The connection is opened once and reused by all the exchanges."""
+
+    def __init__(self,
+                 interface: str = "hid",
+                 server: str = "127.0.0.1",
+                 port: int = 9999,
+                 hid_path: Optional[bytes] = None) -> None:
+        # Only required by this transport
+        # pylint: disable=import-outside-toplevel
+        from ledgercomm import Transport as LedgerComm
+
+        self._transport = LedgerComm(interface=interface,
+                                     server=server,
+                                     port=port,
+                                     hid_path=hid_path,
+                                     debug=False)
+
+    def exchange(self, cla: int, ins: int, p1: int, p2: int, data: bytes) -> Tuple[int, bytes]:
+        """Send an APDU and return the status word and the response data."""
+        return self._transport.exchange(cla, ins, p1, p2, None, data)
+
+    def close(self) -> None:
+        """Close the connection."""
+        self._transport.close()
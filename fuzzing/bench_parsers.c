@@ -0,0 +1,271 @@
+/* Tezos Ledger application - Microbenchmark of the parsers
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+/*
+ * Measures the time spent by the parsers per message and per byte on
+ * the messages sent by a baker, outside of the emulator:
+ *
+ *   bench_parsers [--iterations N] [--write-corpus DIR]
+ *
+ * `--write-corpus` writes the messages as seeds of the fuzzers
+ * instead, in `DIR/baking` and `DIR/operations`.
+ */
+
+#include "baking_auth.h"
+#include "globals.h"
+#include "messages.h"
+#include "operations.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define G global.apdu.u.sign.message.maybe_ops
+
+#define DEFAULT_ITERATIONS 100000u
+
+/**
+ * @brief This structure represents a benchmarked message
+ *
+ */
+typedef struct {
+    char const *name;                   ///< name of the benchmark
+    uint8_t data[MAX_APDU_SIZE];        ///< message, magic byte included
+    size_t size;                        ///< size of the message
+    derivation_type_t derivation_type;  ///< curve of the signing key of an operation
+    size_t packet_size;                 ///< size of the packets of an operation
+} bench_message_t;
+
+/**
+ * @brief Parses a message as the signing instruction does
+ *
+ * @param message: message to parse
+ * @return bool: whether the message is valid
+ */
+static bool parse_message(bench_message_t const *const message) {
+    buffer_t buf = {.ptr = message->data, .size = message->size, .offset = 1u};
+    parsed_baking_data_t out = {0};
+
+    switch (message->data[0]) {
+        case MAGIC_BYTE_PREATTESTATION:
+            return parse_consensus_operation(&buf, &out, false);
+        case MAGIC_BYTE_ATTESTATION:
+            return parse_consensus_operation(&buf, &out, true);
+        case MAGIC_BYTE_BLOCK:
+            return parse_block(&buf, &out);
+        case MAGIC_BYTE_UNSAFE_OP:
+            break;
+        default:
+            return false;
+    }
+
+    bip32_path_with_curve_t path_with_curve = {0};
+    path_with_curve.derivation_type = message->derivation_type;
+    path_with_curve.bip32_path.length = 1u;
+    path_with_curve.bip32_path.components[0] = 0x80000000u;
+
+    size_t offset = 1u;
+    tz_exc exc = SW_OK;
+    while ((exc == SW_OK) && (offset < message->size)) {
+        size_t length = message->size - offset;
+        if (length > message->packet_size) {
+            length = message->packet_size;
+        }
+        buffer_t packet = {.ptr = message->data + offset, .size = length, .offset = 0u};
+
+        if (offset == 1u) {
+            exc = parse_operations(&packet, &G.v, &path_with_curve);
+        } else {
+            exc = parse_operations_next(&packet, &G.v);
+        }
+        offset += length;
+    }
+
+    return (exc == SW_OK) && parse_operations_final(&G.parse_state, &G.v);
+}
+
+/**
+ * @brief Gets the current time
+ *
+ * @return double: time in nanoseconds
+ */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e9) + (double) ts.tv_nsec;
+}
+
+/**
+ * @brief Writes a message as a seed of its fuzzer
+ *
+ * @param dir: corpus directory
+ * @param message: message to write
+ * @return bool: whether the seed has been written
+ */
+static bool write_seed(char const *const dir, bench_message_t const *const message) {
+    bool const is_operation = message->data[0] == MAGIC_BYTE_UNSAFE_OP;
+    char path[4096];
+    snprintf(path,
+             sizeof(path),
+             "%s/%s/%s",
+             dir,
+             is_operation ? "operations" : "baking",
+             message->name);
+
+    FILE *const file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    if (is_operation) {
+        // See the input of `fuzz_operations`
+        fputc((int) message->derivation_type, file);
+        fputc((int) (message->packet_size % MAX_APDU_SIZE), file);
+    }
+    bool const written = fwrite(message->data, 1u, message->size, file) == message->size;
+    fclose(file);
+    return written;
+}
+
+/**
+ * @brief Creates a directory if it does not exist
+ *
+ * @param path: path of the directory
+ * @return bool: whether the directory exists
+ */
+static bool make_dir(char const *const path) {
+    if ((mkdir(path, 0755) != 0) && (errno != EEXIST)) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    unsigned long iterations = DEFAULT_ITERATIONS;
+    char const *corpus_dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc)) {
+            iterations = strtoul(argv[++i], NULL, 10);
+        } else if ((strcmp(argv[i], "--write-corpus") == 0) && (i + 1 < argc)) {
+            corpus_dir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--write-corpus DIR]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static bench_message_t messages[] = {
+        {.name = "block"},
+        {.name = "block_locked_round"},
+        {.name = "preattestation"},
+        {.name = "attestation"},
+        {.name = "attestation_dal"},
+        {.name = "reveal_delegation_ed25519",
+         .derivation_type = DERIVATION_TYPE_ED25519,
+         .packet_size = MAX_APDU_SIZE},
+        {.name = "reveal_delegation_secp256k1",
+         .derivation_type = DERIVATION_TYPE_SECP256K1,
+         .packet_size = MAX_APDU_SIZE},
+        {.name = "reveal_delegation_ed25519_packets_32",
+         .derivation_type = DERIVATION_TYPE_ED25519,
+         .packet_size = 32u},
+    };
+    size_t const count = sizeof(messages) / sizeof(messages[0]);
+
+    messages[0].size = harness_build_block(messages[0].data, MAX_APDU_SIZE, 1000u, 0u, false);
+    messages[1].size = harness_build_block(messages[1].data, MAX_APDU_SIZE, 1000u, 2u, true);
+    messages[2].size = harness_build_consensus_operation(messages[2].data,
+                                                         MAX_APDU_SIZE,
+                                                         BAKING_TYPE_PREATTESTATION,
+                                                         1000u,
+                                                         0u,
+                                                         false);
+    messages[3].size = harness_build_consensus_operation(messages[3].data,
+                                                         MAX_APDU_SIZE,
+                                                         BAKING_TYPE_ATTESTATION,
+                                                         1000u,
+                                                         0u,
+                                                         false);
+    messages[4].size = harness_build_consensus_operation(messages[4].data,
+                                                         MAX_APDU_SIZE,
+                                                         BAKING_TYPE_ATTESTATION,
+                                                         1000u,
+                                                         0u,
+                                                         true);
+    for (size_t i = 5u; i < count; i++) {
+        messages[i].size = harness_build_reveal_delegation(messages[i].data,
+                                                           MAX_APDU_SIZE,
+                                                           messages[i].derivation_type);
+    }
+
+    if (corpus_dir != NULL) {
+        char path[4096];
+        if (!make_dir(corpus_dir)) {
+            return 1;
+        }
+        snprintf(path, sizeof(path), "%s/baking", corpus_dir);
+        if (!make_dir(path)) {
+            return 1;
+        }
+        snprintf(path, sizeof(path), "%s/operations", corpus_dir);
+        if (!make_dir(path)) {
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!write_seed(corpus_dir, &messages[i])) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    int rc = 0;
+    printf("%-40s %12s %10s %12s\n", "Benchmark", "ns/message", "ns/byte", "Iterations");
+    for (size_t i = 0; i < count; i++) {
+        bench_message_t const *const message = &messages[i];
+
+        if ((message->size == 0u) || !parse_message(message)) {
+            fprintf(stderr, "%s: the message is refused by the parser\n", message->name);
+            rc = 1;
+            continue;
+        }
+
+        double const start = now_ns();
+        for (unsigned long j = 0; j < iterations; j++) {
+            if (!parse_message(message)) {
+                rc = 1;
+            }
+        }
+        double const elapsed = (iterations != 0u) ? (now_ns() - start) / (double) iterations : 0.0;
+
+        printf("%-40s %12.1f %10.2f %12lu\n",
+               message->name,
+               elapsed,
+               elapsed / (double) message->size,
+               iterations);
+    }
+
+    return rc;
+}
@@ -0,0 +1,63 @@
+/* Tezos Ledger application - Fuzzer of the baking message parsers
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+#include "baking_auth.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size);
+
+/**
+ * Data:
+ *   + (1 byte) uint8: magic byte
+ *   + (max-size) uint8 *: block or consensus operation
+ */
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size) {
+    buffer_t buf = {.ptr = data, .size = size, .offset = 0u};
+    parsed_baking_data_t out = {0};
+    magic_byte_t magic_byte = 0u;
+    bool parsed = false;
+
+    if (!buffer_read_u8(&buf, &magic_byte)) {
+        return 0;
+    }
+
+    switch (magic_byte) {
+        case MAGIC_BYTE_PREATTESTATION:
+            parsed = parse_consensus_operation(&buf, &out, false);
+            break;
+        case MAGIC_BYTE_ATTESTATION:
+            parsed = parse_consensus_operation(&buf, &out, true);
+            break;
+        case MAGIC_BYTE_BLOCK:
+            parsed = parse_block(&buf, &out);
+            break;
+        default:
+            return 0;
+    }
+
+    // A parsed message never extends past the input
+    if (parsed && (buf.offset > buf.size)) {
+        __builtin_trap();
+    }
+
+    return 0;
+}
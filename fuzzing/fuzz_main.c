@@ -0,0 +1,111 @@
+/* Tezos Ledger application - Standalone driver of the fuzzers
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+/*
+ * Replays inputs through a fuzzer when libFuzzer is not available:
+ * each argument is an input file or a directory of input files.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size);
+
+/**
+ * @brief Replays an input file
+ *
+ * @param path: path of the file
+ * @return int: 0 on success, 1 if the file cannot be read
+ */
+static int run_file(char const *const path) {
+    FILE *const file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    uint8_t *data = NULL;
+    size_t size = 0u;
+    uint8_t chunk[4096];
+    size_t read = 0u;
+    while ((read = fread(chunk, 1u, sizeof(chunk), file)) != 0u) {
+        uint8_t *const grown = realloc(data, size + read);
+        if (grown == NULL) {
+            free(data);
+            fclose(file);
+            return 1;
+        }
+        data = grown;
+        memcpy(data + size, chunk, read);
+        size += read;
+    }
+    fclose(file);
+
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+
+/**
+ * @brief Replays an input file or the input files of a directory
+ *
+ * @param path: path of the file or of the directory
+ * @return int: 0 on success, 1 if an input cannot be read
+ */
+static int run_path(char const *const path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return run_file(path);
+    }
+
+    DIR *const dir = opendir(path);
+    if (dir == NULL) {
+        perror(path);
+        return 1;
+    }
+    int rc = 0;
+    struct dirent const *entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        rc |= run_path(child);
+    }
+    closedir(dir);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    int rc = 0;
+    for (int i = 1; i < argc; i++) {
+        rc |= run_path(argv[i]);
+    }
+    return rc;
+}
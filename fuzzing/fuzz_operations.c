@@ -0,0 +1,90 @@
+/* Tezos Ledger application - Fuzzer of the operation parser
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+#include "globals.h"
+#include "operations.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define G global.apdu.u.sign.message.maybe_ops
+
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size);
+
+/**
+ * Data:
+ *   + (1 byte) uint8: curve of the signing key
+ *   + (1 byte) uint8: size of the packets, 0 for the maximum size
+ *   + (max-size) uint8 *: operation group, magic byte included
+ *
+ * The group is parsed in packets, as the signing instruction does.
+ */
+int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size) {
+    if (size < 3u) {
+        return 0;
+    }
+
+    bip32_path_with_curve_t path_with_curve = {0};
+    path_with_curve.derivation_type = (derivation_type_t) data[0];
+    path_with_curve.bip32_path.length = 1u;
+    path_with_curve.bip32_path.components[0] = 0x80000000u;
+
+    size_t const packet_size = (data[1] == 0u) ? MAX_APDU_SIZE : data[1];
+
+    if (data[2] != MAGIC_BYTE_UNSAFE_OP) {
+        return 0;
+    }
+
+    uint8_t const *packet = data + 3u;
+    size_t remaining = size - 3u;
+    bool first = true;
+    tz_exc exc = SW_OK;
+
+    do {
+        size_t const length = (remaining < packet_size) ? remaining : packet_size;
+        buffer_t buf = {.ptr = packet, .size = length, .offset = 0u};
+
+        if (first) {
+            exc = parse_operations(&buf, &G.v, &path_with_curve);
+            first = false;
+        } else {
+            exc = parse_operations_next(&buf, &G.v);
+        }
+
+        packet += length;
+        remaining -= length;
+    } while ((exc == SW_OK) && (remaining != 0u));
+
+    if (exc == SW_OK) {
+        G.is_valid = parse_operations_final(&G.parse_state, &G.v);
+    }
+
+    // A valid group holds a reveal or a single delegation
+    if (G.is_valid) {
+        if ((G.v.operation.tag != OPERATION_TAG_DELEGATION) &&
+            ((G.v.operation.tag != OPERATION_TAG_NONE) || !G.v.has_reveal)) {
+            __builtin_trap();
+        }
+    }
+
+    memset(&G, 0, sizeof(G));
+    return 0;
+}
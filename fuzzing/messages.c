@@ -0,0 +1,227 @@
+/* Tezos Ledger application - Host harness messages
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+#include "messages.h"
+
+#include <string.h>
+
+/// Raw signature types of the Tezos encoding
+#define RAW_SIGNATURE_TYPE_ED25519   0u
+#define RAW_SIGNATURE_TYPE_SECP256K1 1u
+#define RAW_SIGNATURE_TYPE_SECP256R1 2u
+
+#define BLOCK_FITNESS_TAG        2u
+#define BLOCK_PROTOCOL_DATA_SIZE 110u  // payload hash and round, nonces, votes and signature
+
+#define CONSENSUS_TAG_PREATTESTATION       20u
+#define CONSENSUS_TAG_ATTESTATION          21u
+#define CONSENSUS_TAG_ATTESTATION_WITH_DAL 23u
+
+/**
+ * @brief This structure represents a bounded output buffer
+ *
+ */
+typedef struct {
+    uint8_t *out;  ///< output buffer
+    size_t size;   ///< output buffer size
+    size_t len;    ///< number of bytes written
+    bool failed;   ///< if a write overflowed the output buffer
+} writer_t;
+
+static void write_bytes(writer_t *const w, uint8_t const byte, size_t const count) {
+    if (w->failed || (w->size - w->len < count)) {
+        w->failed = true;
+        return;
+    }
+    memset(w->out + w->len, byte, count);
+    w->len += count;
+}
+
+static void write_u8(writer_t *const w, uint8_t const value) {
+    write_bytes(w, value, 1u);
+}
+
+static void write_u16(writer_t *const w, uint16_t const value) {
+    write_u8(w, (uint8_t) (value >> 8u));
+    write_u8(w, (uint8_t) value);
+}
+
+static void write_u32(writer_t *const w, uint32_t const value) {
+    write_u16(w, (uint16_t) (value >> 16u));
+    write_u16(w, (uint16_t) value);
+}
+
+static void write_z(writer_t *const w, uint64_t value) {
+    while (value >= 0x80u) {
+        write_u8(w, (uint8_t) (value | 0x80u));
+        value >>= 7u;
+    }
+    write_u8(w, (uint8_t) value);
+}
+
+static size_t writer_result(writer_t const *const w) {
+    return w->failed ? 0u : w->len;
+}
+
+/**
+ * @brief Gets the raw signature type of a curve
+ *
+ * @param derivation_type: curve of the key
+ * @param out: raw signature type output
+ * @return bool: false if the curve is not supported
+ */
+static bool raw_signature_type(derivation_type_t const derivation_type, uint8_t *const out) {
+    switch (derivation_type) {
+        case DERIVATION_TYPE_ED25519:
+        case DERIVATION_TYPE_BIP32_ED25519:
+            *out = RAW_SIGNATURE_TYPE_ED25519;
+            return true;
+        case DERIVATION_TYPE_SECP256K1:
+            *out = RAW_SIGNATURE_TYPE_SECP256K1;
+            return true;
+        case DERIVATION_TYPE_SECP256R1:
+            *out = RAW_SIGNATURE_TYPE_SECP256R1;
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t harness_public_key(uint8_t *const out, derivation_type_t const derivation_type) {
+    uint8_t type = 0u;
+    if (!raw_signature_type(derivation_type, &type)) {
+        return 0u;
+    }
+    if (type == RAW_SIGNATURE_TYPE_ED25519) {
+        memset(out, HARNESS_PUBLIC_KEY_BYTE, 32u);
+        return 32u;
+    }
+    out[0] = 0x02u;
+    memset(out + 1u, HARNESS_PUBLIC_KEY_BYTE, 32u);
+    return 33u;
+}
+
+size_t harness_build_block(uint8_t *const out,
+                           size_t const size,
+                           level_t const level,
+                           round_t const round,
+                           bool const locked_round) {
+    writer_t w = {.out = out, .size = size};
+
+    write_u8(&w, MAGIC_BYTE_BLOCK);
+    write_u32(&w, 0x7A06A770u);  // chain id
+    write_u32(&w, level);
+    write_u8(&w, 1u);             // protocol
+    write_bytes(&w, 0x11u, 32u);  // predecessor
+    write_bytes(&w, 0x00u, 8u);   // timestamp
+    write_u8(&w, 4u);             // validation passes
+    write_bytes(&w, 0x22u, 32u);  // operations hash
+
+    write_u32(&w, locked_round ? 37u : 33u);  // fitness size
+    write_u32(&w, 1u);
+    write_u8(&w, BLOCK_FITNESS_TAG);
+    write_u32(&w, sizeof(uint32_t));
+    write_u32(&w, level);
+    if (locked_round) {
+        write_u32(&w, sizeof(uint32_t));
+        write_u32(&w, 0u);
+    } else {
+        write_u32(&w, 0u);
+    }
+    write_u32(&w, sizeof(uint32_t));
+    write_u32(&w, 0u);  // predecessor round
+    write_u32(&w, sizeof(uint32_t));
+    write_u32(&w, round);
+
+    write_bytes(&w, 0x33u, BLOCK_PROTOCOL_DATA_SIZE);
+
+    return writer_result(&w);
+}
+
+size_t harness_build_consensus_operation(uint8_t *const out,
+                                         size_t const size,
+                                         baking_type_t const type,
+                                         level_t const level,
+                                         round_t const round,
+                                         bool const with_dal) {
+    writer_t w = {.out = out, .size = size};
+    bool const is_attestation = type == BAKING_TYPE_ATTESTATION;
+
+    write_u8(&w, is_attestation ? MAGIC_BYTE_ATTESTATION : MAGIC_BYTE_PREATTESTATION);
+    write_u32(&w, 0x7A06A770u);   // chain id
+    write_bytes(&w, 0x44u, 32u);  // branch
+    if (!is_attestation) {
+        write_u8(&w, CONSENSUS_TAG_PREATTESTATION);
+    } else if (with_dal) {
+        write_u8(&w, CONSENSUS_TAG_ATTESTATION_WITH_DAL);
+    } else {
+        write_u8(&w, CONSENSUS_TAG_ATTESTATION);
+    }
+    write_u16(&w, 12u);  // slot
+    write_u32(&w, level);
+    write_u32(&w, round);
+    write_bytes(&w, 0x55u, 32u);  // block payload hash
+    if (is_attestation && with_dal) {
+        write_z(&w, 0x1234u);
+    }
+
+    return writer_result(&w);
+}
+
+size_t harness_build_reveal_delegation(uint8_t *const out,
+                                       size_t const size,
+                                       derivation_type_t const derivation_type) {
+    writer_t w = {.out = out, .size = size};
+    uint8_t type = 0u;
+    uint8_t public_key[33] = {0};
+    size_t const public_key_size = harness_public_key(public_key, derivation_type);
+
+    if (!raw_signature_type(derivation_type, &type)) {
+        return 0u;
+    }
+
+    write_u8(&w, MAGIC_BYTE_UNSAFE_OP);
+    write_bytes(&w, 0x66u, 32u);  // branch
+
+    write_u8(&w, OPERATION_TAG_REVEAL);
+    write_u8(&w, type);
+    write_bytes(&w, HARNESS_PUBLIC_KEY_HASH_BYTE, KEY_HASH_SIZE);
+    write_z(&w, 374u);    // fee
+    write_z(&w, 23732u);  // counter
+    write_z(&w, 1000u);   // gas limit
+    write_z(&w, 0u);      // storage limit
+    write_u8(&w, type);
+    for (size_t i = 0; i < public_key_size; i++) {
+        write_u8(&w, public_key[i]);
+    }
+
+    write_u8(&w, OPERATION_TAG_DELEGATION);
+    write_u8(&w, type);
+    write_bytes(&w, HARNESS_PUBLIC_KEY_HASH_BYTE, KEY_HASH_SIZE);
+    write_z(&w, 375u);    // fee
+    write_z(&w, 23733u);  // counter
+    write_z(&w, 1000u);   // gas limit
+    write_z(&w, 0u);      // storage limit
+    write_u8(&w, 0xFFu);  // delegate presence
+    write_u8(&w, type);
+    write_bytes(&w, HARNESS_PUBLIC_KEY_HASH_BYTE, KEY_HASH_SIZE);
+
+    return writer_result(&w);
+}
@@ -0,0 +1,94 @@
+/* Tezos Ledger application - Host harness messages
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+#pragma once
+
+#include "types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Byte filling the public key returned by the mocked key derivation
+#define HARNESS_PUBLIC_KEY_BYTE 0x5Au
+
+/// Byte filling the public key hash returned by the mocked key derivation
+#define HARNESS_PUBLIC_KEY_HASH_BYTE 0xA5u
+
+/**
+ * @brief Gets the public key returned by the mocked key derivation
+ *
+ * @param out: public key output, at least 33 bytes
+ * @param derivation_type: curve of the key
+ * @return size_t: size of the public key, 0 if the curve is not supported
+ */
+size_t harness_public_key(uint8_t *const out, derivation_type_t const derivation_type);
+
+/**
+ * @brief Builds a block, magic byte included
+ *
+ *        The block has a tenderbake fitness and the protocol data of
+ *        a block header, so it has the size of the blocks sent by a
+ *        baker
+ *
+ * @param out: output buffer
+ * @param size: output buffer size
+ * @param level: level of the block
+ * @param round: round of the block
+ * @param locked_round: if the fitness has a locked round
+ * @return size_t: size of the block, 0 if the output buffer is too small
+ */
+size_t harness_build_block(uint8_t *const out,
+                           size_t const size,
+                           level_t const level,
+                           round_t const round,
+                           bool const locked_round);
+
+/**
+ * @brief Builds a consensus operation, magic byte included
+ *
+ * @param out: output buffer
+ * @param size: output buffer size
+ * @param type: `BAKING_TYPE_ATTESTATION` or `BAKING_TYPE_PREATTESTATION`
+ * @param level: level of the operation
+ * @param round: round of the operation
+ * @param with_dal: if the attestation carries a DAL content
+ * @return size_t: size of the operation, 0 if the output buffer is too small
+ */
+size_t harness_build_consensus_operation(uint8_t *const out,
+                                         size_t const size,
+                                         baking_type_t const type,
+                                         level_t const level,
+                                         round_t const round,
+                                         bool const with_dal);
+
+/**
+ * @brief Builds a group of a reveal and a delegation, magic byte included
+ *
+ *        The source, the revealed public key and the delegate are the
+ *        key returned by the mocked key derivation
+ *
+ * @param out: output buffer
+ * @param size: output buffer size
+ * @param derivation_type: curve of the key
+ * @return size_t: size of the group, 0 if the output buffer is too small
+ */
+size_t harness_build_reveal_delegation(uint8_t *const out,
+                                       size_t const size,
+                                       derivation_type_t const derivation_type);
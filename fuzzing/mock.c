@@ -0,0 +1,104 @@
+/* Tezos Ledger application - Host harness mocks of the application state
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+
+#include "messages.h"
+
+#include "globals.h"
+#include "keys.h"
+
+#include <string.h>
+
+/*
+ * The parsers are linked alone: the state and the functions they rely
+ * on are mocked. None of the functions of the HWM is reached from the
+ * parsers, they only need to link.
+ */
+
+globals_t global;
+
+baking_data const N_data_real;
+
+cx_err_t generate_public_key_hash(uint8_t *const hash_out,
+                                  size_t const hash_out_size,
+                                  cx_ecfp_public_key_t *const compressed_out,
+                                  bip32_path_with_curve_t const *const path_with_curve) {
+    if ((hash_out == NULL) || (path_with_curve == NULL) || (hash_out_size < KEY_HASH_SIZE)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    memset(hash_out, HARNESS_PUBLIC_KEY_HASH_BYTE, KEY_HASH_SIZE);
+
+    if (compressed_out != NULL) {
+        memset(compressed_out, 0, sizeof(*compressed_out));
+        compressed_out->W_len = harness_public_key(compressed_out->W,
+                                                   path_with_curve->derivation_type);
+        if (compressed_out->W_len == 0u) {
+            return CX_INVALID_PARAMETER;
+        }
+    }
+
+    return CX_OK;
+}
+
+cx_err_t load_baking_key_cache(void) {
+    return CX_OK;
+}
+
+void clear_pubkey_cache(void) {
+}
+
+uint32_t hash_bip32_path_with_curve(bip32_path_with_curve_t const *const path_with_curve) {
+    (void) path_with_curve;
+    return 0u;
+}
+
+high_watermark_t *select_hwm_by_chain(chain_id_t const chain_id) {
+    (void) chain_id;
+    return &g_hwm.hwm.main;
+}
+
+companion_key_t *find_companion_key(bip32_path_with_curve_t const *const key) {
+    (void) key;
+    return NULL;
+}
+
+high_watermark_t *select_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                              chain_id_t const chain_id) {
+    (void) key;
+    return select_hwm_by_chain(chain_id);
+}
+
+high_watermark_t const *find_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                                  chain_id_t const chain_id) {
+    return select_hwm_by_key_and_chain(key, chain_id);
+}
+
+void update_nvram(void volatile *dst, void const *src, size_t size) {
+    (void) dst;
+    (void) src;
+    (void) size;
+}
+
+void invalidate_idle_screen_strings(void) {
+}
+
+unsigned int os_global_pin_is_validated(void) {
+    return BOLOS_UX_OK;
+}
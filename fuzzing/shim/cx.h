@@ -0,0 +1,61 @@
+/* Tezos Ledger application - Host shim of the SDK `cx.h` header
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t cx_err_t;
+
+#define CX_OK                0x00000000u
+#define CX_INVALID_PARAMETER 0xFFFFFF81u
+
+#define CX_CHECK(call)        \
+    do {                      \
+        error = (call);       \
+        if (error != CX_OK) { \
+            goto end;         \
+        }                     \
+    } while (0)
+
+#define CX_SHA512_SIZE 64u
+
+typedef enum {
+    CX_CURVE_NONE = 0,
+    CX_CURVE_SECP256K1,
+    CX_CURVE_SECP256R1,
+    CX_CURVE_Ed25519,
+} cx_curve_t;
+
+typedef struct {
+    cx_curve_t curve;
+    size_t W_len;
+    uint8_t W[65];
+} cx_ecfp_public_key_t;
+
+typedef struct {
+    cx_curve_t curve;
+    size_t d_len;
+    uint8_t d[64];
+} cx_ecfp_private_key_t;
+
+typedef struct {
+    uint8_t state[256];
+} cx_blake2b_t;
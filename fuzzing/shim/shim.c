@@ -0,0 +1,64 @@
+/* Tezos Ledger application - Host shim of the SDK buffer and read functions
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#include "buffer.h"
+#include "read.h"
+
+bool buffer_can_read(const buffer_t *buffer, size_t n) {
+    return (buffer->size >= buffer->offset) && (buffer->size - buffer->offset >= n);
+}
+
+bool buffer_seek_cur(buffer_t *buffer, size_t offset) {
+    if (!buffer_can_read(buffer, offset)) {
+        return false;
+    }
+    buffer->offset += offset;
+    return true;
+}
+
+bool buffer_read_u8(buffer_t *buffer, uint8_t *value) {
+    if (!buffer_can_read(buffer, 1u)) {
+        *value = 0u;
+        return false;
+    }
+    *value = buffer->ptr[buffer->offset];
+    buffer->offset++;
+    return true;
+}
+
+bool buffer_read_u32(buffer_t *buffer, uint32_t *value, endianness_t endianness) {
+    if (!buffer_can_read(buffer, sizeof(uint32_t))) {
+        *value = 0u;
+        return false;
+    }
+    uint8_t const *const ptr = buffer->ptr + buffer->offset;
+    if (endianness == BE) {
+        *value = read_u32_be(ptr, 0u);
+    } else {
+        *value = ((uint32_t) ptr[3] << 24u) | ((uint32_t) ptr[2] << 16u) |
+                 ((uint32_t) ptr[1] << 8u) | (uint32_t) ptr[0];
+    }
+    buffer->offset += sizeof(uint32_t);
+    return true;
+}
+
+uint32_t read_u32_be(const uint8_t *ptr, size_t offset) {
+    return ((uint32_t) ptr[offset] << 24u) | ((uint32_t) ptr[offset + 1u] << 16u) |
+           ((uint32_t) ptr[offset + 2u] << 8u) | (uint32_t) ptr[offset + 3u];
+}
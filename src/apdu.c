@@ -20,54 +20,327 @@
 #include "apdu.h"
 
 #include "apdu_hmac.h"
+#include "apdu_hwm_sync.h"
 #include "apdu_pubkey.h"
 #include "apdu_query.h"
 #include "apdu_reset.h"
 #include "apdu_setup.h"
 #include "apdu_sign.h"
+#include "baking_auth.h"
 #include "globals.h"
 #include "to_string.h"
 #include "version.h"
+#include "write.h"
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
-int provide_pubkey(bip32_path_with_curve_t const* const path_with_curve) {
+tz_exc prepare_prompt(bool const async) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT(!g_prompt.is_pending, EXC_PROMPT_PENDING);
+
+    // A new prompt discards the response of the previous one
+    memset(&g_prompt, 0, sizeof(g_prompt));
+    g_prompt.is_async = async;
+
+end:
+    return exc;
+}
+
+int prompt_displayed(void) {
+    g_prompt.is_pending = true;
+    if (g_prompt.is_async) {
+        // The response of the prompt will be fetched with INS_PROMPT_RESULT
+        return io_send_sw(SW_OK);
+    }
+    return 0;
+}
+
+int io_send_prompt_response(uint8_t const* data, size_t size, uint16_t sw) {
+    bool const keep_response = g_prompt.is_pending && g_prompt.is_async;
+
+    g_prompt.is_pending = false;
+
+    if (!keep_response) {
+        return io_send_response_pointer(data, size, sw);
+    }
+
+    if (size > sizeof(g_prompt.u.response.data)) {
+        size = 0u;
+        sw = EXC_MEMORY_ERROR;
+    }
+    if (size != 0u) {
+        memmove(g_prompt.u.response.data, data, size);
+    }
+    g_prompt.u.response.size = (uint8_t) size;
+    g_prompt.u.response.sw = sw;
+    g_prompt.has_response = true;
+
+    return 0;
+}
+
+int io_send_prompt_err(uint16_t sw) {
+    if (g_prompt.is_pending && g_prompt.is_async) {
+        return io_send_prompt_response(NULL, 0u, sw);
+    }
+    g_prompt.is_pending = false;
+    return io_send_apdu_err(sw);
+}
+
+/**
+ * @brief Computes the public key response
+ *
+ *        Expects validated pin
+ *
+ * @param path_with_curve: bip32 path and curve of the key
+ * @param resp: output buffer
+ * @param resp_size: output size
+ * @param size: output the size written
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc format_pubkey(bip32_path_with_curve_t const* const path_with_curve,
+                            uint8_t* resp,
+                            size_t resp_size,
+                            size_t* size) {
     tz_exc exc = SW_OK;
     cx_err_t error = CX_OK;
 
     TZ_ASSERT_NOT_NULL(path_with_curve);
+    TZ_ASSERT_NOT_NULL(resp);
+    TZ_ASSERT_NOT_NULL(size);
 
-    uint8_t resp[1u + MAX_SIGNATURE_SIZE] = {0};
     size_t offset = 0;
 
     // Application could be PIN-locked, and pubkey->W_len would then be 0,
     // so throwing an error rather than returning an empty key
     TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
 
+    PERF_COUNT_PHASE(PERF_PHASE_PUBKEY, 0u);
+
     cx_ecfp_public_key_t pubkey = {0};
     CX_CHECK(generate_public_key(&pubkey, path_with_curve));
 
+    TZ_ASSERT(resp_size >= (1u + pubkey.W_len), EXC_MEMORY_ERROR);
+
     resp[offset] = pubkey.W_len;
     offset++;
     memmove(resp + offset, pubkey.W, pubkey.W_len);
     offset += pubkey.W_len;
 
-    return io_send_response_pointer(resp, offset, SW_OK);
+    *size = offset;
 
 end:
     TZ_CONVERT_CX();
+    return exc;
+}
+
+int provide_pubkey(bip32_path_with_curve_t const* const path_with_curve) {
+    tz_exc exc = SW_OK;
+
+    uint8_t resp[1u + MAX_SIGNATURE_SIZE] = {0};
+    size_t size = 0;
+
+    TZ_CHECK(format_pubkey(path_with_curve, resp, sizeof(resp), &size));
+
+    return io_send_response_pointer(resp, size, SW_OK);
+
+end:
+    return io_send_apdu_err(exc);
+}
+
+int provide_prompt_pubkey(bip32_path_with_curve_t const* const path_with_curve) {
+    tz_exc exc = SW_OK;
+
+    uint8_t resp[PROMPT_RESPONSE_MAX_SIZE] = {0};
+    size_t size = 0;
+
+    TZ_CHECK(format_pubkey(path_with_curve, resp, sizeof(resp), &size));
+
+    return io_send_prompt_response(resp, size, SW_OK);
+
+end:
+    return io_send_prompt_err(exc);
+}
+
+/**
+ * @brief Gets the response of the last asynchronous prompt
+ *
+ *        The response can only be fetched once
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+static int handle_prompt_result(void) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT(!g_prompt.is_pending, EXC_PROMPT_PENDING);
+    TZ_ASSERT(g_prompt.has_response, EXC_REFERENCED_DATA_NOT_FOUND);
+
+    uint8_t resp[PROMPT_RESPONSE_MAX_SIZE] = {0};
+    size_t const size = g_prompt.u.response.size;
+    uint16_t const sw = g_prompt.u.response.sw;
+    memmove(resp, g_prompt.u.response.data, size);
+
+    memset(&g_prompt, 0, sizeof(g_prompt));
+
+    return io_send_response_pointer(resp, size, sw);
+
+end:
     return io_send_apdu_err(exc);
 }
 
+/// Version of the capabilities format
+#define CAPABILITIES_FORMAT_VERSION 1u
+
+/**
+ * @brief Tags of the capabilities entries
+ *
+ */
+typedef enum {
+    CAPABILITY_TAG_INSTRUCTIONS = 0x01,  ///< bitmap of the supported instructions
+    CAPABILITY_TAG_CURVES = 0x02,        ///< bitmap of the supported curve codes
+    CAPABILITY_TAG_FEATURES = 0x03,      ///< bitmap of the supported request options
+    CAPABILITY_TAG_LIMITS = 0x04,        ///< limits of the app
+} capability_tag_t;
+
+/// Request options of the features bitmap
+#define CAPABILITY_SIGN_WITH_KEY      0x01u  ///< key and message in the same SIGN apdu
+#define CAPABILITY_COMPACT_SIGNATURE  0x02u  ///< signature as r || s
+#define CAPABILITY_SIGN_WITH_HWM      0x04u  ///< signature followed by the updated HWM
+#define CAPABILITY_ASYNC_PROMPT       0x08u  ///< prompts answered before the user validation
+#define CAPABILITY_HWM_LEVEL_ONLY     0x10u  ///< HWM only tracking levels
+#define CAPABILITY_SIGN_WITH_ACK      0x20u  ///< intermediate SIGN packets acknowledged
+#define CAPABILITY_SIGN_WITH_HOST_HWM 0x40u  ///< HWM of the host preceding the SIGN message
+
+/// Instructions supported by the app
+static const uint8_t SUPPORTED_INSTRUCTIONS[] = {
+    INS_VERSION,
+    INS_AUTHORIZE_BAKING,
+    INS_GET_PUBLIC_KEY,
+    INS_PROMPT_PUBLIC_KEY,
+    INS_SIGN,
+    INS_RESET,
+    INS_QUERY_AUTH_KEY,
+    INS_QUERY_MAIN_HWM,
+    INS_GIT,
+    INS_SETUP,
+    INS_QUERY_ALL_HWM,
+    INS_DEAUTHORIZE,
+    INS_QUERY_AUTH_KEY_WITH_CURVE,
+    INS_HMAC,
+    INS_SIGN_WITH_HASH,
+    INS_SIGN_BATCH,
+    INS_QUERY_NVRAM_STATS,
+#ifdef HAVE_PERF_COUNTERS
+    INS_QUERY_PERF,
+#endif
+    INS_QUERY_HWM_TABLE,
+    INS_QUERY_SNAPSHOT,
+    INS_PROMPT_RESULT,
+    INS_CHECK_AUTHORIZATION,
+#ifdef HAVE_BLS
+    INS_GET_PROOF_OF_POSSESSION,
+#endif
+    INS_EXPORT_HWM,
+    INS_IMPORT_HWM,
+    INS_SIGN_PIPELINED,
+};
+
+/// Number of curve codes, see `parse_derivation_type`
+#define CURVE_CODE_COUNT 5u
+
+/// Size of the capabilities, following the version
+#define CAPABILITIES_SIZE (1u + (2u + sizeof(uint32_t)) + (2u + 1u) + (2u + 1u) + (2u + 7u))
+
+/**
+ * @brief Writes a TLV entry of the capabilities
+ *
+ * @param out: output buffer
+ * @param offset: offset of the entry in `out`
+ * @param tag: tag of the entry
+ * @param size: size of the value, written after the entry header
+ * @return size_t: offset of the value of the entry
+ */
+static size_t write_capability_header(uint8_t* const out,
+                                      size_t const offset,
+                                      capability_tag_t const tag,
+                                      uint8_t const size) {
+    out[offset] = (uint8_t) tag;
+    out[offset + 1u] = size;
+    return offset + 2u;
+}
+
+/**
+ * @brief Writes the capabilities of the app
+ *
+ *        The capabilities only depend on the build of the app, not on
+ *        its state: for instance, batches are still refused for a
+ *        BLS12-381 authorized key
+ *
+ * @param out: output buffer, of at least `CAPABILITIES_SIZE` bytes
+ * @param offset: offset of the capabilities in `out`
+ * @return size_t: offset following the capabilities
+ */
+static size_t write_capabilities(uint8_t* const out, size_t offset) {
+    out[offset] = CAPABILITIES_FORMAT_VERSION;
+    offset++;
+
+    uint32_t instructions = 0;
+    for (size_t i = 0; i < sizeof(SUPPORTED_INSTRUCTIONS); i++) {
+        instructions |= 1UL << SUPPORTED_INSTRUCTIONS[i];
+    }
+    offset = write_capability_header(out, offset, CAPABILITY_TAG_INSTRUCTIONS, sizeof(uint32_t));
+    write_u32_be(out, offset, instructions);
+    offset += sizeof(uint32_t);
+
+    uint8_t curves = 0;
+    for (uint8_t curve_code = 0; curve_code < CURVE_CODE_COUNT; curve_code++) {
+        if (parse_derivation_type(curve_code) != DERIVATION_TYPE_UNSET) {
+            curves |= 1u << curve_code;
+        }
+    }
+    offset = write_capability_header(out, offset, CAPABILITY_TAG_CURVES, 1u);
+    out[offset] = curves;
+    offset++;
+
+    offset = write_capability_header(out, offset, CAPABILITY_TAG_FEATURES, 1u);
+    out[offset] = CAPABILITY_SIGN_WITH_KEY | CAPABILITY_COMPACT_SIGNATURE |
+                  CAPABILITY_SIGN_WITH_HWM | CAPABILITY_ASYNC_PROMPT | CAPABILITY_HWM_LEVEL_ONLY |
+                  CAPABILITY_SIGN_WITH_ACK | CAPABILITY_SIGN_WITH_HOST_HWM;
+    offset++;
+
+    _Static_assert(HWM_RESERVED_LEVELS <= UINT8_MAX, "HWM_RESERVED_LEVELS must fit in a byte");
+    offset = write_capability_header(out, offset, CAPABILITY_TAG_LIMITS, 7u);
+    out[offset] = MAX_APDU_SIZE;
+    out[offset + 1u] = SIGN_BATCH_MAX_SIZE;
+    out[offset + 2u] = SIGN_BATCH_CHUNK_SIZE;
+    out[offset + 3u] = HWM_CHAIN_SLOTS;
+    out[offset + 4u] = MAX_COMPANION_KEYS;
+    out[offset + 5u] = SNAPSHOT_PAGE_SIZE;
+    out[offset + 6u] = HWM_RESERVED_LEVELS;
+    offset += 7u;
+
+    return offset;
+}
+
 /**
  * @brief Gets the version
  *
+ * @param with_capabilities: if the version is followed by the capabilities of the app
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
-static int handle_version(void) {
-    return io_send_response_pointer((const uint8_t*) &version, sizeof(version_t), SW_OK);
+static int handle_version(bool const with_capabilities) {
+    uint8_t resp[sizeof(version_t) + CAPABILITIES_SIZE] = {0};
+    size_t size = sizeof(version_t);
+
+    memcpy(resp, &version, sizeof(version_t));
+
+    if (with_capabilities) {
+        size = write_capabilities(resp, size);
+    }
+
+    return io_send_response_pointer(resp, size, SW_OK);
 }
 
 /**
@@ -84,8 +357,25 @@ static int handle_git(void) {
 /// Packet indexes
 #define P1_FIRST       0x00u  /// First packet
 #define P1_NEXT        0x01u  /// Other packet
+#define P1_WITH_KEY    0x02u  /// First packet carrying both the key and the message
+#define P1_FETCH       0x03u  /// Request for the next part of the response
 #define P1_LAST_MARKER 0x80u  /// Last packet
 
+/// Signature response flags
+#define P1_COMPACT_SIGNATURE 0x10u  /// Signature as r || s instead of DER
+#define P1_WITH_HWM          0x20u  /// Signature followed by the updated HWM
+#define P1_WITH_ACK          0x08u  /// Intermediate packets answered with the progress
+
+/// Signature request flags
+#define P1_WITH_HOST_HWM 0x04u  /// First part of the message preceded by the HWM of the host
+
+#define P1_PERF_RESET 0x01u  /// Reset the performance counters after reading them
+
+#define P1_VERSION_CAPABILITIES 0x01u  /// Version followed by the capabilities of the app
+
+#define P1_AUTHORIZE_COMPANION_KEY 0x01u  /// Authorize the key in addition to the authorized key
+#define P1_ASYNC_PROMPT            0x40u  /// Answer before the prompt, see INS_PROMPT_RESULT
+
 int apdu_dispatcher(const command_t* cmd) {
     tz_exc exc = SW_OK;
 
@@ -99,9 +389,45 @@ int apdu_dispatcher(const command_t* cmd) {
         TZ_FAIL(EXC_CLASS);
     }
 
+    PERF_COUNT_INSTRUCTION(cmd->ins);
+
+    switch (cmd->ins) {
+        case INS_SIGN:
+        case INS_SIGN_WITH_HASH:
+            // The signing context holds the state of either a signature or a batch
+            global.apdu.sign_batch_in_progress = false;
+            global.apdu.sign_pipeline_in_progress = false;
+            global.apdu.flow = APDU_FLOW_SIGN;
+            break;
+        case INS_SIGN_BATCH:
+            global.apdu.sign_pipeline_in_progress = false;
+            global.apdu.flow = APDU_FLOW_SIGN;
+            break;
+        case INS_SIGN_PIPELINED:
+            global.apdu.sign_batch_in_progress = false;
+            global.apdu.flow = APDU_FLOW_SIGN;
+            break;
+        case INS_HMAC:
+        case INS_EXPORT_HWM:
+        case INS_IMPORT_HWM:
+            global.apdu.flow = APDU_FLOW_HMAC;
+            break;
+        default:
+            global.apdu.flow = APDU_FLOW_NONE;
+            break;
+    }
+
+    // The display is not refreshed between the packets of a signature, each
+    // pipelined message is a whole signature
+    global.dynamic_display.sign_in_flight = (global.apdu.flow == APDU_FLOW_SIGN) &&
+                                            (cmd->ins != INS_SIGN_PIPELINED) &&
+                                            ((cmd->p1 & P1_LAST_MARKER) == 0u) &&
+                                            (cmd->p1 != P1_FETCH);
+
     int result = 0;
     buffer_t buf = {0};
     derivation_type_t derivation_type = DERIVATION_TYPE_UNSET;
+    bool const async = (cmd->p1 & P1_ASYNC_PROMPT) != 0u;
 
 #define ASSERT_NO_P1 TZ_ASSERT(cmd->p1 == 0u, EXC_WRONG_PARAM)
 
@@ -115,6 +441,8 @@ int apdu_dispatcher(const command_t* cmd) {
 
 #define ASSERT_NO_DATA TZ_ASSERT(cmd->data == NULL, EXC_WRONG_VALUES)
 
+#define PREPARE_PROMPT TZ_CHECK(prepare_prompt(async))
+
 #define READ_DATA            \
     do {                     \
         buf.ptr = cmd->data; \
@@ -125,11 +453,11 @@ int apdu_dispatcher(const command_t* cmd) {
     switch (cmd->ins) {
         case INS_VERSION:
 
-            ASSERT_NO_P1;
+            TZ_ASSERT(cmd->p1 <= P1_VERSION_CAPABILITIES, EXC_WRONG_PARAM);
             ASSERT_NO_P2;
             ASSERT_NO_DATA;
 
-            result = handle_version();
+            result = handle_version(cmd->p1 == P1_VERSION_CAPABILITIES);
 
             break;
         case INS_GIT:
@@ -145,16 +473,40 @@ int apdu_dispatcher(const command_t* cmd) {
         case INS_PROMPT_PUBLIC_KEY:
         case INS_AUTHORIZE_BAKING:
 
-            ASSERT_NO_P1;
             READ_P2_DERIVATION_TYPE;
             READ_DATA;
 
             bool authorize = cmd->ins == INS_AUTHORIZE_BAKING;
             bool prompt = (cmd->ins == INS_AUTHORIZE_BAKING) || (cmd->ins == INS_PROMPT_PUBLIC_KEY);
+            bool companion = (cmd->p1 & P1_AUTHORIZE_COMPANION_KEY) != 0u;
+
+            uint8_t const p1_flags = (prompt ? P1_ASYNC_PROMPT : 0u) |
+                                     (authorize ? P1_AUTHORIZE_COMPANION_KEY : 0u);
+            TZ_ASSERT((cmd->p1 & ~p1_flags) == 0u, EXC_WRONG_PARAM);
+
+            if (prompt) {
+                PREPARE_PROMPT;
+            }
+
+            if (companion) {
+                result = handle_authorize_companion_key(&buf, derivation_type);
+                break;
+            }
 
             result = handle_get_public_key(&buf, derivation_type, authorize, prompt);
 
             break;
+#ifdef HAVE_BLS
+        case INS_GET_PROOF_OF_POSSESSION:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_get_proof_of_possession();
+
+            break;
+#endif
         case INS_DEAUTHORIZE:
 
             ASSERT_NO_P1;
@@ -166,18 +518,20 @@ int apdu_dispatcher(const command_t* cmd) {
             break;
         case INS_SETUP:
 
-            ASSERT_NO_P1;
+            TZ_ASSERT((cmd->p1 & ~P1_ASYNC_PROMPT) == 0u, EXC_WRONG_PARAM);
             READ_P2_DERIVATION_TYPE;
             READ_DATA;
+            PREPARE_PROMPT;
 
             result = handle_setup(&buf, derivation_type);
 
             break;
         case INS_RESET:
 
-            ASSERT_NO_P1;
+            TZ_ASSERT((cmd->p1 & ~P1_ASYNC_PROMPT) == 0u, EXC_WRONG_PARAM);
             ASSERT_NO_P2;
             READ_DATA;
+            PREPARE_PROMPT;
 
             result = handle_reset(&buf);
 
@@ -217,14 +571,101 @@ int apdu_dispatcher(const command_t* cmd) {
 
             result = handle_query_all_hwm();
 
+            break;
+        case INS_QUERY_HWM_TABLE:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_query_hwm_table();
+
+            break;
+        case INS_QUERY_SNAPSHOT:
+
+            // P1 is the page index
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_query_snapshot(cmd->p1);
+
+            break;
+#ifdef HAVE_PERF_COUNTERS
+        case INS_QUERY_PERF:
+
+            TZ_ASSERT(cmd->p1 <= P1_PERF_RESET, EXC_WRONG_PARAM);
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_query_perf(cmd->p1 == P1_PERF_RESET);
+
+            break;
+#endif
+        case INS_PROMPT_RESULT:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_prompt_result();
+
+            break;
+        case INS_CHECK_AUTHORIZATION:
+
+            ASSERT_NO_P1;
+            // Ignored if the authorized key is requested
+            derivation_type = parse_derivation_type(cmd->p2);
+            READ_DATA;
+
+            result = handle_check_authorization(&buf, derivation_type);
+
+            break;
+        case INS_EXPORT_HWM:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_export_hwm();
+
+            break;
+        case INS_IMPORT_HWM:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            READ_DATA;
+
+            result = handle_import_hwm(&buf);
+
+            break;
+        case INS_QUERY_NVRAM_STATS:
+
+            ASSERT_NO_P1;
+            ASSERT_NO_P2;
+            ASSERT_NO_DATA;
+
+            result = handle_query_nvram_stats();
+
             break;
         case INS_SIGN:
         case INS_SIGN_WITH_HASH:
             TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
 
-            switch (cmd->p1 & ~P1_LAST_MARKER) {
+            bool last = (cmd->p1 & P1_LAST_MARKER) != 0;
+            uint8_t const response_format =
+                ((cmd->ins == INS_SIGN_WITH_HASH) ? SIGN_RESPONSE_HASH : 0u) |
+                (((cmd->p1 & P1_COMPACT_SIGNATURE) != 0u) ? SIGN_RESPONSE_COMPACT : 0u) |
+                (((cmd->p1 & P1_WITH_HWM) != 0u) ? SIGN_RESPONSE_HWM : 0u) |
+                (((cmd->p1 & P1_WITH_ACK) != 0u) ? SIGN_RESPONSE_ACK : 0u);
+
+            bool const with_host_hwm = (cmd->p1 & P1_WITH_HOST_HWM) != 0u;
+
+            switch (cmd->p1 & ~(P1_LAST_MARKER | P1_COMPACT_SIGNATURE | P1_WITH_HWM |
+                                P1_WITH_ACK | P1_WITH_HOST_HWM)) {
                 case P1_FIRST:
 
+                    // The key packet carries no message and gets no signature
+                    TZ_ASSERT((cmd->p1 & ~P1_LAST_MARKER) == P1_FIRST, EXC_WRONG_PARAM);
                     READ_P2_DERIVATION_TYPE;
                     READ_DATA;
 
@@ -235,10 +676,75 @@ int apdu_dispatcher(const command_t* cmd) {
 
                     READ_DATA;
 
-                    bool with_hash = cmd->ins == INS_SIGN_WITH_HASH;
-                    bool last = (cmd->p1 & P1_LAST_MARKER) != 0;
+                    result = handle_sign(&buf, last, response_format, with_host_hwm);
+
+                    break;
+                case P1_WITH_KEY:
+
+                    // Ignored if the authorized key is requested
+                    derivation_type = parse_derivation_type(cmd->p2);
+                    READ_DATA;
+
+                    result = handle_sign_with_key(&buf,
+                                                  derivation_type,
+                                                  last,
+                                                  response_format,
+                                                  with_host_hwm);
+
+                    break;
+                default:
+                    TZ_FAIL(EXC_WRONG_PARAM);
+            }
+
+            break;
+        case INS_SIGN_BATCH:
+            TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+            ASSERT_NO_P2;
+
+            switch (cmd->p1 & ~P1_LAST_MARKER) {
+                case P1_FIRST:
+                case P1_NEXT:
+
+                    READ_DATA;
+
+                    result = handle_sign_batch(&buf,
+                                               (cmd->p1 & ~P1_LAST_MARKER) == P1_FIRST,
+                                               (cmd->p1 & P1_LAST_MARKER) != 0);
+
+                    break;
+                case P1_FETCH:
+
+                    TZ_ASSERT(cmd->p1 == P1_FETCH, EXC_WRONG_PARAM);
+                    ASSERT_NO_DATA;
+
+                    result = handle_sign_batch_fetch();
+
+                    break;
+                default:
+                    TZ_FAIL(EXC_WRONG_PARAM);
+            }
+
+            break;
+        case INS_SIGN_PIPELINED:
+            TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+            ASSERT_NO_P2;
+
+            switch (cmd->p1) {
+                case P1_FIRST:
+                case P1_NEXT:
+
+                    READ_DATA;
+
+                    result = handle_sign_pipelined(&buf, cmd->p1 == P1_FIRST);
+
+                    break;
+                case P1_FETCH:
+
+                    ASSERT_NO_DATA;
 
-                    result = handle_sign(&buf, last, with_hash);
+                    result = handle_sign_pipelined_fetch();
 
                     break;
                 default:
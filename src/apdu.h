@@ -55,6 +55,21 @@
 #define INS_QUERY_AUTH_KEY_WITH_CURVE 0x0Du
 #define INS_HMAC                      0x0Eu
 #define INS_SIGN_WITH_HASH            0x0Fu
+#define INS_SIGN_BATCH                0x10u
+#define INS_QUERY_NVRAM_STATS         0x11u
+#define INS_QUERY_PERF                0x12u
+#define INS_QUERY_HWM_TABLE           0x13u
+#define INS_QUERY_SNAPSHOT            0x14u
+#define INS_PROMPT_RESULT             0x15u
+#define INS_CHECK_AUTHORIZATION       0x16u
+#define INS_GET_PROOF_OF_POSSESSION   0x17u
+#define INS_EXPORT_HWM                0x18u
+#define INS_IMPORT_HWM                0x19u
+#define INS_SIGN_PIPELINED            0x1Au
+
+// The performance counters count every instruction, up to the last one
+_Static_assert(PERF_INS_COUNT == (INS_SIGN_PIPELINED + 1u),
+               "PERF_INS_COUNT must follow the last instruction");
 
 /**
  * @brief Dispatch APDU command received to the right handler
@@ -64,21 +79,56 @@
  */
 int apdu_dispatcher(const command_t* cmd);
 
+/**
+ * @brief Prepares a prompt
+ *
+ *        Fails if a prompt is already pending. The response of an
+ *        asynchronous prompt is kept until fetched with
+ *        `INS_PROMPT_RESULT`, the prompt APDU is answered as soon as
+ *        the prompt is displayed.
+ *
+ * @param async: if the prompt is asynchronous
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc prepare_prompt(bool async);
+
+/**
+ * @brief Marks the prepared prompt as pending
+ *
+ *        Must be called once the prompt is displayed
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int prompt_displayed(void);
+
+/**
+ * @brief Sends the response of a prompt
+ *
+ *        The response of a pending asynchronous prompt is kept
+ *        instead of being sent
+ *
+ * @param data: response data
+ * @param size: size of the response data
+ * @param sw: status word of the response
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int io_send_prompt_response(uint8_t const* data, size_t size, uint16_t sw);
+
 /**
  * @brief Sends a reject exception
  *
  * @return true
  */
 static inline bool reject(void) {
-    io_send_sw(EXC_REJECT);
+    io_send_prompt_response(NULL, 0u, EXC_REJECT);
     return true;
 }
 
 /**
  * @brief Sends an apdu error
  *
- *        Clears apdu state because the application state must not
- *        persist through errors
+ *        Clears the apdu state of the current flow because the
+ *        application state must not persist through errors
  *
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
@@ -96,3 +146,24 @@ static inline int io_send_apdu_err(uint16_t sw) {
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
 int provide_pubkey(bip32_path_with_curve_t const* const path_with_curve);
+
+/**
+ * @brief Provides the public key in the response of a prompt
+ *
+ *        Expects validated pin
+ *
+ * @param path_with_curve: bip32 path and curve of the key
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int provide_prompt_pubkey(bip32_path_with_curve_t const* const path_with_curve);
+
+/**
+ * @brief Sends an error in the response of a prompt
+ *
+ *        Clears apdu state if the error is sent, the apdu state of the
+ *        APDUs served while an asynchronous prompt is pending is kept
+ *
+ * @param sw: status word of the error
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int io_send_prompt_err(uint16_t sw);
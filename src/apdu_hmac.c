@@ -22,13 +22,19 @@
 #include "globals.h"
 #include "keys.h"
 
-#define G global.apdu.u.hmac
+#define G global.apdu.hmac
+
+void clear_hmac_key_cache(void) {
+    explicit_bzero(&global.hmac_key_cache, sizeof(global.hmac_key_cache));
+}
 
 /**
  * @brief Generate the hmac of a message
  *
  *        The hmac-key is the signature of a fixed message signed with a given key
  *
+ *        The hmac-key of the last key used is cached
+ *
  * @param out: result output
  * @param out_size: output size
  * @param state: hmac state
@@ -60,23 +66,39 @@ static inline tz_exc hmac(uint8_t *const out,
                                          0x6c, 0xb5, 0x68, 0x0c, 0xb7, 0xd1, 0x8e, 0x62,
                                          0x5a, 0x90, 0x47, 0x5e, 0xc0, 0xdb, 0xdb, 0x9f};
 
-    size_t signed_hmac_key_size = MAX_SIGNATURE_SIZE;
+    hmac_key_cache_t *const cache = &global.hmac_key_cache;
+
+    // The cached hmac key must not outlive the PIN validation
+    if (os_global_pin_is_validated() != BOLOS_UX_OK) {
+        clear_hmac_key_cache();
+    }
+
+    if (!cache->is_set || !bip32_path_with_curve_eq(&cache->key, path_with_curve)) {
+        clear_hmac_key_cache();
+
+        size_t signed_hmac_key_size = MAX_SIGNATURE_SIZE;
+
+        // Deterministically sign the SHA256 value to get something directly tied to the secret
+        // key.
+        CX_CHECK(sign(state->signed_hmac_key,
+                      &signed_hmac_key_size,
+                      path_with_curve,
+                      key_sha256,
+                      sizeof(key_sha256)));
 
-    // Deterministically sign the SHA256 value to get something directly tied to the secret key.
-    CX_CHECK(sign(state->signed_hmac_key,
-                  &signed_hmac_key_size,
-                  path_with_curve,
-                  key_sha256,
-                  sizeof(key_sha256)));
+        // Hash the signed value with SHA512 to get a 64-byte key for HMAC.
+        cx_hash_sha512(state->signed_hmac_key,
+                       signed_hmac_key_size,
+                       cache->hashed_signed_hmac_key,
+                       sizeof(cache->hashed_signed_hmac_key));
+        explicit_bzero(state->signed_hmac_key, sizeof(state->signed_hmac_key));
 
-    // Hash the signed value with SHA512 to get a 64-byte key for HMAC.
-    cx_hash_sha512(state->signed_hmac_key,
-                   signed_hmac_key_size,
-                   state->hashed_signed_hmac_key,
-                   sizeof(state->hashed_signed_hmac_key));
+        TZ_ASSERT(copy_bip32_path_with_curve(&cache->key, path_with_curve), EXC_WRONG_LENGTH);
+        cache->is_set = true;
+    }
 
-    *out_size = cx_hmac_sha256(state->hashed_signed_hmac_key,
-                               sizeof(state->hashed_signed_hmac_key),
+    *out_size = cx_hmac_sha256(cache->hashed_signed_hmac_key,
+                               sizeof(cache->hashed_signed_hmac_key),
                                in,
                                in_size,
                                out,
@@ -84,6 +106,9 @@ static inline tz_exc hmac(uint8_t *const out,
 
 end:
     TZ_CONVERT_CX();
+    if (exc != SW_OK) {
+        clear_hmac_key_cache();
+    }
     return exc;
 }
 
@@ -104,18 +129,18 @@ int handle_hmac(buffer_t *cdata, derivation_type_t derivation_type) {
 
     TZ_ASSERT(read_bip32_path(cdata, &path_with_curve.bip32_path), EXC_WRONG_VALUES);
 
-    size_t hmac_size = sizeof(G.hmac);
-    TZ_CHECK(hmac(G.hmac,
+    PERF_COUNT_PHASE(PERF_PHASE_HMAC, cdata->size - cdata->offset);
+
+    uint8_t resp[CX_SHA256_SIZE] = {0};
+
+    size_t hmac_size = sizeof(resp);
+    TZ_CHECK(hmac(resp,
                   &hmac_size,
                   &G,
                   cdata->ptr + cdata->offset,
                   cdata->size - cdata->offset,
                   &path_with_curve));
 
-    uint8_t resp[CX_SHA256_SIZE] = {0};
-
-    memcpy(resp, G.hmac, hmac_size);
-
     return io_send_response_pointer(resp, hmac_size, SW_OK);
 
 end:
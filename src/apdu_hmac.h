@@ -33,3 +33,9 @@
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
 int handle_hmac(buffer_t *cdata, derivation_type_t derivation_type);
+
+/**
+ * @brief Wipes the hmac key cache
+ *
+ */
+void clear_hmac_key_cache(void);
@@ -0,0 +1,232 @@
+/* Tezos Ledger application - HWM synchronization handlers
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#include "apdu_hwm_sync.h"
+
+#include "baking_auth.h"
+#include "globals.h"
+#include "keys.h"
+#include "write.h"
+
+#include <string.h>
+
+#define G global.apdu.hmac
+
+#define HWM_SYNC_HAD_ATTESTATION    0x01u
+#define HWM_SYNC_HAD_PREATTESTATION 0x02u
+
+/// Size of a serialized HWM
+#define HWM_SYNC_HWM_SIZE (2u * sizeof(uint32_t) + 1u)
+
+/// Size of the exported data authenticated by the hmac
+#define HWM_SYNC_DATA_SIZE (sizeof(uint32_t) + 2u * HWM_SYNC_HWM_SIZE)
+
+/// Size of an export
+#define HWM_SYNC_EXPORT_SIZE (HWM_SYNC_DATA_SIZE + CX_SHA256_SIZE)
+
+/**
+ * @brief Generates the hmac of an export
+ *
+ *        The hmac-key is the signature, by the authorized key, of a
+ *        fixed message different from the one of `INS_HMAC`: the hmac
+ *        of an export cannot be requested with `INS_HMAC`.
+ *
+ * @param out: hmac output, `CX_SHA256_SIZE` bytes
+ * @param in: exported data
+ * @param in_size: size of the exported data
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc hwm_sync_hmac(uint8_t *const out, uint8_t const *const in, size_t const in_size) {
+    tz_exc exc = SW_OK;
+    cx_err_t error = CX_OK;
+
+    TZ_ASSERT_NOT_NULL(out);
+    TZ_ASSERT_NOT_NULL(in);
+
+    // SHA256 of "Tezos baking high watermark synchronization"
+    static uint8_t const key_sha256[] = {0xf8, 0x66, 0xb9, 0x2c, 0xd4, 0x33, 0x0f, 0x29,
+                                         0x36, 0xce, 0xa6, 0x8c, 0x25, 0x18, 0xde, 0xc4,
+                                         0x5e, 0x37, 0x27, 0xcc, 0xbd, 0xc0, 0xbc, 0x45,
+                                         0xf0, 0x8d, 0x93, 0x01, 0xc2, 0xf2, 0xd8, 0xf8};
+
+    uint8_t hashed_signed_hmac_key[CX_SHA512_SIZE] = {0};
+    size_t signed_hmac_key_size = sizeof(G.signed_hmac_key);
+
+    CX_CHECK(sign(G.signed_hmac_key,
+                  &signed_hmac_key_size,
+                  &g_hwm.baking_key,
+                  key_sha256,
+                  sizeof(key_sha256)));
+
+    cx_hash_sha512(G.signed_hmac_key,
+                   signed_hmac_key_size,
+                   hashed_signed_hmac_key,
+                   sizeof(hashed_signed_hmac_key));
+
+    cx_hmac_sha256(hashed_signed_hmac_key,
+                   sizeof(hashed_signed_hmac_key),
+                   in,
+                   in_size,
+                   out,
+                   CX_SHA256_SIZE);
+
+end:
+    TZ_CONVERT_CX();
+    explicit_bzero(G.signed_hmac_key, sizeof(G.signed_hmac_key));
+    explicit_bzero(hashed_signed_hmac_key, sizeof(hashed_signed_hmac_key));
+    return exc;
+}
+
+/**
+ * @brief Checks that the HWM of the authorized key can be synchronized
+ *
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc check_hwm_sync(void) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT(g_hwm.baking_key.bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+    TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+end:
+    return exc;
+}
+
+/**
+ * @brief Serializes a HWM
+ *
+ * @param out: output buffer
+ * @param offset: offset in the output buffer
+ * @param hwm: HWM
+ * @return size_t: offset after the HWM
+ */
+static size_t write_hwm(uint8_t *const out, size_t offset, high_watermark_t const *const hwm) {
+    write_u32_be(out, offset, hwm->highest_level);
+    offset += sizeof(uint32_t);
+
+    write_u32_be(out, offset, hwm->highest_round);
+    offset += sizeof(uint32_t);
+
+    out[offset] = (hwm->had_attestation ? HWM_SYNC_HAD_ATTESTATION : 0u) |
+                  (hwm->had_preattestation ? HWM_SYNC_HAD_PREATTESTATION : 0u);
+    offset++;
+
+    return offset;
+}
+
+/**
+ * @brief Deserializes a HWM
+ *
+ * @param buf: input buffer
+ * @param hwm: HWM output
+ * @return bool: whether the HWM has been read
+ */
+static bool read_hwm(buffer_t *const buf, high_watermark_t *const hwm) {
+    uint8_t flags = 0u;
+
+    if (!(buffer_read_u32(buf, &hwm->highest_level, BE) &&  // level
+          buffer_read_u32(buf, &hwm->highest_round, BE) &&  // round
+          buffer_read_u8(buf, &flags))) {
+        return false;
+    }
+    if ((flags & ~(HWM_SYNC_HAD_ATTESTATION | HWM_SYNC_HAD_PREATTESTATION)) != 0u) {
+        return false;
+    }
+
+    hwm->had_attestation = (flags & HWM_SYNC_HAD_ATTESTATION) != 0u;
+    hwm->had_preattestation = (flags & HWM_SYNC_HAD_PREATTESTATION) != 0u;
+    return true;
+}
+
+/**
+ * Response:
+ *   + (4 bytes) uint32: chain id
+ *   + (9 bytes) hwm: main hwm
+ *   + (9 bytes) hwm: test hwm
+ *   + (32 bytes) uint8 *: hmac
+ */
+int handle_export_hwm(void) {
+    tz_exc exc = SW_OK;
+
+    memset(&G, 0, sizeof(G));
+
+    TZ_CHECK(check_hwm_sync());
+
+    uint8_t resp[HWM_SYNC_EXPORT_SIZE] = {0};
+    size_t offset = 0;
+
+    write_u32_be(resp, offset, g_hwm.main_chain_id.v);
+    offset += sizeof(uint32_t);
+
+    offset = write_hwm(resp, offset, &g_hwm.hwm.main);
+    offset = write_hwm(resp, offset, &g_hwm.hwm.test);
+
+    TZ_CHECK(hwm_sync_hmac(resp + offset, resp, offset));
+    offset += CX_SHA256_SIZE;
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+
+end:
+    return io_send_apdu_err(exc);
+}
+
+/**
+ * Cdata:
+ *   + (54 bytes) uint8 *: export of `handle_export_hwm`
+ */
+int handle_import_hwm(buffer_t *cdata) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
+
+    memset(&G, 0, sizeof(G));
+
+    TZ_CHECK(check_hwm_sync());
+
+    TZ_ASSERT(cdata->size - cdata->offset == HWM_SYNC_EXPORT_SIZE, EXC_WRONG_LENGTH);
+
+    uint8_t expected_hmac[CX_SHA256_SIZE] = {0};
+    TZ_CHECK(hwm_sync_hmac(expected_hmac, cdata->ptr + cdata->offset, HWM_SYNC_DATA_SIZE));
+
+    uint8_t const *const hmac = cdata->ptr + cdata->offset + HWM_SYNC_DATA_SIZE;
+    uint8_t diff = 0u;
+    for (size_t i = 0; i < sizeof(expected_hmac); i++) {
+        diff |= expected_hmac[i] ^ hmac[i];
+    }
+    TZ_ASSERT(diff == 0u, EXC_SECURITY);
+
+    chain_id_t chain_id = {0};
+    high_watermark_t main = {0};
+    high_watermark_t test = {0};
+
+    TZ_ASSERT(buffer_read_u32(cdata, &chain_id.v, BE) &&  // chain id
+                  read_hwm(cdata, &main) &&               // main hwm
+                  read_hwm(cdata, &test),                 // test hwm
+              EXC_WRONG_VALUES);
+
+    // The HWM of another main chain would not protect the same messages
+    TZ_ASSERT(chain_id.v == g_hwm.main_chain_id.v, EXC_WRONG_VALUES);
+
+    TZ_CHECK(import_high_water_marks(&main, &test));
+
+    return io_send_sw(SW_OK);
+
+end:
+    return io_send_apdu_err(exc);
+}
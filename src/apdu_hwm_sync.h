@@ -0,0 +1,44 @@
+/* Tezos Ledger application - HWM synchronization handlers
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#pragma once
+
+#include "apdu.h"
+
+/**
+ * @brief Exports the main and test HWM of the authorized key
+ *
+ *        The export is authenticated with a hmac whose key is
+ *        tied to the authorized key, so that only a device holding
+ *        the same seed and authorized key can import it.
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_export_hwm(void);
+
+/**
+ * @brief Imports the main and test HWM exported by `handle_export_hwm`
+ *
+ *        The hmac of the export is checked first. A HWM is only
+ *        raised, never lowered.
+ *
+ * @param cdata: data containing the export
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_import_hwm(buffer_t *cdata);
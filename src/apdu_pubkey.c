@@ -32,13 +32,15 @@
 
 #include <string.h>
 
+#define G g_prompt.u.request
+
 /**
  * @brief Sends apdu response with the public key
  *
  * @return true
  */
 static bool pubkey_ok(void) {
-    provide_pubkey(&global.path_with_curve);
+    provide_prompt_pubkey(&G.path_with_curve);
     return true;
 }
 
@@ -52,12 +54,28 @@ static bool pubkey_ok(void) {
 static bool baking_ok(void) {
     tz_exc exc = SW_OK;
 
-    TZ_CHECK(authorize_baking(global.path_with_curve.derivation_type,
-                              &global.path_with_curve.bip32_path));
+    TZ_CHECK(authorize_baking(G.path_with_curve.derivation_type, &G.path_with_curve.bip32_path));
     return pubkey_ok();
 
 end:
-    return io_send_apdu_err(exc);
+    return io_send_prompt_err(exc);
+}
+
+/**
+ * @brief Authorizes the public key as a companion key
+ *
+ *        Sends apdu response with the public key
+ *
+ * @return true
+ */
+static bool companion_ok(void) {
+    tz_exc exc = SW_OK;
+
+    TZ_CHECK(authorize_companion_key(&G.path_with_curve));
+    return pubkey_ok();
+
+end:
+    return io_send_prompt_err(exc);
 }
 
 /**
@@ -72,18 +90,21 @@ int handle_get_public_key(buffer_t *cdata,
 
     TZ_ASSERT_NOT_NULL(cdata);
 
-    global.path_with_curve.derivation_type = derivation_type;
+    // The key is kept apart from the signing key
+    bip32_path_with_curve_t path_with_curve = {0};
+    bip32_path_with_curve_t *const key = prompt ? &G.path_with_curve : &path_with_curve;
+
+    key->derivation_type = derivation_type;
     if ((cdata->size == 0u) && authorize) {
-        TZ_ASSERT(copy_bip32_path_with_curve(&global.path_with_curve, &(g_hwm.baking_key)),
-                  EXC_MEMORY_ERROR);
+        TZ_ASSERT(copy_bip32_path_with_curve(key, &(g_hwm.baking_key)), EXC_MEMORY_ERROR);
     } else {
-        TZ_ASSERT(read_bip32_path(cdata, &global.path_with_curve.bip32_path), EXC_WRONG_VALUES);
+        TZ_ASSERT(read_bip32_path(cdata, &key->bip32_path), EXC_WRONG_VALUES);
     }
 
     TZ_ASSERT(cdata->size == cdata->offset, EXC_WRONG_LENGTH);
 
     if (!prompt) {
-        return provide_pubkey(&global.path_with_curve);
+        return provide_pubkey(key);
     } else {
         // INS_PROMPT_PUBLIC_KEY || INS_AUTHORIZE_BAKING
         ui_callback_t cb;
@@ -102,3 +123,62 @@ int handle_get_public_key(buffer_t *cdata,
 end:
     return io_send_apdu_err(exc);
 }
+
+/**
+ * Cdata:
+ *   + Bip32 path: companion key path
+ */
+int handle_authorize_companion_key(buffer_t *cdata, derivation_type_t derivation_type) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
+
+    TZ_ASSERT(g_hwm.baking_key.bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+
+    G.path_with_curve.derivation_type = derivation_type;
+    TZ_ASSERT(read_bip32_path(cdata, &G.path_with_curve.bip32_path), EXC_WRONG_VALUES);
+
+    TZ_ASSERT(cdata->size == cdata->offset, EXC_WRONG_LENGTH);
+
+    return prompt_pubkey(true, companion_ok, reject);
+
+end:
+    return io_send_apdu_err(exc);
+}
+
+#ifdef HAVE_BLS
+int handle_get_proof_of_possession(void) {
+    tz_exc exc = SW_OK;
+    cx_err_t error = CX_OK;
+
+    bip32_path_with_curve_t const *const key = &g_hwm.baking_key;
+
+    TZ_ASSERT(key->bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+    TZ_ASSERT(key->derivation_type == DERIVATION_TYPE_BLS12_381, EXC_WRONG_PARAM);
+
+    // A PIN-locked app does not derive the actual key
+    TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+    uint8_t resp[1u + BLS_PUBLIC_KEY_SIZE + BLS_SIGNATURE_SIZE] = {0};
+    size_t offset = 0;
+
+    cx_ecfp_public_key_t pubkey = {0};
+    CX_CHECK(generate_public_key(&pubkey, key));
+    TZ_ASSERT(pubkey.W_len == BLS_PUBLIC_KEY_SIZE, EXC_MEMORY_ERROR);
+
+    resp[offset] = pubkey.W_len;
+    offset++;
+    memcpy(resp + offset, pubkey.W, pubkey.W_len);
+    offset += pubkey.W_len;
+
+    size_t proof_size = sizeof(resp) - offset;
+    CX_CHECK(generate_bls_proof_of_possession(resp + offset, &proof_size, key));
+    offset += proof_size;
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+
+end:
+    TZ_CONVERT_CX();
+    return io_send_apdu_err(exc);
+}
+#endif
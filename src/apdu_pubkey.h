@@ -36,3 +36,25 @@ int handle_get_public_key(buffer_t *cdata,
                           derivation_type_t derivation_type,
                           bool authorize,
                           bool prompt);
+
+/**
+ * @brief Authorizes a key in addition to the authorized key
+ *
+ *        The user is prompted to confirm the key
+ *
+ * @param cdata: data containing the BIP32 path of the key
+ * @param derivation_type: derivation_type of the key
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_authorize_companion_key(buffer_t *cdata, derivation_type_t derivation_type);
+
+#ifdef HAVE_BLS
+/**
+ * @brief Gets the public key of the authorized key with its proof of possession
+ *
+ *        The authorized key must be a BLS12-381 key
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_get_proof_of_possession(void);
+#endif
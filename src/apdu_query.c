@@ -26,9 +26,11 @@
 #include "baking_auth.h"
 #include "bip32.h"
 #include "globals.h"
+#include "keys.h"
 #include "os_cx.h"
 #include "to_string.h"
 #include "ui.h"
+#include "version.h"
 #include "write.h"
 
 #include <string.h>
@@ -55,6 +57,46 @@ int handle_query_all_hwm(void) {
     return io_send_response_pointer(resp, offset, SW_OK);
 }
 
+int handle_query_nvram_stats(void) {
+    uint8_t resp[2u * sizeof(uint32_t)] = {0};
+    size_t offset = 0;
+
+    write_u32_be(resp, offset, global.nvram_stats.performed_writes);
+    offset += sizeof(uint32_t);
+
+    write_u32_be(resp, offset, global.nvram_stats.skipped_writes);
+    offset += sizeof(uint32_t);
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+}
+
+int handle_query_hwm_table(void) {
+    uint8_t resp[1u + (HWM_CHAIN_SLOTS * 3u * sizeof(uint32_t))] = {0};
+    size_t offset = 1u;
+    uint8_t nb_chains = 0u;
+
+    for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+        chain_high_watermark_t const *const slot = &g_hwm.hwm.chains[i];
+        if (!slot->chain_id.v) {
+            continue;
+        }
+
+        write_u32_be(resp, offset, slot->chain_id.v);
+        offset += sizeof(uint32_t);
+
+        write_u32_be(resp, offset, slot->hwm.highest_level);
+        offset += sizeof(uint32_t);
+
+        write_u32_be(resp, offset, slot->hwm.highest_round);
+        offset += sizeof(uint32_t);
+
+        nb_chains++;
+    }
+    resp[0] = nb_chains;
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+}
+
 int handle_query_main_hwm(void) {
     uint8_t resp[2u * sizeof(uint32_t)] = {0};
     size_t offset = 0;
@@ -115,3 +157,344 @@ int handle_query_auth_key_with_curve(void) {
 end:
     return io_send_apdu_err(exc);
 }
+
+/// Version of the snapshot format
+#define SNAPSHOT_FORMAT_VERSION 1u
+
+/**
+ * @brief Tags of the snapshot entries
+ *
+ */
+typedef enum {
+    SNAPSHOT_TAG_VERSION = 0x01,            ///< app version
+    SNAPSHOT_TAG_COMMIT = 0x02,             ///< git commit
+    SNAPSHOT_TAG_MAIN_CHAIN_ID = 0x03,      ///< main chain id
+    SNAPSHOT_TAG_MAIN_HWM = 0x04,           ///< HWM of main
+    SNAPSHOT_TAG_TEST_HWM = 0x05,           ///< HWM of test
+    SNAPSHOT_TAG_CHAIN_HWM = 0x06,          ///< HWM of a test chain having a slot
+    SNAPSHOT_TAG_HWM_DISABLED = 0x07,       ///< if the HWM is disabled
+    SNAPSHOT_TAG_AUTHORIZED_KEY = 0x08,     ///< authorized key and its curve
+    SNAPSHOT_TAG_PUBLIC_KEY = 0x09,         ///< public key of the authorized key
+    SNAPSHOT_TAG_COMPANION_KEY = 0x0A,      ///< companion key, its curve and its HWM
+    SNAPSHOT_TAG_PERF_INSTRUCTIONS = 0x0B,  ///< number of calls per instruction
+    SNAPSHOT_TAG_PERF_PHASES = 0x0C,        ///< counters per phase
+    SNAPSHOT_TAG_HWM_LEVEL_ONLY = 0x0D,     ///< if the HWM only tracks levels
+    SNAPSHOT_TAG_SIGN_STATS = 0x0E,         ///< signing statistics of a key
+} snapshot_tag_t;
+
+/**
+ * @brief This structure represents the writing of a page of the snapshot
+ *
+ *        The whole snapshot is written, only the bytes of the page are kept
+ *
+ */
+typedef struct {
+    uint8_t page[SNAPSHOT_PAGE_SIZE];  ///< page output
+    size_t start;                      ///< offset of the page in the snapshot
+    size_t offset;                     ///< current offset in the snapshot
+} snapshot_writer_t;
+
+/**
+ * @brief Writes bytes in the snapshot
+ *
+ * @param writer: snapshot writer
+ * @param data: bytes to write
+ * @param size: number of bytes
+ */
+static void snapshot_write(snapshot_writer_t *const writer,
+                           uint8_t const *const data,
+                           size_t const size) {
+    for (size_t i = 0; i < size; i++) {
+        if ((writer->offset >= writer->start) &&
+            (writer->offset < (writer->start + SNAPSHOT_PAGE_SIZE))) {
+            writer->page[writer->offset - writer->start] = data[i];
+        }
+        writer->offset++;
+    }
+}
+
+/**
+ * @brief Writes a TLV entry in the snapshot
+ *
+ * @param writer: snapshot writer
+ * @param tag: tag of the entry
+ * @param value: value of the entry
+ * @param size: size of the value
+ */
+static void snapshot_write_entry(snapshot_writer_t *const writer,
+                                 snapshot_tag_t const tag,
+                                 uint8_t const *const value,
+                                 uint8_t const size) {
+    uint8_t const header[2] = {(uint8_t) tag, size};
+    snapshot_write(writer, header, sizeof(header));
+    snapshot_write(writer, value, size);
+}
+
+/// Size of a serialized HWM
+#define SNAPSHOT_HWM_SIZE ((2u * sizeof(uint32_t)) + 1u)
+
+/// Flags of a serialized HWM
+#define SNAPSHOT_HWM_HAD_ATTESTATION    0x01u
+#define SNAPSHOT_HWM_HAD_PREATTESTATION 0x02u
+
+/**
+ * @brief Serializes a HWM
+ *
+ * @param out: output buffer
+ * @param offset: offset in the output buffer
+ * @param hwm: HWM
+ * @return size_t: offset after the HWM
+ */
+static size_t write_hwm(uint8_t *const out, size_t offset, high_watermark_t const *const hwm) {
+    write_u32_be(out, offset, hwm->highest_level);
+    offset += sizeof(uint32_t);
+
+    write_u32_be(out, offset, hwm->highest_round);
+    offset += sizeof(uint32_t);
+
+    out[offset] = (hwm->had_attestation ? SNAPSHOT_HWM_HAD_ATTESTATION : 0u) |
+                  (hwm->had_preattestation ? SNAPSHOT_HWM_HAD_PREATTESTATION : 0u);
+    offset++;
+
+    return offset;
+}
+
+/**
+ * @brief Serializes a key and its curve
+ *
+ * @param out: output buffer
+ * @param offset: offset in the output buffer
+ * @param key: bip32 path and curve of the key
+ * @return size_t: offset after the key
+ */
+static size_t write_key(uint8_t *const out,
+                        size_t offset,
+                        bip32_path_with_curve_t const *const key) {
+    out[offset] = (uint8_t) unparse_derivation_type(key->derivation_type);
+    offset++;
+
+    out[offset] = key->bip32_path.length;
+    offset++;
+
+    for (uint8_t i = 0; i < key->bip32_path.length; i++) {
+        write_u32_be(out, offset, key->bip32_path.components[i]);
+        offset += sizeof(uint32_t);
+    }
+
+    return offset;
+}
+
+/**
+ * @brief Serializes the signing statistics of a key
+ *
+ * @param out: output buffer
+ * @param key_index: 0 for the authorized key, the companion key slot plus 1 otherwise
+ * @param stats: signing statistics
+ * @return size_t: size of the signing statistics
+ */
+static size_t write_sign_stats(uint8_t *const out,
+                               uint8_t key_index,
+                               sign_stats_t const *const stats) {
+    size_t offset = 0u;
+
+    out[offset] = key_index;
+    offset++;
+
+    for (uint8_t i = 0; i < BAKING_TYPE_COUNT; i++) {
+        write_u32_be(out, offset, stats->signatures[i]);
+        offset += sizeof(uint32_t);
+    }
+
+    write_u32_be(out, offset, stats->last_level);
+    offset += sizeof(uint32_t);
+
+    return offset;
+}
+
+/**
+ * @brief Writes the whole snapshot
+ *
+ * @param writer: snapshot writer
+ */
+static void write_snapshot(snapshot_writer_t *const writer) {
+    uint8_t value[2u + (MAX_BIP32_PATH * sizeof(uint32_t)) + (2u * SNAPSHOT_HWM_SIZE)] = {0};
+    size_t size = 0;
+
+    uint8_t const format_version = SNAPSHOT_FORMAT_VERSION;
+    snapshot_write(writer, &format_version, sizeof(format_version));
+
+    snapshot_write_entry(writer,
+                         SNAPSHOT_TAG_VERSION,
+                         (const uint8_t *) &version,
+                         sizeof(version_t));
+
+    snapshot_write_entry(writer, SNAPSHOT_TAG_COMMIT, (const uint8_t *) &COMMIT, sizeof(COMMIT));
+
+    write_u32_be(value, 0u, g_hwm.main_chain_id.v);
+    snapshot_write_entry(writer, SNAPSHOT_TAG_MAIN_CHAIN_ID, value, sizeof(uint32_t));
+
+    size = write_hwm(value, 0u, &g_hwm.hwm.main);
+    snapshot_write_entry(writer, SNAPSHOT_TAG_MAIN_HWM, value, size);
+
+    size = write_hwm(value, 0u, &g_hwm.hwm.test);
+    snapshot_write_entry(writer, SNAPSHOT_TAG_TEST_HWM, value, size);
+
+    for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+        chain_high_watermark_t const *const slot = &g_hwm.hwm.chains[i];
+        if (!slot->chain_id.v) {
+            continue;
+        }
+        write_u32_be(value, 0u, slot->chain_id.v);
+        size = write_hwm(value, sizeof(uint32_t), &slot->hwm);
+        snapshot_write_entry(writer, SNAPSHOT_TAG_CHAIN_HWM, value, size);
+    }
+
+    value[0] = g_hwm.hwm_disabled ? 1u : 0u;
+    snapshot_write_entry(writer, SNAPSHOT_TAG_HWM_DISABLED, value, 1u);
+
+    value[0] = g_hwm.hwm_level_only ? 1u : 0u;
+    snapshot_write_entry(writer, SNAPSHOT_TAG_HWM_LEVEL_ONLY, value, 1u);
+
+    if (g_hwm.baking_key.bip32_path.length != 0u) {
+        size = write_key(value, 0u, &g_hwm.baking_key);
+        snapshot_write_entry(writer, SNAPSHOT_TAG_AUTHORIZED_KEY, value, size);
+
+        // The public key is only derived once, it is then cached
+        cx_ecfp_public_key_t pubkey = {0};
+        if ((os_global_pin_is_validated() == BOLOS_UX_OK) &&
+            (generate_public_key(&pubkey, &g_hwm.baking_key) == CX_OK)) {
+            snapshot_write_entry(writer, SNAPSHOT_TAG_PUBLIC_KEY, pubkey.W, pubkey.W_len);
+        }
+
+        size = write_sign_stats(value, 0u, &g_hwm.sign_stats);
+        snapshot_write_entry(writer, SNAPSHOT_TAG_SIGN_STATS, value, size);
+    }
+
+    for (uint8_t i = 0; i < MAX_COMPANION_KEYS; i++) {
+        companion_key_t const *const companion = &g_hwm.companion_keys[i];
+        if (companion->key.bip32_path.length == 0u) {
+            continue;
+        }
+        size = write_key(value, 0u, &companion->key);
+        size = write_hwm(value, size, &companion->main);
+        size = write_hwm(value, size, &companion->test);
+        snapshot_write_entry(writer, SNAPSHOT_TAG_COMPANION_KEY, value, size);
+
+        size = write_sign_stats(value, i + 1u, &companion->stats);
+        snapshot_write_entry(writer, SNAPSHOT_TAG_SIGN_STATS, value, size);
+    }
+
+#ifdef HAVE_PERF_COUNTERS
+    uint8_t perf_value[PERF_INS_COUNT * sizeof(uint32_t)] = {0};
+
+    for (uint8_t i = 0; i < PERF_INS_COUNT; i++) {
+        write_u32_be(perf_value, i * sizeof(uint32_t), global.perf_counters.instructions[i]);
+    }
+    snapshot_write_entry(writer,
+                         SNAPSHOT_TAG_PERF_INSTRUCTIONS,
+                         perf_value,
+                         PERF_INS_COUNT * sizeof(uint32_t));
+
+    for (uint8_t i = 0; i < PERF_PHASE_COUNT; i++) {
+        write_u32_be(perf_value,
+                     2u * i * sizeof(uint32_t),
+                     global.perf_counters.phases[i].calls);
+        write_u32_be(perf_value,
+                     ((2u * i) + 1u) * sizeof(uint32_t),
+                     global.perf_counters.phases[i].bytes);
+    }
+    snapshot_write_entry(writer,
+                         SNAPSHOT_TAG_PERF_PHASES,
+                         perf_value,
+                         PERF_PHASE_COUNT * 2u * sizeof(uint32_t));
+#endif
+}
+
+int handle_query_snapshot(uint8_t page_index) {
+    snapshot_writer_t writer = {0};
+    writer.start = page_index * SNAPSHOT_PAGE_SIZE;
+
+    write_snapshot(&writer);
+
+    size_t size = 0;
+    if (writer.offset > writer.start) {
+        size = CUSTOM_MIN(writer.offset - writer.start, SNAPSHOT_PAGE_SIZE);
+    }
+
+    return io_send_response_pointer(writer.page, size, SW_OK);
+}
+
+/// Size of a checked baking data: chain id, level, round and baking type
+#define CHECKED_BAKING_DATA_SIZE ((3u * sizeof(uint32_t)) + 1u)
+
+/// Results of the check of a baking data
+#define CHECK_AUTHORIZED 0x00u
+#define CHECK_REFUSED    0x01u
+
+/**
+ * Cdata:
+ *   + Bip32 path: key path, empty for the authorized key
+ *   + n * checked baking data:
+ *     + (4 bytes) uint32: chain id
+ *     + (4 bytes) uint32: level
+ *     + (4 bytes) uint32: round
+ *     + (1 byte)  uint8: baking type
+ */
+int handle_check_authorization(buffer_t *cdata, derivation_type_t derivation_type) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
+
+    bip32_path_with_curve_t key = {0};
+
+    uint8_t path_length = 0;
+    TZ_ASSERT(buffer_read_u8(cdata, &path_length), EXC_WRONG_VALUES);
+
+    if (path_length == 0u) {
+        TZ_ASSERT(g_hwm.baking_key.bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+        TZ_ASSERT(copy_bip32_path_with_curve(&key, &g_hwm.baking_key), EXC_WRONG_LENGTH);
+    } else {
+        TZ_ASSERT(derivation_type != DERIVATION_TYPE_UNSET, EXC_WRONG_PARAM);
+        TZ_ASSERT(
+            buffer_read_bip32_path(cdata, key.bip32_path.components, (size_t) path_length),
+            EXC_WRONG_VALUES);
+        key.bip32_path.length = path_length;
+        key.derivation_type = derivation_type;
+    }
+
+    size_t const remaining = cdata->size - cdata->offset;
+    TZ_ASSERT((remaining != 0u) && ((remaining % CHECKED_BAKING_DATA_SIZE) == 0u),
+              EXC_WRONG_LENGTH);
+
+    uint8_t resp[MAX_APDU_SIZE / CHECKED_BAKING_DATA_SIZE] = {0};
+    size_t offset = 0;
+
+    while (cdata->offset < cdata->size) {
+        TZ_ASSERT(offset < sizeof(resp), EXC_WRONG_LENGTH);
+
+        // Only the tenderbake consensus can be signed
+        parsed_baking_data_t baking_data = {.is_tenderbake = true};
+        uint8_t type = 0;
+        TZ_ASSERT(buffer_read_u32(cdata, &baking_data.chain_id.v, BE) &&  // chain id
+                      buffer_read_u32(cdata, &baking_data.level, BE) &&   // level
+                      buffer_read_u32(cdata, &baking_data.round, BE) &&   // round
+                      buffer_read_u8(cdata, &type),                       // baking type
+                  EXC_WRONG_LENGTH);
+        TZ_ASSERT(type <= (uint8_t) BAKING_TYPE_PREATTESTATION, EXC_WRONG_VALUES);
+        baking_data.type = (baking_type_t) type;
+
+        // A key that can not bake fails the whole request
+        exc = check_baking_authorized(&baking_data, &key);
+        TZ_ASSERT((exc == SW_OK) || (exc == EXC_WRONG_VALUES) || (exc == EXC_STALE_LEVEL_ROUND),
+                  exc);
+
+        resp[offset] = (exc == SW_OK) ? CHECK_AUTHORIZED : CHECK_REFUSED;
+        offset++;
+        exc = SW_OK;
+    }
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+
+end:
+    return io_send_apdu_err(exc);
+}
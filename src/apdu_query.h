@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include "apdu.h"
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -52,3 +54,45 @@ int handle_query_main_hwm(void);
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
 int handle_query_all_hwm(void);
+
+/**
+ * @brief Get the number of NVRAM writes performed and skipped
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_query_nvram_stats(void);
+
+/**
+ * @brief Get the HWM of every chain having a slot
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_query_hwm_table(void);
+
+/**
+ * @brief Checks if baking data would be signed, without signing them
+ *
+ *        Each baking data is checked independently against the
+ *        current HWM, neither the RAM nor the NVRAM are modified.
+ *        Answers one result per baking data.
+ *
+ * @param cdata: key and baking data to check
+ * @param derivation_type: curve of the key, ignored for the authorized key
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_check_authorization(buffer_t *cdata, derivation_type_t derivation_type);
+
+/// Size of a page of the snapshot
+#define SNAPSHOT_PAGE_SIZE 200u
+
+/**
+ * @brief Get a page of the snapshot of the app state
+ *
+ *        The snapshot is a version byte followed by TLV entries, it
+ *        is sent in pages of `SNAPSHOT_PAGE_SIZE` bytes. The last
+ *        page is shorter than `SNAPSHOT_PAGE_SIZE`, it may be empty.
+ *
+ * @param page_index: index of the page
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_query_snapshot(uint8_t page_index);
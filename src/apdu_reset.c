@@ -24,9 +24,12 @@
 #include "apdu.h"
 #include "baking_auth.h"
 #include "globals.h"
+#include "keys.h"
 #include "ui_reset.h"
 
-#define G global.apdu.u.baking
+#include <string.h>
+
+#define G g_prompt.u.request.u.baking
 
 /**
  * @brief Resets main and test level
@@ -42,11 +45,18 @@ static bool ok(void) {
     g_hwm.hwm.test.highest_level = G.reset_level;
     g_hwm.hwm.test.highest_round = 0;
     g_hwm.hwm.test.had_attestation = false;
+    memset(g_hwm.hwm.chains, 0, sizeof(g_hwm.hwm.chains));
+    for (uint8_t i = 0; i < MAX_COMPANION_KEYS; i++) {
+        g_hwm.companion_keys[i].main = g_hwm.hwm.main;
+        g_hwm.companion_keys[i].test = g_hwm.hwm.test;
+    }
 
     UPDATE_NVRAM;
 
+    clear_baking_key_cache();
+
     // Send back the response, do not restart the event loop
-    io_send_sw(SW_OK);
+    io_send_prompt_response(NULL, 0u, SW_OK);
     return true;
 }
 
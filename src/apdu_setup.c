@@ -23,6 +23,7 @@
 #include "apdu_setup.h"
 
 #include "apdu.h"
+#include "baking_auth.h"
 #include "cx.h"
 #include "globals.h"
 #include "keys.h"
@@ -32,7 +33,11 @@
 
 #include <string.h>
 
-#define G global.apdu.u.setup
+#define G     g_prompt.u.request.u.setup
+#define G_KEY g_prompt.u.request.path_with_curve
+
+/// Options of the HWM, can be combined
+#define SETUP_HWM_LEVEL_ONLY 0x01u  /// the HWM only tracks levels
 
 /**
  * @brief Applies the setup
@@ -42,7 +47,7 @@
  * @return true
  */
 static bool ok(void) {
-    copy_bip32_path_with_curve(&(g_hwm.baking_key), &global.path_with_curve);
+    copy_bip32_path_with_curve(&(g_hwm.baking_key), &G_KEY);
     g_hwm.main_chain_id = G.main_chain_id;
     g_hwm.hwm.main.highest_level = G.hwm.main;
     g_hwm.hwm.main.highest_round = 0;
@@ -52,10 +57,19 @@ static bool ok(void) {
     g_hwm.hwm.test.highest_round = 0;
     g_hwm.hwm.test.had_attestation = false;
     g_hwm.hwm.test.had_preattestation = false;
+    memset(g_hwm.hwm.chains, 0, sizeof(g_hwm.hwm.chains));
+    memset(g_hwm.companion_keys, 0, sizeof(g_hwm.companion_keys));
+    memset(&g_hwm.sign_stats, 0, sizeof(g_hwm.sign_stats));
+    g_hwm.hwm_level_only = G.hwm_level_only;
+
+    clear_baking_key_cache();
+    clear_pubkey_cache();
+    derive_baking_key_data();
 
     UPDATE_NVRAM;
+    invalidate_idle_screen_strings();
 
-    provide_pubkey(&global.path_with_curve);
+    provide_prompt_pubkey(&G_KEY);
 
     return true;
 }
@@ -66,20 +80,28 @@ static bool ok(void) {
  *   + (4 bytes) uint32: main hwm level
  *   + (4 bytes) uint32: test hwm level
  *   + Bip32 path: key path
+ *   + (optional 1 byte) uint8: hwm options, see `SETUP_HWM_*`
  */
 int handle_setup(buffer_t *cdata, derivation_type_t derivation_type) {
     tz_exc exc = SW_OK;
 
     TZ_ASSERT_NOT_NULL(cdata);
 
-    global.path_with_curve.derivation_type = derivation_type;
+    G_KEY.derivation_type = derivation_type;
 
     TZ_ASSERT(buffer_read_u32(cdata, &G.main_chain_id.v, BE) &&  // chain id
                   buffer_read_u32(cdata, &G.hwm.main, BE) &&     // main hwm level
                   buffer_read_u32(cdata, &G.hwm.test, BE) &&     // test hwm level
-                  read_bip32_path(cdata, &global.path_with_curve.bip32_path),
+                  read_bip32_path(cdata, &G_KEY.bip32_path),
               EXC_WRONG_VALUES);
 
+    uint8_t hwm_options = 0u;
+    if (cdata->size != cdata->offset) {
+        TZ_ASSERT(buffer_read_u8(cdata, &hwm_options), EXC_WRONG_LENGTH);
+        TZ_ASSERT((hwm_options & ~SETUP_HWM_LEVEL_ONLY) == 0u, EXC_WRONG_VALUES);
+    }
+    G.hwm_level_only = (hwm_options & SETUP_HWM_LEVEL_ONLY) != 0u;
+
     TZ_ASSERT(cdata->size == cdata->offset, EXC_WRONG_LENGTH);
 
     return prompt_setup(ok, reject);
@@ -91,6 +113,15 @@ end:
 int handle_deauthorize(void) {
     memset(&(g_hwm.baking_key), 0, sizeof(g_hwm.baking_key));
     UPDATE_NVRAM_VAR(baking_key);
+    memset(&g_hwm.baking_key_derived, 0, sizeof(g_hwm.baking_key_derived));
+    UPDATE_NVRAM_VAR(baking_key_derived);
+    memset(g_hwm.companion_keys, 0, sizeof(g_hwm.companion_keys));
+    UPDATE_NVRAM_VAR(companion_keys);
+    memset(&g_hwm.sign_stats, 0, sizeof(g_hwm.sign_stats));
+    UPDATE_NVRAM_VAR(sign_stats);
+    clear_baking_key_cache();
+    clear_pubkey_cache();
+    invalidate_idle_screen_strings();
 #ifdef HAVE_BAGL
     // Ignore calculation errors
     calculate_idle_screen_authorized_key();
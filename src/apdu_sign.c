@@ -29,16 +29,23 @@
 #include "to_string.h"
 #include "ui.h"
 #include "ui_delegation.h"
+#include "write.h"
 
 #include "cx.h"
 
+#include <stddef.h>
 #include <string.h>
 
-#define G global.apdu.u.sign
+/// Flags of the HWM appended to a signature or provided by the host
+#define HWM_FLAG_HAD_ATTESTATION    0x01u
+#define HWM_FLAG_HAD_PREATTESTATION 0x02u
 
-#define B2B_BLOCKBYTES 128u  /// blake2b hash size
+#define G       global.apdu.u.sign
+#define G_OPS   global.apdu.u.sign.message.maybe_ops
+#define G_BATCH global.apdu.u.sign_batch
+#define G_PIPE  global.apdu.u.sign_pipeline
 
-static int perform_signature(bool const send_hash);
+static int perform_signature(void);
 
 /**
  * @brief Initializes the blake2b state if it is not
@@ -66,38 +73,26 @@ end:
 /**
  * @brief Hashes incrementally a buffer using a blake2b state
  *
- *        The hash remains in the buffer, the buffer content length is
- *        updated and the blake2b state is also updated
+ *        The buffer is hashed in place, the blake2b state keeps the
+ *        part of the buffer that does not fill a whole block
  *
  * @param buff: buffer
- * @param buff_size: buffer size
- * @param buff_length: buffer content length
  * @param state: blake2b state
  * @return tz_exc: exception, SW_OK if none
  */
-static tz_exc blake2b_incremental_hash(uint8_t *const buff,
-                                       size_t const buff_size,
-                                       size_t *const buff_length,
+static tz_exc blake2b_incremental_hash(buffer_t const *const buff,
                                        blake2b_hash_state_t *const state) {
     tz_exc exc = SW_OK;
     cx_err_t error = CX_OK;
 
     TZ_ASSERT_NOT_NULL(buff);
-    TZ_ASSERT_NOT_NULL(buff_length);
     TZ_ASSERT_NOT_NULL(state);
 
     TZ_CHECK(conditional_init_hash_state(state));
 
-    uint8_t *current = buff;
-    while (*buff_length > B2B_BLOCKBYTES) {
-        TZ_ASSERT((current - buff) <= (int) buff_size, EXC_MEMORY_ERROR);
+    PERF_COUNT_PHASE(PERF_PHASE_HASH, buff->size);
 
-        CX_CHECK(
-            cx_hash_no_throw((cx_hash_t *) &state->state, 0, current, B2B_BLOCKBYTES, NULL, 0));
-        *buff_length -= B2B_BLOCKBYTES;
-        current += B2B_BLOCKBYTES;
-    }
-    memmove(buff, current, *buff_length);
+    CX_CHECK(cx_hash_no_throw((cx_hash_t *) &state->state, 0, buff->ptr, buff->size, NULL, 0));
 
 end:
     TZ_CONVERT_CX();
@@ -105,71 +100,116 @@ end:
 }
 
 /**
- * @brief Finalizes the hashes of a buffer using a blake2b state
- *
- *        The buffer is modified and the buffer content length is
- *        updated
+ * @brief Finalizes the hash of a message using a blake2b state
  *
- *        The final hash is stored in the ouput, its size is also
- *         stored and the blake2b state is updated
+ *        The buffer holds the last part of the message, or the whole
+ *        message if it has not been hashed incrementally
  *
  * @param out: output buffer
  * @param out_size: output size
- * @param buff: buffer
- * @param buff_size: buffer size
- * @param buff_length: buffer content length
+ * @param buff: buffer containing the end of the message
  * @param state: blake2b state
  * @return tz_exc: exception, SW_OK if none
  */
-static tz_exc blake2b_finish_hash(uint8_t *const out,
+static tz_exc blake2b_hash_buffer(uint8_t *const out,
                                   size_t const out_size,
-                                  uint8_t *const buff,
-                                  size_t const buff_size,
-                                  size_t *const buff_length,
+                                  buffer_t const *const buff,
                                   blake2b_hash_state_t *const state) {
     tz_exc exc = SW_OK;
     cx_err_t error = CX_OK;
 
     TZ_ASSERT_NOT_NULL(out);
     TZ_ASSERT_NOT_NULL(buff);
-    TZ_ASSERT_NOT_NULL(buff_length);
     TZ_ASSERT_NOT_NULL(state);
 
     TZ_CHECK(conditional_init_hash_state(state));
-    TZ_CHECK(blake2b_incremental_hash(buff, buff_size, buff_length, state));
-    CX_CHECK(
-        cx_hash_no_throw((cx_hash_t *) &state->state, CX_LAST, buff, *buff_length, out, out_size));
+    PERF_COUNT_PHASE(PERF_PHASE_HASH_FINISH, buff->size);
+    CX_CHECK(cx_hash_no_throw((cx_hash_t *) &state->state,
+                              CX_LAST,
+                              buff->ptr,
+                              buff->size,
+                              out,
+                              out_size));
+end:
+    TZ_CONVERT_CX();
+    return exc;
+}
+
+#ifdef HAVE_BLS
+/**
+ * @brief Hashes incrementally a buffer to the BLS12-381 curve
+ *
+ *        Only messages signed by a BLS12-381 key are hashed, they are
+ *        signed from this hash rather than from their blake2b hash
+ *
+ * @param buff: buffer
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc bls_incremental_hash(buffer_t const *const buff) {
+    tz_exc exc = SW_OK;
+    cx_err_t error = CX_OK;
+
+    TZ_ASSERT_NOT_NULL(buff);
+
+    if (global.path_with_curve.derivation_type != DERIVATION_TYPE_BLS12_381) {
+        goto end;
+    }
+
+    if (!G.bls_hash_state.initialized) {
+        CX_CHECK(bls_hash_init(&G.bls_hash_state, &global.path_with_curve));
+    }
+
+    PERF_COUNT_PHASE(PERF_PHASE_HASH, buff->size);
+
+    CX_CHECK(bls_hash_update(&G.bls_hash_state, buff->ptr, buff->size));
+
 end:
     TZ_CONVERT_CX();
     return exc;
 }
+#endif
 
 /**
  * @brief Allows to clear all data related to signature
  *
+ *        The operation state is only cleared if an operation has been
+ *        read, it is initialized when an operation is read
+ *
  */
 static inline void clear_data(void) {
-    memset(&G, 0, sizeof(G));
+    size_t size = sizeof(G);
+    if (G.magic_byte != MAGIC_BYTE_UNSAFE_OP) {
+        size = offsetof(apdu_sign_state_t, message) + sizeof(G.message.parsed_baking_data);
+    }
+    memset(&G, 0, size);
 }
 
+#ifdef HAVE_BAGL
 /**
- * @brief Sends asynchronously the signature of the read message
+ * @brief Prepares the display for the signature of baking messages
+ *
+ *        To be efficient, the signing needs a low-cost display, and
+ *        the HWM screen is calculated out of the signing path: it is
+ *        only invalidated, as updating it may slow down the next
+ *        signing
  *
- * @return true
  */
-static bool sign_without_hash_ok(void) {
-    perform_signature(false);
-    return true;
+static void prepare_baking_display(void) {
+    // A pending prompt must stay displayed
+    if (!g_prompt.is_pending) {
+        ux_set_low_cost_display_mode(true);
+    }
+    invalidate_idle_screen_hwm();
 }
+#endif
 
 /**
  * @brief Sends asynchronously the signature of the read message
- *        preceded by its hash
  *
  * @return true
  */
-static bool sign_with_hash_ok(void) {
-    perform_signature(true);
+static bool sign_ok(void) {
+    perform_signature();
     return true;
 }
 
@@ -189,46 +229,40 @@ static bool sign_reject(void) {
 /**
  * @brief Carries out final checks before signing
  *
- * @param send_hash: if the message hash is requested
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
-static int baking_sign_complete(bool const send_hash) {
+static int baking_sign_complete(void) {
     tz_exc exc = SW_OK;
     int result = 0;
     switch (G.magic_byte) {
         case MAGIC_BYTE_BLOCK:
         case MAGIC_BYTE_PREATTESTATION:
         case MAGIC_BYTE_ATTESTATION:
-            TZ_CHECK(guard_baking_authorized(&G.parsed_baking_data, &global.path_with_curve));
-#ifdef TARGET_NANOS
-            // To be efficient, the signing needs a low-cost display
-            ux_set_low_cost_display_mode(true);
-#endif
-            result = perform_signature(send_hash);
+            // Already guarded by `handle_sign`, before being hashed
 #ifdef HAVE_BAGL
-            // Ignore calculation errors
-            calculate_idle_screen_hwm();
-            // The HWM screen is not updated to avoid slowing down the
-            // application. Updating the HWM screen may slow down the
-            // next signing.
+            prepare_baking_display();
 #endif
+            result = perform_signature();
             break;
 
         case MAGIC_BYTE_UNSAFE_OP: {
-            TZ_ASSERT(G.maybe_ops.is_valid, EXC_PARSE_ERROR);
+            TZ_ASSERT(G_OPS.is_valid, EXC_PARSE_ERROR);
 
-            switch (G.maybe_ops.v.operation.tag) {
+            // Operations have no HWM
+            TZ_ASSERT((G.response_format & SIGN_RESPONSE_HWM) == 0u, EXC_WRONG_PARAM);
+
+            switch (G_OPS.v.operation.tag) {
                 case OPERATION_TAG_DELEGATION:
                     // Must be self-delegation signed by the *authorized* baking key
                     TZ_ASSERT(
                         bip32_path_with_curve_eq(&global.path_with_curve, &g_hwm.baking_key) &&
                             // ops->signing is generated from G.bip32_path and G.curve
-                            (COMPARE(G.maybe_ops.v.operation.source, G.maybe_ops.v.signing) == 0) &&
-                            (COMPARE(G.maybe_ops.v.operation.destination, G.maybe_ops.v.signing) ==
-                             0),
+                            (COMPARE(G_OPS.v.operation.source, G_OPS.v.signing) == 0) &&
+                            (COMPARE(G_OPS.v.operation.destination, G_OPS.v.signing) == 0),
                         EXC_SECURITY);
-                    ui_callback_t const ok_c = send_hash ? sign_with_hash_ok : sign_without_hash_ok;
-                    result = prompt_delegation(ok_c, sign_reject);
+                    // Only one prompt can be pending
+                    TZ_ASSERT(!g_prompt.is_pending, EXC_PROMPT_PENDING);
+                    result = prompt_delegation(sign_ok, sign_reject);
                     break;
                 case OPERATION_TAG_REVEAL:
                 case OPERATION_TAG_NONE:
@@ -236,9 +270,9 @@ static int baking_sign_complete(bool const send_hash) {
                     TZ_ASSERT(
                         bip32_path_with_curve_eq(&global.path_with_curve, &g_hwm.baking_key) &&
                             // ops->signing is generated from G.bip32_path and G.curve
-                            (COMPARE(G.maybe_ops.v.operation.source, G.maybe_ops.v.signing) == 0),
+                            (COMPARE(G_OPS.v.operation.source, G_OPS.v.signing) == 0),
                         EXC_SECURITY);
-                    result = perform_signature(send_hash);
+                    result = perform_signature();
                     break;
                 default:
                     TZ_FAIL(EXC_SECURITY);
@@ -279,21 +313,59 @@ end:
 
 /**
  * Cdata:
+ *   + Bip32 path: signing key path, empty for the authorized key
+ *   + (9 bytes, if `with_host_hwm`): HWM of the host
  *   + (max-size) uint8 *: message
  */
-int handle_sign(buffer_t *cdata, const bool last, const bool with_hash) {
+int handle_sign_with_key(buffer_t *cdata,
+                         derivation_type_t derivation_type,
+                         bool last,
+                         uint8_t response_format,
+                         bool with_host_hwm) {
     tz_exc exc = SW_OK;
 
     TZ_ASSERT_NOT_NULL(cdata);
 
-    TZ_ASSERT(global.path_with_curve.bip32_path.length != 0u, EXC_WRONG_LENGTH_FOR_INS);
+    clear_data();
 
-    // Guard against overflow
-    TZ_ASSERT(G.packet_index < 0xFFu, EXC_PARSE_ERROR);
-    G.packet_index++;
+    uint8_t path_length = 0;
+    TZ_ASSERT(buffer_read_u8(cdata, &path_length), EXC_WRONG_VALUES);
+
+    if (path_length == 0u) {
+        TZ_ASSERT(g_hwm.baking_key.bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+        TZ_ASSERT(copy_bip32_path_with_curve(&global.path_with_curve, &g_hwm.baking_key),
+                  EXC_WRONG_LENGTH);
+    } else {
+        TZ_ASSERT(derivation_type != DERIVATION_TYPE_UNSET, EXC_WRONG_PARAM);
+        TZ_ASSERT(buffer_read_bip32_path(cdata,
+                                         global.path_with_curve.bip32_path.components,
+                                         (size_t) path_length),
+                  EXC_WRONG_VALUES);
+        global.path_with_curve.bip32_path.length = path_length;
+        global.path_with_curve.derivation_type = derivation_type;
+    }
+
+    // The message starts right after the key
+    buffer_t message = {.ptr = cdata->ptr + cdata->offset,
+                        .size = cdata->size - cdata->offset,
+                        .offset = 0u};
 
-    // Only parse a single packet when baking
-    TZ_ASSERT(G.packet_index == 1u, EXC_PARSE_ERROR);
+    return handle_sign(&message, last, response_format, with_host_hwm);
+
+end:
+    return io_send_apdu_err(exc);
+}
+
+/**
+ * @brief Parses the first packet of a message to sign
+ *
+ *        Baking messages must be entirely contained in this packet
+ *
+ * @param cdata: first packet of the message
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc parse_first_packet(buffer_t *cdata) {
+    tz_exc exc = SW_OK;
 
     TZ_ASSERT(buffer_read_u8(cdata, &G.magic_byte), EXC_PARSE_ERROR);
     bool is_attestation = false;
@@ -301,99 +373,615 @@ int handle_sign(buffer_t *cdata, const bool last, const bool with_hash) {
     switch (G.magic_byte) {
         case MAGIC_BYTE_PREATTESTATION:
             is_attestation = false;
-            TZ_ASSERT(parse_consensus_operation(cdata, &G.parsed_baking_data, is_attestation),
-                      EXC_PARSE_ERROR);
+            TZ_ASSERT(
+                parse_consensus_operation(cdata, &G.message.parsed_baking_data, is_attestation),
+                EXC_PARSE_ERROR);
             break;
         case MAGIC_BYTE_ATTESTATION:
             is_attestation = true;
-            TZ_ASSERT(parse_consensus_operation(cdata, &G.parsed_baking_data, is_attestation),
-                      EXC_PARSE_ERROR);
+            TZ_ASSERT(
+                parse_consensus_operation(cdata, &G.message.parsed_baking_data, is_attestation),
+                EXC_PARSE_ERROR);
             break;
         case MAGIC_BYTE_BLOCK:
-            TZ_ASSERT(parse_block(cdata, &G.parsed_baking_data), EXC_PARSE_ERROR);
+            TZ_ASSERT(parse_block(cdata, &G.message.parsed_baking_data), EXC_PARSE_ERROR);
             break;
         case MAGIC_BYTE_UNSAFE_OP:
             // Parse the operation. It will be verified in `baking_sign_complete`.
-            TZ_CHECK(parse_operations(cdata, &G.maybe_ops.v, &global.path_with_curve));
+            G_OPS.is_valid = false;
+            TZ_CHECK(parse_operations(cdata, &G_OPS.v, &global.path_with_curve));
             break;
         default:
             TZ_FAIL(EXC_PARSE_ERROR);
     }
 
-    // Hash contents of *previous* message (which may be empty).
-    TZ_CHECK(blake2b_incremental_hash(G.message_data,
-                                      sizeof(G.message_data),
-                                      &G.message_data_length,
-                                      &G.hash_state));
+end:
+    return exc;
+}
+
+/**
+ * @brief Reads the HWM provided by the host before a message
+ *
+ *        Cdata:
+ *          + (4 bytes) uint32: level
+ *          + (4 bytes) uint32: round
+ *          + (1 byte) uint8: flags, see `HWM_FLAG_*`
+ *
+ * @param cdata: data starting with the HWM
+ * @param out: HWM output
+ * @return tz_exc: exception, SW_OK if none
+ */
+static tz_exc read_host_hwm(buffer_t *cdata, high_watermark_t *const out) {
+    tz_exc exc = SW_OK;
+    uint8_t flags = 0;
+
+    TZ_ASSERT(buffer_read_u32(cdata, &out->highest_level, BE) &&
+                  buffer_read_u32(cdata, &out->highest_round, BE) &&
+                  buffer_read_u8(cdata, &flags),
+              EXC_WRONG_LENGTH);
+    TZ_ASSERT((flags & ~(HWM_FLAG_HAD_ATTESTATION | HWM_FLAG_HAD_PREATTESTATION)) == 0u,
+              EXC_WRONG_VALUES);
+
+    out->had_attestation = (flags & HWM_FLAG_HAD_ATTESTATION) != 0u;
+    out->had_preattestation = (flags & HWM_FLAG_HAD_PREATTESTATION) != 0u;
+
+end:
+    return exc;
+}
+
+/**
+ * Cdata:
+ *   + (9 bytes, first packet if `with_host_hwm`): HWM of the host
+ *   + (max-size) uint8 *: message
+ *
+ * Data, for the intermediate packets if `SIGN_RESPONSE_ACK` is set:
+ *   + (1 byte) uint8: index of the packet
+ *   + (4 bytes) uint32: number of bytes of the message received so far
+ */
+int handle_sign(buffer_t *cdata,
+                const bool last,
+                uint8_t const response_format,
+                bool const with_host_hwm) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
 
-    TZ_ASSERT(
-        buffer_seek_set(cdata, 0) && buffer_move(cdata,
-                                                 G.message_data + G.message_data_length,
-                                                 sizeof(G.message_data) - G.message_data_length),
-        EXC_PARSE_ERROR);
+    TZ_ASSERT(global.path_with_curve.bip32_path.length != 0u, EXC_WRONG_LENGTH_FOR_INS);
 
-    G.message_data_length += cdata->size;
+    // Guard against overflow
+    TZ_ASSERT(G.packet_index < 0xFFu, EXC_PARSE_ERROR);
+    G.packet_index++;
+
+    if (with_host_hwm) {
+        // Only the first packet of a message carries the HWM of the host
+        TZ_ASSERT(G.packet_index == 1u, EXC_WRONG_PARAM);
+        // Once raised, the HWM in RAM would be stored by the next NVRAM write
+        TZ_ASSERT(g_hwm.hwm_disabled, EXC_WRONG_PARAM);
+        TZ_CHECK(read_host_hwm(cdata, &G.host_hwm));
+        G.with_host_hwm = true;
+
+        // The message, parsed and hashed in place, starts right after it
+        cdata->ptr += cdata->offset;
+        cdata->size -= cdata->offset;
+        cdata->offset = 0u;
+    }
+
+    G.message_size += cdata->size - cdata->offset;
+
+    PERF_COUNT_PHASE(PERF_PHASE_PARSE, cdata->size);
+
+    if (G.packet_index == 1u) {
+        TZ_CHECK(parse_first_packet(cdata));
+        if (G.magic_byte != MAGIC_BYTE_UNSAFE_OP) {
+            // Baking messages are entirely contained in the first packet:
+            // the stale ones are refused before being hashed
+            TZ_CHECK(guard_baking_authorized(&G.message.parsed_baking_data,
+                                             &global.path_with_curve,
+                                             G.with_host_hwm ? &G.host_hwm : NULL));
+        } else {
+            // Operations have no HWM
+            TZ_ASSERT(!with_host_hwm, EXC_WRONG_PARAM);
+        }
+    } else {
+        // Only operations can be sent in several packets, their
+        // parsing resumes where the previous packet stopped
+        TZ_ASSERT(G.magic_byte == MAGIC_BYTE_UNSAFE_OP, EXC_PARSE_ERROR);
+        TZ_CHECK(parse_operations_next(cdata, &G_OPS.v));
+    }
+
+#ifdef HAVE_BLS
+    TZ_CHECK(bls_incremental_hash(cdata));
+#endif
 
+    // The packet is hashed directly from the APDU buffer
     if (last) {
         // Hash contents of *this* message and then get the final hash value.
-        TZ_CHECK(blake2b_incremental_hash(G.message_data,
-                                          sizeof(G.message_data),
-                                          &G.message_data_length,
-                                          &G.hash_state));
-        TZ_CHECK(blake2b_finish_hash(G.final_hash,
-                                     sizeof(G.final_hash),
-                                     G.message_data,
-                                     sizeof(G.message_data),
-                                     &G.message_data_length,
-                                     &G.hash_state));
-
-        G.maybe_ops.is_valid = parse_operations_final(&G.parse_state, &G.maybe_ops.v);
-
-        return baking_sign_complete(with_hash);
-    } else {
+        TZ_CHECK(blake2b_hash_buffer(G.final_hash, sizeof(G.final_hash), cdata, &G.hash_state));
+
+        if (G.magic_byte == MAGIC_BYTE_UNSAFE_OP) {
+            G_OPS.is_valid = parse_operations_final(&G_OPS.parse_state, &G_OPS.v);
+        }
+
+        G.response_format = response_format;
+        return baking_sign_complete();
+    }
+
+    TZ_CHECK(blake2b_incremental_hash(cdata, &G.hash_state));
+
+    if ((response_format & SIGN_RESPONSE_ACK) != 0u) {
+        // Only the progress is kept, the packet has already been parsed and hashed
+        uint8_t resp[sizeof(uint8_t) + sizeof(uint32_t)] = {0};
+        resp[0] = G.packet_index;
+        write_u32_be(resp, sizeof(uint8_t), G.message_size);
+        return io_send_response_pointer(resp, sizeof(resp), SW_OK);
+    }
+
+    return io_send_sw(SW_OK);
+
+end:
+    // Refuse the next packets of this message
+    G.packet_index = 0xFFu;
+    return io_send_apdu_err(exc);
+}
+
+/**
+ * @brief Parses a baking message
+ *
+ * @param buf: input buffer containing the baking message
+ * @param out: baking data output
+ * @return bool: returns false if it is invalid
+ */
+static bool parse_baking_message(buffer_t *buf, parsed_baking_data_t *const out) {
+    magic_byte_t magic_byte;
+
+    PERF_COUNT_PHASE(PERF_PHASE_PARSE, buf->size - buf->offset);
+
+    if (!buffer_read_u8(buf, &magic_byte)) {
+        return false;
+    }
+
+    switch (magic_byte) {
+        case MAGIC_BYTE_PREATTESTATION:
+            return parse_consensus_operation(buf, out, false);
+        case MAGIC_BYTE_ATTESTATION:
+            return parse_consensus_operation(buf, out, true);
+        case MAGIC_BYTE_BLOCK:
+            return parse_block(buf, out);
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Sends the next signatures of the batch
+ *
+ *        Data:
+ *          + list:
+ *            + (1 byte) uint8: signature length
+ *            + (length bytes) uint8 *: signature
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+static int send_batch_signatures(void) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT(global.apdu.sign_batch_in_progress && G_BATCH.is_signed &&
+                  (G_BATCH.u.signatures.next < G_BATCH.size),
+              EXC_REFERENCED_DATA_NOT_FOUND);
+
+    uint8_t resp[SIGN_BATCH_CHUNK_SIZE * (1u + MAX_SIGNATURE_SIZE)] = {0};
+    size_t offset = 0;
+
+    for (uint8_t i = 0;
+         (i < SIGN_BATCH_CHUNK_SIZE) && (G_BATCH.u.signatures.next < G_BATCH.size);
+         i++) {
+        uint8_t const index = G_BATCH.u.signatures.next;
+        uint8_t const size = G_BATCH.u.signatures.sizes[index];
+
+        resp[offset] = size;
+        offset++;
+        memcpy(resp + offset, G_BATCH.u.signatures.values[index], size);
+        offset += size;
+
+        G_BATCH.u.signatures.next++;
+    }
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+
+end:
+    return io_send_apdu_err(exc);
+}
+
+/**
+ * @brief Drops the batch, so that none of its messages can be signed
+ *
+ */
+static void clear_batch(void) {
+    memset(&G_BATCH, 0, sizeof(G_BATCH));
+    global.apdu.sign_batch_in_progress = false;
+}
+
+/**
+ * @brief Checks all the messages of the batch in order, stores the
+ *        resulting HWM and signs them
+ *
+ *        If a message is refused, the HWM is left unchanged, nothing is
+ *        signed and the batch is dropped
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+static int sign_batch(void) {
+    tz_exc exc = SW_OK;
+    cx_err_t error = CX_OK;
+
+    TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+    TZ_ASSERT(G_BATCH.size != 0u, EXC_WRONG_LENGTH);
+
+    high_watermarks_t const previous_hwm = g_hwm.hwm;
+
+    for (uint8_t i = 0; i < G_BATCH.size; i++) {
+        exc = guard_baking_authorized(&G_BATCH.parsed_baking_data[i], &g_hwm.baking_key, NULL);
+        if (exc == SW_OK) {
+            exc = update_high_water_mark(&G_BATCH.parsed_baking_data[i], &g_hwm.baking_key);
+        }
+        if (exc != SW_OK) {
+            g_hwm.hwm = previous_hwm;
+            goto end;
+        }
+    }
+
+    for (uint8_t i = 0; i < G_BATCH.size; i++) {
+        // Only the first commit of each chain writes the NVRAM
+        commit_high_water_mark(G_BATCH.parsed_baking_data[i].chain_id, &g_hwm.baking_key);
+    }
+
+    memset(&G_BATCH.u, 0, sizeof(G_BATCH.u));
+
+    for (uint8_t i = 0; i < G_BATCH.size; i++) {
+        size_t signature_size = sizeof(G_BATCH.u.signatures.values[i]);
+
+        CX_CHECK(sign(G_BATCH.u.signatures.values[i],
+                      &signature_size,
+                      &g_hwm.baking_key,
+                      G_BATCH.final_hashes[i],
+                      sizeof(G_BATCH.final_hashes[i])));
+
+        G_BATCH.u.signatures.sizes[i] = (uint8_t) signature_size;
+        count_signature(&G_BATCH.parsed_baking_data[i], &g_hwm.baking_key);
+    }
+
+    G_BATCH.is_signed = true;
+
+#ifdef HAVE_BAGL
+    prepare_baking_display();
+#endif
+
+    return send_batch_signatures();
+
+end:
+    TZ_CONVERT_CX();
+    clear_batch();
+    return io_send_apdu_err(exc);
+}
+
+/**
+ * Cdata:
+ *   + list:
+ *     + (1 byte) uint8: message length
+ *     + (length bytes) uint8 *: baking message
+ */
+int handle_sign_batch(buffer_t *cdata, bool first, bool last) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
+
+    if (first) {
+        clear_batch();
+        global.apdu.sign_batch_in_progress = true;
+        // The signing context no longer holds the state of a signature
+        memset(&global.path_with_curve, 0, sizeof(global.path_with_curve));
+    }
+
+    // Batches are signed from the blake2b hashes of the messages
+    TZ_ASSERT(g_hwm.baking_key.derivation_type != DERIVATION_TYPE_BLS12_381, EXC_WRONG_PARAM);
+
+    TZ_ASSERT(global.apdu.sign_batch_in_progress && !G_BATCH.is_signed, EXC_WRONG_PARAM);
+
+    while (cdata->offset < cdata->size) {
+        uint8_t length = 0;
+        TZ_ASSERT(buffer_read_u8(cdata, &length), EXC_WRONG_LENGTH);
+        TZ_ASSERT(length <= (cdata->size - cdata->offset), EXC_WRONG_LENGTH);
+        TZ_ASSERT(G_BATCH.size < SIGN_BATCH_MAX_SIZE, EXC_WRONG_LENGTH);
+
+        buffer_t message = {.ptr = cdata->ptr + cdata->offset, .size = length, .offset = 0u};
+
+        TZ_ASSERT(parse_baking_message(&message, &G_BATCH.parsed_baking_data[G_BATCH.size]),
+                  EXC_PARSE_ERROR);
+
+        G_BATCH.u.hash_state.initialized = false;
+        TZ_CHECK(blake2b_hash_buffer(G_BATCH.final_hashes[G_BATCH.size],
+                                     sizeof(G_BATCH.final_hashes[G_BATCH.size]),
+                                     &message,
+                                     &G_BATCH.u.hash_state));
+
+        G_BATCH.size++;
+        TZ_ASSERT(buffer_seek_cur(cdata, length), EXC_WRONG_LENGTH);
+    }
+
+    if (!last) {
         return io_send_sw(SW_OK);
     }
 
+    return sign_batch();
+
+end:
+    // The messages added before the error must not be signed by a later packet
+    clear_batch();
+    return io_send_apdu_err(exc);
+}
+
+int handle_sign_batch_fetch(void) {
+    return send_batch_signatures();
+}
+
+/**
+ * @brief Sends the signature of the last accepted pipelined message
+ *
+ *        The pipeline ends if the status word is not SW_OK
+ *
+ *        Data:
+ *          + (max-size) uint8 *: signature, empty if there is none
+ *
+ * @param sw: status word of the response
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+static int send_pipelined_signature(uint16_t const sw) {
+    uint8_t resp[MAX_SIGNATURE_SIZE] = {0};
+    size_t size = 0u;
+
+    if (G_PIPE.is_signed) {
+        size = G_PIPE.signature_size;
+        memcpy(resp, G_PIPE.signature, size);
+        G_PIPE.is_signed = false;
+    }
+
+    if (sw != SW_OK) {
+        clear_apdu_globals();
+    }
+
+    return io_send_response_pointer(resp, size, sw);
+}
+
+/**
+ * Cdata:
+ *   + (max-size) uint8 *: baking message
+ */
+int handle_sign_pipelined(buffer_t *cdata, bool first) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(cdata);
+
+    if (first) {
+        // Restarting would lose the signature not sent yet, the
+        // pipeline is kept so that it can still be fetched
+        if (global.apdu.sign_pipeline_in_progress && (G_PIPE.is_signed || G_PIPE.is_pending)) {
+            return io_send_apdu_err(EXC_WRONG_PARAM);
+        }
+        memset(&G_PIPE, 0, sizeof(G_PIPE));
+        global.apdu.sign_pipeline_in_progress = true;
+        // The signing context no longer holds the state of a signature
+        memset(&global.path_with_curve, 0, sizeof(global.path_with_curve));
+    }
+
+    TZ_ASSERT(global.apdu.sign_pipeline_in_progress, EXC_WRONG_PARAM);
+
+    // The signature of the previous message failed, it is lost
+    TZ_CHECK(G_PIPE.sign_exc);
+
+    // Pipelined messages are signed from their blake2b hashes
+    TZ_ASSERT(g_hwm.baking_key.derivation_type != DERIVATION_TYPE_BLS12_381, EXC_WRONG_PARAM);
+
+    TZ_ASSERT(parse_baking_message(cdata, &G_PIPE.parsed_baking_data), EXC_PARSE_ERROR);
+
+    // The previous message has already raised the HWM
+    TZ_CHECK(guard_baking_authorized(&G_PIPE.parsed_baking_data, &g_hwm.baking_key, NULL));
+    TZ_CHECK(write_high_water_mark(&G_PIPE.parsed_baking_data, &g_hwm.baking_key));
+
+    buffer_t message = {.ptr = cdata->ptr, .size = cdata->size, .offset = 0u};
+
+    G_PIPE.hash_state.initialized = false;
+    TZ_CHECK(blake2b_hash_buffer(G_PIPE.final_hash,
+                                 sizeof(G_PIPE.final_hash),
+                                 &message,
+                                 &G_PIPE.hash_state));
+
+    G_PIPE.is_pending = true;
+
+#ifdef HAVE_BAGL
+    prepare_baking_display();
+#endif
+
+    return send_pipelined_signature(SW_OK);
+
+end:
+    // The signature of the previous message is not lost with the
+    // refusal of this one
+    return send_pipelined_signature(exc);
+}
+
+int handle_sign_pipelined_fetch(void) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT(global.apdu.sign_pipeline_in_progress, EXC_REFERENCED_DATA_NOT_FOUND);
+
+    TZ_CHECK(G_PIPE.sign_exc);
+
+    TZ_ASSERT(G_PIPE.is_signed, EXC_REFERENCED_DATA_NOT_FOUND);
+
+    // Ends the pipeline once the signature is sent
+    global.apdu.sign_pipeline_in_progress = false;
+
+    return send_pipelined_signature(SW_OK);
+
 end:
     return io_send_apdu_err(exc);
 }
 
+void sign_pipelined_message(void) {
+    tz_exc exc = SW_OK;
+    cx_err_t error = CX_OK;
+
+    if (!global.apdu.sign_pipeline_in_progress || !G_PIPE.is_pending) {
+        return;
+    }
+
+    G_PIPE.is_pending = false;
+
+    TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
+
+    size_t signature_size = sizeof(G_PIPE.signature);
+
+    CX_CHECK(sign(G_PIPE.signature,
+                  &signature_size,
+                  &g_hwm.baking_key,
+                  G_PIPE.final_hash,
+                  sizeof(G_PIPE.final_hash)));
+
+    G_PIPE.signature_size = (uint8_t) signature_size;
+    G_PIPE.is_signed = true;
+    count_signature(&G_PIPE.parsed_baking_data, &g_hwm.baking_key);
+
+end:
+    TZ_CONVERT_CX();
+    G_PIPE.sign_exc = exc;
+}
+
+/// Slots of the HWM appended to a signature
+#define HWM_SLOT_MAIN            0x00u  /// Main chain
+#define HWM_SLOT_TEST            0x01u  /// Test chains without a slot
+#define HWM_SLOT_CHAIN           0x02u  /// Test chain with a slot, added to the slot index
+#define HWM_SLOT_COMPANION_SHIFT 4u     /// Companion key, 1 + its index in the high nibble
+
+/**
+ * @brief Identifies the slot of a HWM
+ *
+ * @param hwm: HWM, selected by `select_hwm_by_key_and_chain`
+ * @return uint8_t: slot of the HWM, see HWM_SLOT_*
+ */
+static uint8_t get_hwm_slot(high_watermark_t const *const hwm) {
+    for (uint8_t i = 0; i < MAX_COMPANION_KEYS; i++) {
+        companion_key_t const *const companion = &g_hwm.companion_keys[i];
+        uint8_t const companion_slot = (uint8_t) ((i + 1u) << HWM_SLOT_COMPANION_SHIFT);
+        if (hwm == &companion->main) {
+            return companion_slot | HWM_SLOT_MAIN;
+        }
+        if (hwm == &companion->test) {
+            return companion_slot | HWM_SLOT_TEST;
+        }
+    }
+
+    for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+        if (hwm == &g_hwm.hwm.chains[i].hwm) {
+            return HWM_SLOT_CHAIN + i;
+        }
+    }
+
+    return (hwm == &g_hwm.hwm.main) ? HWM_SLOT_MAIN : HWM_SLOT_TEST;
+}
+
+/**
+ * @brief Signs the read message with the signing key
+ *
+ *        BLS12-381 keys sign the message hashed to their curve, the
+ *        other keys sign its blake2b hash
+ *
+ * @param out: signature output
+ * @param out_size: output size, updated to the signature size
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t sign_read_message(uint8_t *const out, size_t *out_size) {
+#ifdef HAVE_BLS
+    if (global.path_with_curve.derivation_type == DERIVATION_TYPE_BLS12_381) {
+        return sign_bls_hash(out, out_size, &global.path_with_curve, &G.bls_hash_state);
+    }
+#endif
+    return sign(out, out_size, &global.path_with_curve, G.final_hash, sizeof(G.final_hash));
+}
+
 /**
  * @brief Perfoms the signature of the read message
  *
  *        Fills apdu response with the signature
  *
- *        Precedes the signature with the message hash if requested
+ *        Precedes the signature with the message hash, compacts it
+ *        and follows it with the HWM as requested
  *
- * @param send_hash: if the message hash is requested
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
-static int perform_signature(bool const send_hash) {
+static int perform_signature(void) {
     tz_exc exc = SW_OK;
     cx_err_t error = CX_OK;
 
     TZ_ASSERT(os_global_pin_is_validated() == BOLOS_UX_OK, EXC_SECURITY);
 
-    TZ_CHECK(write_high_water_mark(&G.parsed_baking_data));
+    if (G.magic_byte == MAGIC_BYTE_UNSAFE_OP) {
+        // The baking data shares its state with the operation, an
+        // operation updates the HWM with empty baking data
+        parsed_baking_data_t const no_baking_data = {0};
+        TZ_CHECK(write_high_water_mark(&no_baking_data, &global.path_with_curve));
+    } else {
+        if (G.with_host_hwm) {
+            TZ_CHECK(raise_session_high_water_mark(&G.message.parsed_baking_data,
+                                                   &global.path_with_curve,
+                                                   &G.host_hwm));
+        }
+        TZ_CHECK(write_high_water_mark(&G.message.parsed_baking_data, &global.path_with_curve));
+    }
 
-    uint8_t resp[SIGN_HASH_SIZE + MAX_SIGNATURE_SIZE] = {0};
+    uint8_t resp[SIGN_HASH_SIZE + MAX_SIGNATURE_SIZE + (2u * sizeof(uint32_t)) + 2u] = {0};
     size_t offset = 0;
 
-    if (send_hash) {
+    if ((G.response_format & SIGN_RESPONSE_HASH) != 0u) {
         memcpy(resp + offset, G.final_hash, sizeof(G.final_hash));
         offset += sizeof(G.final_hash);
     }
 
     size_t signature_size = MAX_SIGNATURE_SIZE;
 
-    CX_CHECK(sign(resp + offset,
-                  &signature_size,
-                  &global.path_with_curve,
-                  G.final_hash,
-                  sizeof(G.final_hash)));
+    CX_CHECK(sign_read_message(resp + offset, &signature_size));
+
+    if ((G.response_format & SIGN_RESPONSE_COMPACT) != 0u) {
+        CX_CHECK(compact_signature(resp + offset,
+                                   &signature_size,
+                                   global.path_with_curve.derivation_type));
+    }
 
     offset += signature_size;
 
+    if (G.magic_byte != MAGIC_BYTE_UNSAFE_OP) {
+        count_signature(&G.message.parsed_baking_data, &global.path_with_curve);
+    }
+
+    if ((G.response_format & SIGN_RESPONSE_HWM) != 0u) {
+        high_watermark_t const *const hwm =
+            select_hwm_by_key_and_chain(&global.path_with_curve,
+                                        G.message.parsed_baking_data.chain_id);
+
+        write_u32_be(resp, offset, hwm->highest_level);
+        offset += sizeof(uint32_t);
+
+        write_u32_be(resp, offset, hwm->highest_round);
+        offset += sizeof(uint32_t);
+
+        resp[offset] = (hwm->had_attestation ? HWM_FLAG_HAD_ATTESTATION : 0u) |
+                       (hwm->had_preattestation ? HWM_FLAG_HAD_PREATTESTATION : 0u);
+        offset++;
+
+        resp[offset] = get_hwm_slot(hwm);
+        offset++;
+    }
+
     clear_data();
 
     return io_send_response_pointer(resp, offset, SW_OK);
@@ -23,6 +23,12 @@
 
 #include "apdu.h"
 
+/// Fields of the response of a signature, can be combined
+#define SIGN_RESPONSE_HASH    0x01u  /// the hash of the message precedes the signature
+#define SIGN_RESPONSE_COMPACT 0x02u  /// ECDSA signatures are sent as a 64-byte r || s
+#define SIGN_RESPONSE_HWM     0x04u  /// the HWM of the baking message follows the signature
+#define SIGN_RESPONSE_ACK     0x08u  /// the intermediate packets are answered with the progress
+
 /**
  * @brief Selects the key with which the message will be signed
  *
@@ -32,12 +38,85 @@
  */
 int select_signing_key(buffer_t *cdata, derivation_type_t derivation_type);
 
+/**
+ * @brief Selects the signing key and starts parsing and signing the message
+ *
+ *        An empty BIP32 path selects the authorized key
+ *
+ * @param cdata: data containing the BIP32 path of the key followed by the message to sign
+ * @param derivation_type: derivation_type of the key, ignored for the authorized key
+ * @param last: whether the part of the message is the last one or not
+ * @param response_format: fields of the response, see `SIGN_RESPONSE_*`
+ * @param with_host_hwm: whether the HWM of the host precedes the message or not
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_sign_with_key(buffer_t *cdata,
+                         derivation_type_t derivation_type,
+                         bool last,
+                         uint8_t response_format,
+                         bool with_host_hwm);
+
+/**
+ * @brief Receives a part of a batch of baking messages and signs them all with
+ *        the authorized key once the batch has been fully received
+ *
+ *        Messages are checked against the HWM in order and the HWM is
+ *        stored only once for the whole batch
+ *
+ * @param cdata: data containing the messages of the batch
+ * @param first: whether the part starts a new batch or not
+ * @param last: whether the part is the last one or not
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_sign_batch(buffer_t *cdata, bool first, bool last);
+
+/**
+ * @brief Sends the next signatures of a signed batch
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_sign_batch_fetch(void);
+
+/**
+ * @brief Accepts a pipelined baking message and sends the signature of
+ *        the previous one
+ *
+ *        The message is checked against the HWM and the HWM is stored
+ *        before the message is answered. Its signature is computed by
+ *        `sign_pipelined_message` once the answer is sent, while the
+ *        host sends the next message.
+ *
+ * @param cdata: data containing the baking message
+ * @param first: whether the message starts a new pipeline or not
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_sign_pipelined(buffer_t *cdata, bool first);
+
+/**
+ * @brief Sends the signature of the last pipelined message and ends the pipeline
+ *
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_sign_pipelined_fetch(void);
+
+/**
+ * @brief Computes the signature of the last accepted pipelined message, if any
+ *
+ *        Must be called once the APDU accepting the message is answered
+ */
+void sign_pipelined_message(void);
+
 /**
  * @brief Parse and signs a message
  *
+ *        The HWM of the host, if any, raises the HWM of the signing
+ *        key in RAM before the baking message is checked against it
+ *
  * @param cdata: data containing the message to sign
  * @param last: whether the part of the message is the last one or not
- * @param with_hash: whether the hash of the message is requested or not
+ * @param response_format: fields of the response, see `SIGN_RESPONSE_*`
+ * @param with_host_hwm: whether the HWM of the host precedes the message or not,
+ *                       only for the first part of a baking message
  * @return int: zero or positive integer if success, negative integer otherwise.
  */
-int handle_sign(buffer_t *cdata, bool last, bool with_hash);
+int handle_sign(buffer_t *cdata, bool last, uint8_t response_format, bool with_host_hwm);
@@ -30,6 +30,7 @@
 #include "ui.h"
 
 #include "os_cx.h"
+#include "read.h"
 
 #include <string.h>
 
@@ -37,7 +38,8 @@ bool is_valid_level(level_t lvl) {
     return !(lvl & 0xC0000000);
 }
 
-tz_exc write_high_water_mark(parsed_baking_data_t const *const in) {
+tz_exc update_high_water_mark(parsed_baking_data_t const *const in,
+                              bip32_path_with_curve_t const *const key) {
     tz_exc exc = SW_OK;
 
     TZ_ASSERT_NOT_NULL(in);
@@ -45,9 +47,20 @@ tz_exc write_high_water_mark(parsed_baking_data_t const *const in) {
     TZ_ASSERT(is_valid_level(in->level), EXC_WRONG_VALUES);
 
     // If the chain matches the main chain *or* the main chain is not set, then use 'main' HWM.
-    high_watermark_t *dest = select_hwm_by_chain(in->chain_id);
+    high_watermark_t *dest = select_hwm_by_key_and_chain(key, in->chain_id);
     TZ_ASSERT_NOT_NULL(dest);
 
+    if (g_hwm.hwm_level_only) {
+        // The HWM, and then the NVRAM, only changes once per level
+        if (in->level > dest->highest_level) {
+            dest->highest_level = in->level;
+            dest->highest_round = 0;
+            dest->had_attestation = false;
+            dest->had_preattestation = false;
+        }
+        goto end;
+    }
+
     if ((in->level > dest->highest_level) || (in->round > dest->highest_round)) {
         dest->had_attestation = false;
         dest->had_preattestation = false;
@@ -57,7 +70,197 @@ tz_exc write_high_water_mark(parsed_baking_data_t const *const in) {
     dest->had_attestation |= in->type == BAKING_TYPE_ATTESTATION;
     dest->had_preattestation |= in->type == BAKING_TYPE_PREATTESTATION;
 
-    UPDATE_NVRAM_VAR(hwm);
+end:
+    return exc;
+}
+
+/**
+ * @brief Updates a stored HWM so that it covers a HWM in RAM
+ *
+ * @param stored: stored HWM to update
+ * @param hwm: HWM in RAM
+ * @return bool: false if the stored HWM already covers the HWM in RAM
+ */
+static bool reserve_high_water_mark(high_watermark_t *const stored,
+                                    high_watermark_t const *const hwm) {
+    // Nothing at or above the stored level has been signed, so the
+    // stored HWM still forbids everything signed until now.
+    if (hwm->highest_level < stored->highest_level) {
+        return false;
+    }
+
+    *stored = *hwm;
+    if (HWM_RESERVED_LEVELS != 0u) {
+        stored->highest_level = hwm->highest_level + HWM_RESERVED_LEVELS;
+        stored->highest_round = 0;
+        stored->had_attestation = false;
+        stored->had_preattestation = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Stores a HWM into the NVRAM, in place
+ *
+ *        Only the HWM is written, not the whole NVRAM state
+ *
+ * @param stored_hwm: HWM in NVRAM
+ * @param hwm: HWM in RAM to store
+ * @return bool: false if the stored HWM already covers the HWM in RAM
+ */
+static bool store_high_water_mark(volatile high_watermark_t *const stored_hwm,
+                                  high_watermark_t const *const hwm) {
+    high_watermark_t record;
+    memcpy(&record, (const void *) stored_hwm, sizeof(record));
+
+    if (!reserve_high_water_mark(&record, hwm)) {
+        return false;
+    }
+    update_nvram(stored_hwm, &record, sizeof(record));
+    return true;
+}
+
+/**
+ * @brief Stores the HWM of a companion key into the NVRAM
+ *
+ * @param companion: companion key
+ * @param hwm: HWM of the companion key to store
+ */
+static void commit_companion_high_water_mark(companion_key_t const *const companion,
+                                             high_watermark_t const *const hwm) {
+    volatile companion_key_t *const stored_companion =
+        &N_data.companion_keys[companion - g_hwm.companion_keys];
+    volatile high_watermark_t *const stored_hwm =
+        (hwm == &companion->main) ? &stored_companion->main : &stored_companion->test;
+
+    if (store_high_water_mark(stored_hwm, hwm)) {
+        // The statistics are only stored along with the HWM
+        update_nvram(&stored_companion->stats, &companion->stats, sizeof(companion->stats));
+    }
+}
+
+void commit_high_water_mark(chain_id_t const chain_id, bip32_path_with_curve_t const *const key) {
+    if (N_data.hwm_disabled) {
+        return;
+    }
+
+    companion_key_t const *const companion = find_companion_key(key);
+    if (companion != NULL) {
+        commit_companion_high_water_mark(companion,
+                                         select_hwm_by_key_and_chain(key, chain_id));
+        return;
+    }
+
+    high_watermark_t const *const hwm = select_hwm_by_chain(chain_id);
+    volatile high_watermark_t *stored_hwm = NULL;
+    volatile chain_high_watermark_t *stored_chain = NULL;
+    if (hwm == &g_hwm.hwm.main) {
+        stored_hwm = &N_data.hwm.main;
+    } else if (hwm == &g_hwm.hwm.test) {
+        stored_hwm = &N_data.hwm.test;
+    } else {
+        for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+            if (hwm == &g_hwm.hwm.chains[i].hwm) {
+                stored_chain = &N_data.hwm.chains[i];
+                stored_hwm = &stored_chain->hwm;
+                break;
+            }
+        }
+    }
+
+    if (stored_hwm == NULL) {
+        return;
+    }
+
+    if (store_high_water_mark(stored_hwm, hwm)) {
+        if (stored_chain != NULL) {
+            // The slot may have just been assigned to the chain
+            update_nvram(&stored_chain->chain_id, &chain_id, sizeof(chain_id));
+        }
+        // The statistics are only stored along with the HWM
+        UPDATE_NVRAM_VAR(sign_stats);
+    }
+}
+
+tz_exc write_high_water_mark(parsed_baking_data_t const *const in,
+                             bip32_path_with_curve_t const *const key) {
+    tz_exc exc = SW_OK;
+
+    TZ_CHECK(update_high_water_mark(in, key));
+
+    commit_high_water_mark(in->chain_id, key);
+
+end:
+    return exc;
+}
+
+void count_signature(parsed_baking_data_t const *const in,
+                     bip32_path_with_curve_t const *const key) {
+    if ((in == NULL) || ((uint8_t) in->type >= BAKING_TYPE_COUNT)) {
+        return;
+    }
+
+    sign_stats_t *stats = &g_hwm.sign_stats;
+    companion_key_t *const companion = find_companion_key(key);
+    if (companion != NULL) {
+        stats = &companion->stats;
+    }
+
+    stats->signatures[in->type]++;
+    stats->last_level = in->level;
+}
+
+/**
+ * @brief Raises a HWM so that it covers another HWM
+ *
+ * @param dest: HWM to raise
+ * @param src: HWM to cover
+ * @return bool: false if `dest` already covers `src`
+ */
+static bool raise_high_water_mark(high_watermark_t *const dest,
+                                  high_watermark_t const *const src) {
+    if ((src->highest_level < dest->highest_level) ||
+        ((src->highest_level == dest->highest_level) &&
+         (src->highest_round < dest->highest_round))) {
+        return false;
+    }
+
+    if ((src->highest_level == dest->highest_level) &&
+        (src->highest_round == dest->highest_round)) {
+        bool const raised = (src->had_attestation && !dest->had_attestation) ||
+                            (src->had_preattestation && !dest->had_preattestation);
+        dest->had_attestation |= src->had_attestation;
+        dest->had_preattestation |= src->had_preattestation;
+        return raised;
+    }
+
+    *dest = *src;
+    return true;
+}
+
+tz_exc import_high_water_marks(high_watermark_t const *const main,
+                               high_watermark_t const *const test) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(main);
+    TZ_ASSERT_NOT_NULL(test);
+
+    TZ_ASSERT(is_valid_level(main->highest_level) && is_valid_level(test->highest_level),
+              EXC_WRONG_VALUES);
+
+    bool const main_raised = raise_high_water_mark(&g_hwm.hwm.main, main);
+    bool const test_raised = raise_high_water_mark(&g_hwm.hwm.test, test);
+    if (!main_raised && !test_raised) {
+        goto end;
+    }
+    invalidate_idle_screen_strings();
+
+    if (N_data.hwm_disabled) {
+        goto end;
+    }
+
+    store_high_water_mark(&N_data.hwm.main, &g_hwm.hwm.main);
+    store_high_water_mark(&N_data.hwm.test, &g_hwm.hwm.test);
 
 end:
     return exc;
@@ -76,8 +279,83 @@ tz_exc authorize_baking(derivation_type_t const derivation_type,
         g_hwm.baking_key.derivation_type = derivation_type;
         copy_bip32_path(&g_hwm.baking_key.bip32_path, bip32_path);
         UPDATE_NVRAM_VAR(baking_key);
+        memset(&g_hwm.sign_stats, 0, sizeof(g_hwm.sign_stats));
+        UPDATE_NVRAM_VAR(sign_stats);
+        invalidate_idle_screen_strings();
+
+        // The authorized key cannot also be a companion key
+        companion_key_t *const companion = find_companion_key(&g_hwm.baking_key);
+        if (companion != NULL) {
+            memset(companion, 0, sizeof(*companion));
+            UPDATE_NVRAM_VAR(companion_keys);
+        }
+        clear_pubkey_cache();
+        // The key will be derived again on the first signature if it fails
+        (void) load_baking_key_cache();
+        derive_baking_key_data();
+        UPDATE_NVRAM_VAR(baking_key_derived);
+    }
+
+end:
+    return exc;
+}
+
+void derive_baking_key_data(void) {
+    baking_key_derived_t *const derived = &g_hwm.baking_key_derived;
+
+    memset(derived, 0, sizeof(*derived));
+
+    // A PIN-locked app does not derive the actual key
+    if ((g_hwm.baking_key.bip32_path.length == 0u) ||
+        (os_global_pin_is_validated() != BOLOS_UX_OK)) {
+        return;
+    }
+
+    cx_ecfp_public_key_t compressed_pubkey = {0};
+    if ((generate_public_key_hash(derived->pkh,
+                                  sizeof(derived->pkh),
+                                  &compressed_pubkey,
+                                  &g_hwm.baking_key) != CX_OK) ||
+        (compressed_pubkey.W_len > sizeof(derived->public_key)) ||
+        !copy_bip32_path_with_curve(&derived->key, &g_hwm.baking_key)) {
+        memset(derived, 0, sizeof(*derived));
+        return;
     }
 
+    // Only the compressed key is stored
+    memcpy(derived->public_key, compressed_pubkey.W, compressed_pubkey.W_len);
+    derived->public_key_length = compressed_pubkey.W_len;
+    derived->is_set = true;
+}
+
+tz_exc authorize_companion_key(bip32_path_with_curve_t const *const key) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(key);
+
+    TZ_ASSERT(g_hwm.baking_key.bip32_path.length != 0u, EXC_REFERENCED_DATA_NOT_FOUND);
+    TZ_ASSERT(key->bip32_path.length != 0u, EXC_WRONG_VALUES);
+
+    if (bip32_path_with_curve_eq(key, &g_hwm.baking_key) || (find_companion_key(key) != NULL)) {
+        goto end;
+    }
+
+    companion_key_t *companion = NULL;
+    for (uint8_t i = 0; i < MAX_COMPANION_KEYS; i++) {
+        if (g_hwm.companion_keys[i].key.bip32_path.length == 0u) {
+            companion = &g_hwm.companion_keys[i];
+            break;
+        }
+    }
+    TZ_ASSERT(companion != NULL, EXC_MEMORY_ERROR);
+
+    TZ_ASSERT(copy_bip32_path_with_curve(&companion->key, key), EXC_WRONG_LENGTH);
+    companion->key_hash = hash_bip32_path_with_curve(key);
+    // Nothing signed by the authorized key before can be signed by the companion key
+    companion->main = g_hwm.hwm.main;
+    companion->test = g_hwm.hwm.test;
+    UPDATE_NVRAM_VAR(companion_keys);
+
 end:
     return exc;
 }
@@ -88,67 +366,131 @@ end:
  *        See `doc/signing.md#checks`
  *
  * @param baking_info: baking info
- * @return bool: return true if it has passed checks
+ *        No slot is assigned to the chain of the baking info, so that a
+ *        refused baking info does not use one up
+ *
+ * @param key: key signing the baking info
+ * @param host: HWM provided by the host, covered by the HWM it is checked
+ *        against, NULL if none
+ * @return tz_exc: exception, SW_OK if none, EXC_STALE_LEVEL_ROUND if the HWM
+ *                 forbids the level and round of the baking info
  */
-static bool is_level_authorized(parsed_baking_data_t const *const baking_info) {
-    if (baking_info == NULL) {
-        return false;
-    }
+static tz_exc check_level_authorized(parsed_baking_data_t const *const baking_info,
+                                     bip32_path_with_curve_t const *const key,
+                                     high_watermark_t const *const host) {
+    tz_exc exc = SW_OK;
 
-    if (!is_valid_level(baking_info->level)) {
-        return false;
-    }
+    TZ_ASSERT(baking_info != NULL, EXC_WRONG_VALUES);
 
-    high_watermark_t *const hwm = select_hwm_by_chain(baking_info->chain_id);
-    if (hwm == NULL) {
-        return false;
+    TZ_ASSERT(is_valid_level(baking_info->level), EXC_WRONG_VALUES);
+
+    high_watermark_t const *const found = find_hwm_by_key_and_chain(key, baking_info->chain_id);
+    TZ_ASSERT(found != NULL, EXC_WRONG_VALUES);
+
+    // The HWM of the session is only raised once the baking info is accepted
+    high_watermark_t raised = *found;
+    if (host != NULL) {
+        TZ_ASSERT(is_valid_level(host->highest_level), EXC_WRONG_VALUES);
+        raise_high_water_mark(&raised, host);
     }
+    high_watermark_t const *const hwm = &raised;
 
-    if (!baking_info->is_tenderbake) {
-        return false;
+    TZ_ASSERT(baking_info->is_tenderbake, EXC_WRONG_VALUES);
+
+    if (g_hwm.hwm_level_only) {
+        // The rounds are tracked by the signer, only a level regression is refused
+        TZ_ASSERT(baking_info->level >= hwm->highest_level, EXC_STALE_LEVEL_ROUND);
+        goto end;
     }
 
-    return (baking_info->level > hwm->highest_level) ||
+    bool const above_hwm =
+        (baking_info->level > hwm->highest_level) ||
+
+        ((baking_info->level == hwm->highest_level) &&
+         (baking_info->round > hwm->highest_round)) ||
 
-           ((baking_info->level == hwm->highest_level) &&
-            (baking_info->round > hwm->highest_round)) ||
+        // It is ok to sign an attestation if we have not already signed an attestation for
+        // the level/round
+        ((baking_info->level == hwm->highest_level) &&
+         (baking_info->round == hwm->highest_round) &&
+         (baking_info->type == BAKING_TYPE_ATTESTATION) && !hwm->had_attestation) ||
 
-           // It is ok to sign an attestation if we have not already signed an attestation for
-           // the level/round
-           ((baking_info->level == hwm->highest_level) &&
-            (baking_info->round == hwm->highest_round) &&
-            (baking_info->type == BAKING_TYPE_ATTESTATION) && !hwm->had_attestation) ||
+        // It is ok to sign a preattestation if we have not already signed neither an
+        // attestation nor a preattestation for the level/round
+        ((baking_info->level == hwm->highest_level) &&
+         (baking_info->round == hwm->highest_round) &&
+         (baking_info->type == BAKING_TYPE_PREATTESTATION) && !hwm->had_attestation &&
+         !hwm->had_preattestation);
+    TZ_ASSERT(above_hwm, EXC_STALE_LEVEL_ROUND);
 
-           // It is ok to sign a preattestation if we have not already signed neither an
-           // attestation nor a preattestation for the level/round
-           ((baking_info->level == hwm->highest_level) &&
-            (baking_info->round == hwm->highest_round) &&
-            (baking_info->type == BAKING_TYPE_PREATTESTATION) && !hwm->had_attestation &&
-            !hwm->had_preattestation);
+end:
+    return exc;
 }
 
 /**
  * @brief Checks if a key pass the checks
  *
- * @param derivation_type: curve of the key
- * @param bip32_path: bip32 path of the key
+ *        The key must be the authorized key or a companion key
+ *
+ * @param key: bip32 path and curve of the key
  * @return bool: return true if it has passed checks
  */
-static bool is_path_authorized(derivation_type_t const derivation_type,
-                               bip32_path_t const *const bip32_path) {
-    return (bip32_path != NULL) && (derivation_type != DERIVATION_TYPE_UNSET) &&
-           (derivation_type == g_hwm.baking_key.derivation_type) && (bip32_path->length != 0u) &&
-           bip32_paths_eq(bip32_path, (const bip32_path_t *) &g_hwm.baking_key.bip32_path);
+static bool is_path_authorized(bip32_path_with_curve_t const *const key) {
+    if ((key->derivation_type == DERIVATION_TYPE_UNSET) || (key->bip32_path.length == 0u)) {
+        return false;
+    }
+    return bip32_path_with_curve_eq(key, &g_hwm.baking_key) || (find_companion_key(key) != NULL);
 }
 
 tz_exc guard_baking_authorized(parsed_baking_data_t const *const baking_info,
+                               bip32_path_with_curve_t const *const key,
+                               high_watermark_t const *const host) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(baking_info);
+    TZ_ASSERT_NOT_NULL(key);
+
+    PERF_COUNT_PHASE(PERF_PHASE_GUARD, 0u);
+
+    TZ_ASSERT(is_path_authorized(key), EXC_SECURITY);
+    TZ_CHECK(check_level_authorized(baking_info, key, host));
+
+end:
+    return exc;
+}
+
+tz_exc check_baking_authorized(parsed_baking_data_t const *const baking_info,
                                bip32_path_with_curve_t const *const key) {
     tz_exc exc = SW_OK;
 
     TZ_ASSERT_NOT_NULL(baking_info);
     TZ_ASSERT_NOT_NULL(key);
-    TZ_ASSERT(is_path_authorized(key->derivation_type, &key->bip32_path), EXC_SECURITY);
-    TZ_ASSERT(is_level_authorized(baking_info), EXC_WRONG_VALUES);
+
+    TZ_ASSERT(is_path_authorized(key), EXC_SECURITY);
+    TZ_CHECK(check_level_authorized(baking_info, key, NULL));
+
+end:
+    return exc;
+}
+
+tz_exc raise_session_high_water_mark(parsed_baking_data_t const *const baking_info,
+                                     bip32_path_with_curve_t const *const key,
+                                     high_watermark_t const *const host) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(baking_info);
+    TZ_ASSERT_NOT_NULL(key);
+    TZ_ASSERT_NOT_NULL(host);
+
+    // Only authorized keys have a HWM
+    TZ_ASSERT(is_path_authorized(key), EXC_SECURITY);
+    TZ_ASSERT(is_valid_level(host->highest_level), EXC_WRONG_VALUES);
+
+    high_watermark_t *const hwm = select_hwm_by_key_and_chain(key, baking_info->chain_id);
+    TZ_ASSERT_NOT_NULL(hwm);
+
+    // Even if the HWM is raised, the NVRAM is left untouched
+    raise_high_water_mark(hwm, host);
 
 end:
     return exc;
@@ -159,6 +501,22 @@ end:
 
 #define TENDERBAKE_PROTO_FITNESS_VERSION 2u
 
+/// Offsets in a block, from its chain id
+#define BLOCK_CHAIN_ID_OFFSET 0u
+#define BLOCK_LEVEL_OFFSET    4u
+#define BLOCK_FITNESS_OFFSET  82u  // After the protocol, predecessor, timestamp, pass and hash
+#define BLOCK_FITNESS_DATA    (BLOCK_FITNESS_OFFSET + sizeof(uint32_t))
+
+/// Offsets in a tenderbake fitness, from its first component
+#define FITNESS_TAG_SIZE_OFFSET          0u
+#define FITNESS_TAG_OFFSET               4u
+#define FITNESS_LEVEL_SIZE_OFFSET        5u
+#define FITNESS_LOCKED_ROUND_SIZE_OFFSET 13u
+/// Offsets after the locked round, to be shifted by its size
+#define FITNESS_PRED_ROUND_SIZE_OFFSET   17u
+#define FITNESS_ROUND_SIZE_OFFSET        25u
+#define FITNESS_ROUND_OFFSET             29u
+
 /**
  * Data:
  *   + (4 bytes)  uint32:  chain id of the block
@@ -181,39 +539,93 @@ end:
  *   + (0|4 bytes) None|uint32: locked_round
  *   + (4 bytes)   uint32:      predecessor_round
  *   + (4 bytes)   uint32:      current_round
+ *
+ * The fitness size sets the size of the locked round, so every field
+ * is read at a fixed offset once the size of the block is checked.
  */
 bool parse_block(buffer_t *buf, parsed_baking_data_t *const out) {
-    uint8_t tag;
-    uint32_t size;
-
-    if (!buffer_read_u32(buf, &out->chain_id.v, BE) ||  // chain id
-        !buffer_read_u32(buf, &out->level, BE) ||       // level
-        !buffer_seek_cur(buf, 1) ||                     // ignore protocol number
-        !buffer_seek_cur(buf, 32) ||                    // ignore predecessor hash
-        !buffer_seek_cur(buf, 8) ||                     // ignore timestamp
-        !buffer_seek_cur(buf, 1) ||                     // ignore validation_pass
-        !buffer_seek_cur(buf, 32)                       // ignore hash
-    ) {
+    size_t const size = buf->size - buf->offset;
+    if (size < BLOCK_FITNESS_DATA) {
+        return false;
+    }
+
+    uint8_t const *const data = buf->ptr + buf->offset;
+
+    uint32_t const fitness_size = read_u32_be(data, BLOCK_FITNESS_OFFSET);
+    if (((fitness_size != MINIMUM_FITNESS_SIZE) && (fitness_size != MAXIMUM_FITNESS_SIZE)) ||
+        (size < BLOCK_FITNESS_DATA + fitness_size)) {
         return false;
     }
 
-    // Fitness
-    if (!buffer_read_u32(buf, &size, BE) ||                                    // fitness size
-        ((size != MINIMUM_FITNESS_SIZE) && (size != MAXIMUM_FITNESS_SIZE)) ||  // fitness size check
-        !buffer_read_u32(buf, &size, BE) || (size != 1u) ||                    // tag size
-        !buffer_read_u8(buf, &tag) || (tag != TENDERBAKE_PROTO_FITNESS_VERSION) ||  // tag
-        !buffer_read_u32(buf, &size, BE) || !buffer_seek_cur(buf, size) ||          // ignore level
-        !buffer_read_u32(buf, &size, BE) || !buffer_seek_cur(buf, size) ||  // ignore locked_round
-        !buffer_read_u32(buf, &size, BE) || !buffer_seek_cur(buf, size) ||  // ignore pred_round
-        !buffer_read_u32(buf, &size, BE) || (size != 4u) ||                 // current_round size
-        !buffer_read_u32(buf, &out->round, BE)                              // current_round
-    ) {
+    uint8_t const *const fitness = data + BLOCK_FITNESS_DATA;
+    uint32_t const locked_round_size = fitness_size - MINIMUM_FITNESS_SIZE;
+
+    if ((read_u32_be(fitness, FITNESS_TAG_SIZE_OFFSET) != 1u) ||
+        (fitness[FITNESS_TAG_OFFSET] != TENDERBAKE_PROTO_FITNESS_VERSION) ||
+        (read_u32_be(fitness, FITNESS_LEVEL_SIZE_OFFSET) != sizeof(uint32_t)) ||
+        (read_u32_be(fitness, FITNESS_LOCKED_ROUND_SIZE_OFFSET) != locked_round_size) ||
+        (read_u32_be(fitness, FITNESS_PRED_ROUND_SIZE_OFFSET + locked_round_size) !=
+         sizeof(uint32_t)) ||
+        (read_u32_be(fitness, FITNESS_ROUND_SIZE_OFFSET + locked_round_size) !=
+         sizeof(uint32_t))) {
         return false;
     }
+
+    out->chain_id.v = read_u32_be(data, BLOCK_CHAIN_ID_OFFSET);
+    out->level = read_u32_be(data, BLOCK_LEVEL_OFFSET);
+    out->round = read_u32_be(fitness, FITNESS_ROUND_OFFSET + locked_round_size);
     out->type = BAKING_TYPE_BLOCK;
     out->is_tenderbake = true;
 
-    return true;
+    return buffer_seek_cur(buf, BLOCK_FITNESS_DATA + fitness_size);
+}
+
+/// Offsets in a consensus operation, from its chain id
+#define CONSENSUS_CHAIN_ID_OFFSET 0u
+#define CONSENSUS_TAG_OFFSET      36u  // After the branch
+#define CONSENSUS_LEVEL_OFFSET    39u  // After the slot
+#define CONSENSUS_ROUND_OFFSET    43u
+#define CONSENSUS_SIZE            79u  // After the hash
+
+/// Tags of the consensus operations
+#define CONSENSUS_TAG_PREATTESTATION       20u
+#define CONSENSUS_TAG_ATTESTATION          21u
+#define CONSENSUS_TAG_ATTESTATION_WITH_DAL 23u
+
+/**
+ * @brief This structure represents the layout of a consensus operation
+ *
+ */
+typedef struct {
+    uint8_t tag;          ///< operation tag
+    bool is_attestation;  ///< if it is an attestation or a pre-attestation
+    bool has_dal;         ///< if the DAL content, a natural number, follows
+} consensus_layout_t;
+
+/// Layouts of the consensus operations, one per tag
+static consensus_layout_t const CONSENSUS_LAYOUTS[] = {
+    {CONSENSUS_TAG_PREATTESTATION, false, false},
+    {CONSENSUS_TAG_ATTESTATION, true, false},
+    {CONSENSUS_TAG_ATTESTATION_WITH_DAL, true, true},
+};
+
+/**
+ * @brief Checks that a natural number fills a buffer
+ *
+ * @param nat: natural number, in the zarith encoding
+ * @param size: size of the buffer
+ * @return bool: if the buffer holds exactly one natural number
+ */
+static bool is_nat(uint8_t const *const nat, size_t const size) {
+    if (size == 0u) {
+        return false;
+    }
+    for (size_t i = 0; i < size - 1u; i++) {
+        if ((nat[i] & 0x80u) == 0u) {
+            return false;
+        }
+    }
+    return (nat[size - 1u] & 0x80u) == 0u;
 }
 
 /**
@@ -225,22 +637,42 @@ bool parse_block(buffer_t *buf, parsed_baking_data_t *const out) {
  *   + (4 bytes)  uint32:  level of the related block
  *   + (4 bytes)  uint32:  round of the related block
  *   + (32 bytes) uint8 *: hash of the related block
+ *   + (max-size) uint8 *: DAL content, attestations with DAL only
+ *
+ * The fields are read at fixed offsets. Known layouts, selected by the
+ * operation tag, are consumed as a whole. Other tags and trailing data,
+ * as a later protocol may add, are accepted and left unread as before.
  */
 bool parse_consensus_operation(buffer_t *buf,
                                parsed_baking_data_t *const out,
                                bool is_attestation) {
-    if (!buffer_read_u32(buf, &out->chain_id.v, BE) ||   // chain id
-        !buffer_seek_cur(buf, 32u * sizeof(uint8_t)) ||  // ignore branch
-        !buffer_seek_cur(buf, sizeof(uint8_t)) ||        // ignore tag
-        !buffer_seek_cur(buf, sizeof(uint16_t)) ||       // ignore slot
-        !buffer_read_u32(buf, &out->level, BE) ||        // level
-        !buffer_read_u32(buf, &out->round, BE) ||        // round
-        !buffer_seek_cur(buf, 32u * sizeof(uint8_t))     // ignore hash
-    ) {
+    size_t const size = buf->size - buf->offset;
+    if (size < CONSENSUS_SIZE) {
         return false;
     }
-    out->type = is_attestation ? BAKING_TYPE_ATTESTATION : BAKING_TYPE_PREATTESTATION;
 
+    uint8_t const *const data = buf->ptr + buf->offset;
+
+    out->chain_id.v = read_u32_be(data, CONSENSUS_CHAIN_ID_OFFSET);
+    out->level = read_u32_be(data, CONSENSUS_LEVEL_OFFSET);
+    out->round = read_u32_be(data, CONSENSUS_ROUND_OFFSET);
+    out->type = is_attestation ? BAKING_TYPE_ATTESTATION : BAKING_TYPE_PREATTESTATION;
     out->is_tenderbake = true;
-    return true;
+
+    consensus_layout_t const *layout = NULL;
+    for (size_t i = 0; i < (sizeof(CONSENSUS_LAYOUTS) / sizeof(CONSENSUS_LAYOUTS[0])); i++) {
+        if (CONSENSUS_LAYOUTS[i].tag == data[CONSENSUS_TAG_OFFSET]) {
+            layout = &CONSENSUS_LAYOUTS[i];
+            break;
+        }
+    }
+
+    if ((layout != NULL) && (layout->is_attestation == is_attestation) &&
+        (layout->has_dal ? is_nat(data + CONSENSUS_SIZE, size - CONSENSUS_SIZE)
+                         : (size == CONSENSUS_SIZE))) {
+        return buffer_seek_cur(buf, size);
+    }
+
+    // Lenient parse: only the common fields are read
+    return buffer_seek_cur(buf, CONSENSUS_SIZE);
 }
@@ -29,6 +29,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#ifndef HWM_RESERVED_LEVELS
+/// Number of levels reserved ahead of the HWM stored in NVRAM, see the Makefile
+#define HWM_RESERVED_LEVELS 8u
+#endif
+
 /**
  * @brief Authorizes a key
  *
@@ -39,14 +44,52 @@
 tz_exc authorize_baking(derivation_type_t const derivation_type,
                         bip32_path_t const *const bip32_path);
 
+/**
+ * @brief Derives the data of the authorized key into `baking_key_derived`
+ *
+ *        Only updates the RAM. The data is left unset if there is no
+ *        authorized key or if it cannot be derived.
+ */
+void derive_baking_key_data(void);
+
+/**
+ * @brief Authorizes a key in addition to the authorized key
+ *
+ *        The HWM of the companion key starts from the HWM of the
+ *        authorized key. Does nothing if the key is already
+ *        authorized.
+ *
+ * @param key: bip32 path and curve of the key
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc authorize_companion_key(bip32_path_with_curve_t const *const key);
+
 /**
  * @brief Guards baking info and key pass required checks
  *
+ *        Neither the RAM nor the NVRAM are modified: the HWM of the
+ *        host is only folded into the checked HWM
+ *
  * @param baking_info: baking info to check
  * @param key: key to check
- * @return tz_exc: exception, SW_OK if none
+ * @param host: HWM provided by the host, NULL if none
+ * @return tz_exc: exception, SW_OK if none, EXC_STALE_LEVEL_ROUND if the
+ *                 HWM forbids the level and round of the baking info
  */
 tz_exc guard_baking_authorized(parsed_baking_data_t const *const baking_info,
+                               bip32_path_with_curve_t const *const key,
+                               high_watermark_t const *const host);
+
+/**
+ * @brief Checks baking info and key as `guard_baking_authorized` would
+ *
+ *        Neither the RAM nor the NVRAM are modified
+ *
+ * @param baking_info: baking info to check
+ * @param key: key to check
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc check_baking_authorized(parsed_baking_data_t const *const baking_info,
                                bip32_path_with_curve_t const *const key);
 
 /**
@@ -57,13 +100,87 @@ tz_exc guard_baking_authorized(parsed_baking_data_t const *const baking_info,
  */
 bool is_valid_level(level_t level);
 
+/**
+ * @brief Updates the HWM of a key in RAM with baking info
+ *
+ *        The NVRAM is not updated
+ *
+ * @param in: baking info
+ * @param key: key signing the baking info
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc update_high_water_mark(parsed_baking_data_t const *const in,
+                              bip32_path_with_curve_t const *const key);
+
+/**
+ * @brief Stores the HWM of a chain into the NVRAM
+ *
+ *        `HWM_RESERVED_LEVELS` levels are reserved ahead of the HWM
+ *        when it is stored. The NVRAM is only written if the stored
+ *        HWM stops covering the HWM in RAM.
+ *
+ *        After an abrupt power off, the reserved levels are refused,
+ *        so no message signed before can be signed again.
+ *
+ * @param chain_id: chain id of the HWM
+ * @param key: key of the HWM
+ */
+void commit_high_water_mark(chain_id_t const chain_id, bip32_path_with_curve_t const *const key);
+
 /**
  * @brief Stores baking info into the NVRAM
  *
  * @param in: baking info
+ * @param key: key signing the baking info
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc write_high_water_mark(parsed_baking_data_t const *const in,
+                             bip32_path_with_curve_t const *const key);
+
+/**
+ * @brief Counts a signature in the signing statistics of its key
+ *
+ *        The statistics are only updated in RAM, they are stored in
+ *        the NVRAM along with the next HWM written by
+ *        `commit_high_water_mark`, or when exiting the app
+ *
+ * @param in: signed baking info
+ * @param key: key having signed the baking info
+ */
+void count_signature(parsed_baking_data_t const *const in,
+                     bip32_path_with_curve_t const *const key);
+
+/**
+ * @brief Raises the HWM of a key in RAM with the HWM provided by the host
+ *
+ *        The HWM of the chain of the baking info is never lowered, as
+ *        for an import, and the NVRAM is not updated: the host, which
+ *        tracks its own HWM, keeps the session from regressing below it.
+ *        Only called once the baking info is accepted, as it may assign
+ *        a slot to its chain
+ *
+ * @param baking_info: baking info selecting the chain
+ * @param key: key signing the baking info
+ * @param host: HWM provided by the host
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc raise_session_high_water_mark(parsed_baking_data_t const *const baking_info,
+                                     bip32_path_with_curve_t const *const key,
+                                     high_watermark_t const *const host);
+
+/**
+ * @brief Raises the main and test HWM of the authorized key
+ *
+ *        A HWM is never lowered: it is only raised if the imported
+ *        HWM is ahead, and the attestation flags of a same level and
+ *        round are merged. The raised HWM are stored into the NVRAM.
+ *
+ * @param main: imported HWM of the main chain
+ * @param test: imported HWM of the test chains without a slot
  * @return tz_exc: exception, SW_OK if none
  */
-tz_exc write_high_water_mark(parsed_baking_data_t const *const in);
+tz_exc import_high_water_marks(high_watermark_t const *const main,
+                               high_watermark_t const *const test);
 
 /**
  * @brief Parse a block
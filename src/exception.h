@@ -44,6 +44,8 @@ typedef uint16_t tz_exc;
 #define EXC_SECURITY                  0x6982u
 #define EXC_CLASS                     0x6E00u
 #define EXC_MEMORY_ERROR              0x9200u
+#define EXC_PROMPT_PENDING            0x9101u
+#define EXC_STALE_LEVEL_ROUND         0x9102u
 #define EXC_UNKNOWN_CX_ERR            0x9001u
 
 // Print a tz exception code
@@ -23,6 +23,7 @@
 #include "globals.h"
 
 #include "exception.h"
+#include "keys.h"
 #include "to_string.h"
 
 #include "ux.h"
@@ -39,7 +40,18 @@
 globals_t global;
 
 void clear_apdu_globals(void) {
-    memset(&global.apdu, 0, sizeof(global.apdu));
+    switch (global.apdu.flow) {
+        case APDU_FLOW_SIGN:
+            memset(&global.apdu.u, 0, sizeof(global.apdu.u));
+            global.apdu.sign_batch_in_progress = false;
+            global.apdu.sign_pipeline_in_progress = false;
+            break;
+        case APDU_FLOW_HMAC:
+            explicit_bzero(&global.apdu.hmac, sizeof(global.apdu.hmac));
+            break;
+        default:
+            break;
+    }
 }
 
 void init_globals(void) {
@@ -49,7 +61,23 @@ void init_globals(void) {
 
 void toggle_hwm(void) {
     g_hwm.hwm_disabled = !(g_hwm.hwm_disabled);
-    UPDATE_NVRAM;  // Update the NVRAM data.
+    if (g_hwm.hwm_disabled) {
+        // Only the setting is written, the HWM is kept in RAM from now on
+        update_nvram(&N_data.hwm_disabled, &g_hwm.hwm_disabled, sizeof(g_hwm.hwm_disabled));
+    } else {
+        // The HWM raised in RAM while disabled is stored again
+        UPDATE_NVRAM;
+    }
+}
+
+void update_nvram(void volatile *dst, void const *src, size_t size) {
+    if (memcmp((const void *) dst, src, size) == 0) {
+        global.nvram_stats.skipped_writes++;
+        return;
+    }
+    nvm_write((void *) dst, (void *) src, size);
+    global.nvram_stats.performed_writes++;
+    PERF_COUNT_PHASE(PERF_PHASE_NVM_WRITE, size);
 }
 
 // DO NOT TRY TO INIT THIS. This can only be written via an system call.
@@ -57,6 +85,85 @@ void toggle_hwm(void) {
 baking_data const N_data_real;
 
 high_watermark_t *select_hwm_by_chain(chain_id_t const chain_id) {
-    return ((chain_id.v == g_hwm.main_chain_id.v) || !g_hwm.main_chain_id.v) ? &g_hwm.hwm.main
-                                                                             : &g_hwm.hwm.test;
+    if ((chain_id.v == g_hwm.main_chain_id.v) || !g_hwm.main_chain_id.v) {
+        return &g_hwm.hwm.main;
+    }
+
+    // Free slots are identified by the chain id 0
+    if (!chain_id.v) {
+        return &g_hwm.hwm.test;
+    }
+
+    chain_high_watermark_t *free_slot = NULL;
+    for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+        chain_high_watermark_t *const slot = &g_hwm.hwm.chains[i];
+        if (slot->chain_id.v == chain_id.v) {
+            return &slot->hwm;
+        }
+        if ((free_slot == NULL) && !slot->chain_id.v) {
+            free_slot = slot;
+        }
+    }
+
+    if (free_slot == NULL) {
+        return &g_hwm.hwm.test;
+    }
+
+    // A new chain starts from the test HWM, so nothing signed on
+    // the test chains before can be signed again.
+    free_slot->chain_id = chain_id;
+    free_slot->hwm = g_hwm.hwm.test;
+    return &free_slot->hwm;
+}
+
+companion_key_t *find_companion_key(bip32_path_with_curve_t const *const key) {
+    if ((key == NULL) || (key->bip32_path.length == 0u)) {
+        return NULL;
+    }
+
+    uint32_t const key_hash = hash_bip32_path_with_curve(key);
+    for (uint8_t i = 0; i < MAX_COMPANION_KEYS; i++) {
+        companion_key_t *const companion = &g_hwm.companion_keys[i];
+        if ((companion->key_hash == key_hash) && (companion->key.bip32_path.length != 0u) &&
+            bip32_path_with_curve_eq(&companion->key, key)) {
+            return companion;
+        }
+    }
+    return NULL;
+}
+
+high_watermark_t *select_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                              chain_id_t const chain_id) {
+    companion_key_t *const companion = find_companion_key(key);
+    if (companion == NULL) {
+        return select_hwm_by_chain(chain_id);
+    }
+    return ((chain_id.v == g_hwm.main_chain_id.v) || !g_hwm.main_chain_id.v) ? &companion->main
+                                                                             : &companion->test;
+}
+
+high_watermark_t const *find_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                                  chain_id_t const chain_id) {
+    bool const is_main = (chain_id.v == g_hwm.main_chain_id.v) || !g_hwm.main_chain_id.v;
+
+    companion_key_t const *const companion = find_companion_key(key);
+    if (companion != NULL) {
+        return is_main ? &companion->main : &companion->test;
+    }
+
+    if (is_main) {
+        return &g_hwm.hwm.main;
+    }
+
+    // Free slots are identified by the chain id 0
+    if (chain_id.v) {
+        for (uint8_t i = 0; i < HWM_CHAIN_SLOTS; i++) {
+            if (g_hwm.hwm.chains[i].chain_id.v == chain_id.v) {
+                return &g_hwm.hwm.chains[i].hwm;
+            }
+        }
+    }
+
+    // A chain without a slot would start from the test HWM
+    return &g_hwm.hwm.test;
 }
@@ -25,15 +25,18 @@
 #include "types.h"
 
 #include "bolos_target.h"
+#include "perf.h"
 
 #include "operations.h"
 #include "ui.h"
 #include "ui_screensaver.h"
 
 /**
- * @brief Zeros out all globals that can keep track of APDU instruction state
+ * @brief Zeros out the APDU context of the flow of the current instruction
  *
- *        Notably this does *not* include UI state
+ *        Notably this does *not* include UI state. The contexts of the
+ *        other flows are kept, so that an instruction failing between
+ *        two packets of a signature does not interrupt the signature.
  *
  */
 void clear_apdu_globals(void);
@@ -49,30 +52,114 @@ void init_globals(void);
  *
  * if its off, the responsibility to track watermark for blocks/attestation signed falls on the
  * signer being used.
+ *
+ * Disabling only writes the setting, enabling stores the HWM raised in RAM meanwhile.
  */
 void toggle_hwm(void);
 
 /// Maximum number of bytes in a single APDU
 #define MAX_APDU_SIZE 235u
 
-/// Our buffer must accommodate any remainder from hashing and the next message at once.
-#define TEZOS_BUFSIZE (BLAKE2B_BLOCKBYTES + MAX_APDU_SIZE)
-
 #define PRIVATE_KEY_DATA_SIZE         64u
 #define MAX_SIGNATURE_SIZE            100u
 #define ELLIPTIC_CURVE_PUB_KEY_LENGTH 65u
 #define PUB_KEY_COMPPRESSED_LENGTH    33u
 
+/**
+ * @brief This structure represents the cache of the authorized key private key
+ *
+ *        Avoids a full derivation from the seed on each baking signature.
+ *        Must be wiped with `clear_baking_key_cache` when no longer needed.
+ */
+typedef struct {
+    bool is_set;                        ///< if the cache holds a derived key
+    bip32_path_with_curve_t key;        ///< bip32 path and curve of the cached key
+    cx_ecfp_private_key_t private_key;  ///< private key derived from `key`
+    signature_type_t signature_type;    ///< signature type of `key`
+#ifdef HAVE_BLS
+    cx_ecfp_384_private_key_t bls_private_key;  ///< private key derived from a BLS12-381 `key`
+    /// hash to curve state of `key` once the message independent prefix is absorbed
+    bls_hash_state_t bls_hash_prefix;
+#endif
+} baking_key_cache_t;
+
+/// Number of public keys kept in the public key cache
+#ifdef TARGET_NANOS
+#define PUBKEY_CACHE_SIZE 2u
+#else
+#define PUBKEY_CACHE_SIZE 3u
+#endif
+
+/**
+ * @brief This structure represents a public key cache entry
+ *
+ */
+typedef struct {
+    bool is_set;                      ///< if the entry holds a public key
+    bool has_hash;                    ///< if `hash` has been computed
+    bip32_path_with_curve_t key;      ///< bip32 path and curve of the cached key
+    cx_ecfp_public_key_t public_key;  ///< public key derived from `key`
+    uint8_t hash[KEY_HASH_SIZE];      ///< public key hash of `public_key`
+} pubkey_cache_entry_t;
+
+#ifdef HAVE_BLS
+/**
+ * @brief This structure represents the cache of the last BLS12-381 proof of possession
+ *
+ */
+typedef struct {
+    bool is_set;                        ///< if the cache holds a proof
+    bip32_path_with_curve_t key;        ///< bip32 path and curve of the proven key
+    uint8_t proof[BLS_SIGNATURE_SIZE];  ///< proof of possession of `key`
+} bls_proof_cache_t;
+#endif
+
+/**
+ * @brief This structure represents the cache of the recently derived public keys
+ *
+ *        Avoids a full derivation from the seed on each public key
+ *        request. The authorized key is never evicted by another key.
+ */
+typedef struct {
+    pubkey_cache_entry_t entries[PUBKEY_CACHE_SIZE];  ///< cached public keys
+    uint8_t next;                                     ///< next entry to be replaced
+#ifdef HAVE_BLS
+    bls_proof_cache_t bls_proof;  ///< last proof of possession
+#endif
+} pubkey_cache_t;
+
+/**
+ * @brief Flows of the APDU instructions
+ *
+ *        Each flow has its own context in `global.apdu`
+ */
+typedef enum {
+    APDU_FLOW_NONE = 0,  ///< instructions keeping no state between APDUs
+    APDU_FLOW_SIGN,      ///< signing instructions, context `global.apdu.u`
+    APDU_FLOW_HMAC,      ///< hmac instructions, context `global.apdu.hmac`
+} apdu_flow_t;
+
 /**
  * @brief This structure represents the state needed to handle HMAC
  *
  */
 typedef struct {
-    uint8_t signed_hmac_key[MAX_SIGNATURE_SIZE];     ///< buffer to hold the signed hmac key
-    uint8_t hashed_signed_hmac_key[CX_SHA512_SIZE];  ///< buffer to hold the hashed signed hmac key
-    uint8_t hmac[CX_SHA256_SIZE];                    ///< buffer to hold the hmac result
+    uint8_t signed_hmac_key[MAX_SIGNATURE_SIZE];  ///< buffer to hold the signed hmac key
 } apdu_hmac_state_t;
 
+/**
+ * @brief This structure represents the cached hmac key of the last key used
+ *
+ *        The hmac key only depends on the key, caching it saves a
+ *        signature per HMAC request. Must be wiped with
+ *        `clear_hmac_key_cache` when no longer needed.
+ */
+typedef struct {
+    bool is_set;                                     ///< if the cache holds an hmac key
+    bip32_path_with_curve_t key;                     ///< key the hmac key is derived from
+    uint8_t hashed_signed_hmac_key[CX_SHA512_SIZE];  ///< hashed signed hmac key
+} hmac_key_cache_t;
+
 /**
  * @brief This structure represents the state needed to hash messages
  *
@@ -89,27 +176,132 @@ typedef struct {
 typedef struct {
     /// 0-index is the initial setup packet, 1 is first packet to hash, etc.
     uint8_t packet_index;
+    uint32_t message_size;  ///< number of bytes of the message received so far
 
-    /// state to hold the current parsed bakind data
-    parsed_baking_data_t parsed_baking_data;
-
-    /// operation read, used for checks
-    struct {
-        bool is_valid;                    ///< if the parsed operation group is considered as valid
-        struct parsed_operation_group v;  ///< current parsed operation group
-    } maybe_ops;
+    magic_byte_t magic_byte;  ///< current magic byte read
+    uint8_t response_format;  ///< fields of the response, see `SIGN_RESPONSE_*`
 
-    /// buffer to hold the current message part and the  previous message hash
-    uint8_t message_data[TEZOS_BUFSIZE];
-    size_t message_data_length;  ///< length of message data
+    bool with_host_hwm;         ///< if the host has provided its HWM
+    high_watermark_t host_hwm;  ///< HWM of the host, raising the HWM once signed
 
     blake2b_hash_state_t hash_state;     ///< current blake2b hash state
     uint8_t final_hash[SIGN_HASH_SIZE];  ///< buffer to hold hash of all the message
-
-    magic_byte_t magic_byte;         ///< current magic byte read
-    struct parse_state parse_state;  ///< current parser state
+#ifdef HAVE_BLS
+    bls_hash_state_t bls_hash_state;  ///< hash to curve state, for BLS12-381 keys only
+#endif
+
+    /// state of the message, depending on `magic_byte`
+    union {
+        /// state to hold the current parsed bakind data
+        parsed_baking_data_t parsed_baking_data;
+
+        /// operation read, used for checks, only initialized for operations
+        struct {
+            bool is_valid;                    ///< if the parsed operation group is valid
+            struct parsed_operation_group v;  ///< current parsed operation group
+            struct parse_state parse_state;   ///< current parser state
+        } maybe_ops;
+    } message;
 } apdu_sign_state_t;
 
+/// Maximum number of baking messages signed in a single batch
+#define SIGN_BATCH_MAX_SIZE 4u
+
+/// Maximum number of signatures sent in a single batch response
+#define SIGN_BATCH_CHUNK_SIZE 2u
+
+/**
+ * @brief This structure represents the state needed to sign a batch of baking messages
+ *
+ */
+typedef struct {
+    uint8_t size;  ///< number of messages received
+
+    /// parsed baking data of each message
+    parsed_baking_data_t parsed_baking_data[SIGN_BATCH_MAX_SIZE];
+    uint8_t final_hashes[SIGN_BATCH_MAX_SIZE][SIGN_HASH_SIZE];  ///< hash of each message
+
+    bool is_signed;  ///< if all the messages have been signed
+
+    union {
+        blake2b_hash_state_t hash_state;  ///< blake2b hash state, used to receive messages
+
+        /// signatures of the messages, used to send the response
+        struct {
+            uint8_t next;                        ///< index of the next signature to send
+            uint8_t sizes[SIGN_BATCH_MAX_SIZE];  ///< size of each signature
+            uint8_t values[SIGN_BATCH_MAX_SIZE][MAX_SIGNATURE_SIZE];  ///< signatures
+        } signatures;
+    } u;
+} apdu_sign_batch_state_t;
+
+/**
+ * @brief This structure represents the state needed to sign pipelined baking messages
+ *
+ *        The signature of a message is computed once its APDU is
+ *        answered and sent with the answer to the next message
+ *
+ */
+typedef struct {
+    bool is_pending;  ///< if a message is accepted and its signature still to be computed
+    bool is_signed;   ///< if the signature of the last accepted message is still to be sent
+    tz_exc sign_exc;  ///< exception raised by the computation of the last signature
+
+    parsed_baking_data_t parsed_baking_data;  ///< parsed baking data of the accepted message
+    blake2b_hash_state_t hash_state;          ///< blake2b hash state, used to receive messages
+    uint8_t final_hash[SIGN_HASH_SIZE];       ///< hash of the accepted message
+
+    uint8_t signature_size;                 ///< size of the signature
+    uint8_t signature[MAX_SIGNATURE_SIZE];  ///< signature of the last accepted message
+} apdu_sign_pipeline_state_t;
+
+/// Maximum size of the response of a prompt
+#define PROMPT_RESPONSE_MAX_SIZE (1u + ELLIPTIC_CURVE_PUB_KEY_LENGTH)
+
+/**
+ * @brief This structure represents the state of the current prompt
+ *
+ *        Kept apart from the apdu state: the APDUs served while an
+ *        asynchronous prompt is pending must not overwrite it.
+ */
+typedef struct {
+    bool is_pending;    ///< if the prompt is waiting for the user
+    bool is_async;      ///< if the prompt response is kept until `INS_PROMPT_RESULT`
+    bool has_response;  ///< if the response of an asynchronous prompt can be fetched
+
+    union {
+        /// request of the prompt, used while the prompt is pending
+        struct {
+            bip32_path_with_curve_t path_with_curve;  ///< bip32 path and curve of the key
+
+            union {
+                /// state used to handle reset
+                struct {
+                    level_t reset_level;  ///< requested reset level
+                } baking;
+
+                /// state used to handle setup
+                struct {
+                    chain_id_t main_chain_id;  ///< requested new main chain id
+                    /// requested new HWM information
+                    struct {
+                        level_t main;  ///< level requested to be set on main HWM
+                        level_t test;  ///< level requested to be set on test HWM
+                    } hwm;
+                    bool hwm_level_only;  ///< if the HWM will only track levels
+                } setup;
+            } u;
+        } request;
+
+        /// response of the prompt, used once the prompt is answered
+        struct {
+            uint16_t sw;                             ///< status word of the response
+            uint8_t size;                            ///< size of the response data
+            uint8_t data[PROMPT_RESPONSE_MAX_SIZE];  ///< response data
+        } response;
+    } u;
+} prompt_state_t;
+
 /**
  * @brief This structure holds all structure needed
  *
@@ -121,47 +313,80 @@ typedef struct {
         ui_callback_t ok_callback;
         /// Callback function if user rejected prompt.
         ui_callback_t cxl_callback;
+        /// State of the current prompt
+        prompt_state_t prompt;
+        /// If the last APDU received is a packet of a signature still to be completed
+        bool sign_in_flight;
 #ifdef HAVE_BAGL
         /// If the low-cost display mode is enabled
         bool low_cost_display_mode;
+        /// Ticks without user interaction on the home screen
+        uint16_t idle_ticks;
+        /// Ticks since the last refresh of the display in low-cost display mode
+        uint8_t refresh_ticks;
         /// Screensaver context
         ux_screensaver_state_t screensaver_state;
-#endif  // TARGET_NANOS
+#endif  // HAVE_BAGL
     } dynamic_display;
 
-    bip32_path_with_curve_t path_with_curve;  ///< holds the bip32 path and curve of the current key
+    bip32_path_with_curve_t path_with_curve;  ///< holds the bip32 path and curve of the signing key
 
-    /// apdu handling state
+    /// apdu handling state, each flow has its own context
     struct {
+        apdu_flow_t flow;  ///< flow of the instruction being handled
+
+        /// context of the signing flow, only overwritten by signing instructions
         union {
-            apdu_sign_state_t sign;  ///< state used to handle signing
+            apdu_sign_state_t sign;                    ///< state used to handle signing
+            apdu_sign_batch_state_t sign_batch;        ///< state used to handle batch signing
+            apdu_sign_pipeline_state_t sign_pipeline;  ///< state used to handle pipelined signing
+        } u;
 
-            /// state used to handle reset
-            struct {
-                level_t reset_level;  ///< requested reset level
-            } baking;
+        /// if `u` holds the state of a batch started by `INS_SIGN_BATCH`
+        bool sign_batch_in_progress;
 
-            /// state used to handle setup
-            struct {
-                chain_id_t main_chain_id;  ///< requested new main chain id
-                /// requested new HWM information
-                struct {
-                    level_t main;  ///< level requested to be set on main HWM
-                    level_t test;  ///< level requested to be set on test HWM
-                } hwm;
-            } setup;
+        /// if `u` holds the state of a pipeline started by `INS_SIGN_PIPELINED`
+        bool sign_pipeline_in_progress;
 
-            apdu_hmac_state_t hmac;  ///< state used to handle hmac
-        } u;
+        apdu_hmac_state_t hmac;  ///< context of the hmac flow
     } apdu;
 
     baking_data hwm_data;  ///< baking HWM data in RAM
+
+    baking_key_cache_t baking_key_cache;  ///< cached private key of the authorized key
+
+    pubkey_cache_t pubkey_cache;  ///< cached public keys
+
+    hmac_key_cache_t hmac_key_cache;  ///< cached hmac key
+
+    /// NVRAM write statistics
+    struct {
+        uint32_t performed_writes;  ///< number of NVRAM writes performed
+        uint32_t skipped_writes;    ///< number of NVRAM writes skipped as unchanged
+    } nvram_stats;
+
+#ifdef HAVE_PERF_COUNTERS
+    perf_counters_t perf_counters;  ///< performance counters
+#endif
 } globals_t;
 
+#ifdef TARGET_NANOS
+/// Budget of `global` in the 4 KiB of RAM of Nano S, the rest is left to the SDK and the stack
+#define GLOBALS_MAX_SIZE 2048u
+_Static_assert(sizeof(globals_t) <= GLOBALS_MAX_SIZE, "globals_t does not fit in Nano S RAM");
+
+/// Budget of `N_data` on Nano S, written as a whole by `UPDATE_NVRAM`
+#define NVRAM_DATA_MAX_SIZE 512u
+_Static_assert(sizeof(baking_data) <= NVRAM_DATA_MAX_SIZE,
+               "baking_data does not fit in Nano S NVRAM");
+#endif
+
 extern globals_t global;
 
 #define g_hwm global.hwm_data
 
+#define g_prompt global.dynamic_display.prompt
+
 extern baking_data const N_data_real;
 #define N_data (*(volatile baking_data *) PIC(&N_data_real))
 
@@ -170,27 +395,77 @@ extern baking_data const N_data_real;
  *
  *        Selects the main HWM of the ram if the main chain of the ram
  *        is not defined, or if the given chain matches the main chain
- *        of the ram. Selects the test HWM of the ram otherwise.
+ *        of the ram. Otherwise, selects the HWM of the slot of the
+ *        chain, a free slot is assigned to the chain if it has none
+ *        yet. Selects the test HWM of the ram if there is no free slot.
  *
  * @param chain_id: chain id
  * @return high_watermark_t*: selected HWM
  */
 high_watermark_t *select_hwm_by_chain(chain_id_t const chain_id);
 
+/**
+ * @brief Finds a companion key in the ram
+ *
+ *        The hashes of the keys are compared before the keys themselves
+ *
+ * @param key: bip32 path and curve of the key
+ * @return companion_key_t*: companion key found, NULL if the key is not a companion key
+ */
+companion_key_t *find_companion_key(bip32_path_with_curve_t const *const key);
+
+/**
+ * @brief Selects the HWM of a key for a given chain id depending on the ram
+ *
+ *        A companion key uses its own main or test HWM. Any other key
+ *        uses the HWM selected by `select_hwm_by_chain`.
+ *
+ * @param key: bip32 path and curve of the key
+ * @param chain_id: chain id
+ * @return high_watermark_t*: selected HWM
+ */
+high_watermark_t *select_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                              chain_id_t const chain_id);
+
+/**
+ * @brief Finds the HWM of a key for a given chain id depending on the ram
+ *
+ *        Same selection as `select_hwm_by_key_and_chain`, except that
+ *        no slot is assigned to a chain having none: the test HWM,
+ *        from which a new slot would start, is returned instead.
+ *
+ * @param key: bip32 path and curve of the key
+ * @param chain_id: chain id
+ * @return high_watermark_t const*: found HWM
+ */
+high_watermark_t const *find_hwm_by_key_and_chain(bip32_path_with_curve_t const *const key,
+                                                  chain_id_t const chain_id);
+
+/**
+ * @brief Writes data to NVRAM only if it differs from the NVRAM content
+ *
+ *        Counts the performed and skipped writes in `global.nvram_stats`
+ *
+ * @param dst: NVRAM destination
+ * @param src: data to write
+ * @param size: size of the data
+ */
+void update_nvram(void volatile *dst, void const *src, size_t size);
+
 /**
  * @brief Updates a single variable in NVRAM baking_data.
  *
  * @param variable: defines the name of the variable to be updated in NVRAM
  */
-#define UPDATE_NVRAM_VAR(variable)                   \
-    if (!N_data_real.hwm_disabled) {                 \
-        nvm_write((void *) &(N_data.variable),       \
-                  &global.hwm_data.variable,         \
-                  sizeof(global.hwm_data.variable)); \
+#define UPDATE_NVRAM_VAR(variable)                      \
+    if (!N_data_real.hwm_disabled) {                    \
+        update_nvram(&(N_data.variable),                \
+                     &global.hwm_data.variable,         \
+                     sizeof(global.hwm_data.variable)); \
     }
 
 /**
  * @brief Properly updates an entire NVRAM struct to prevent any clobbering of data
  *
  */
-#define UPDATE_NVRAM nvm_write((void *) &(N_data), &global.hwm_data, sizeof(global.hwm_data));
+#define UPDATE_NVRAM update_nvram(&(N_data), &global.hwm_data, sizeof(global.hwm_data))
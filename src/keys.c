@@ -27,6 +27,10 @@
 #include "memory.h"
 #include "types.h"
 
+#ifdef HAVE_BLS
+#include "ox_bls12381.h"
+#endif
+
 #include <stdbool.h>
 #include <string.h>
 
@@ -35,6 +39,28 @@ bool read_bip32_path(buffer_t *buf, bip32_path_t *const out) {
             buffer_read_bip32_path(buf, out->components, (size_t) out->length));
 }
 
+/**
+ * @brief Gets the derivation type of a key
+ *
+ *        An app specialized for a single derivation type refuses the
+ *        keys of the others, its curve dispatch is then resolved at
+ *        compile time
+ *
+ * @param path_with_curve: bip32 path and curve of the key
+ * @return derivation_type_t: derivation type, DERIVATION_TYPE_UNSET if refused
+ */
+static inline derivation_type_t get_derivation_type(
+    bip32_path_with_curve_t const *const path_with_curve) {
+#ifdef SINGLE_DERIVATION_TYPE
+    if (path_with_curve->derivation_type != SINGLE_DERIVATION_TYPE) {
+        return DERIVATION_TYPE_UNSET;
+    }
+    return SINGLE_DERIVATION_TYPE;
+#else
+    return path_with_curve->derivation_type;
+#endif
+}
+
 /**
  * @brief Converts `derivation_type` to `derivation_mode`
  *
@@ -68,25 +94,223 @@ static inline cx_curve_t signature_type_to_cx_curve(signature_type_t const signa
             return CX_CURVE_SECP256R1;
         case SIGNATURE_TYPE_ED25519:
             return CX_CURVE_Ed25519;
+#ifdef HAVE_BLS
+        case SIGNATURE_TYPE_BLS12_381:
+            return CX_CURVE_BLS12_381_G1;
+#endif
         default:
             return CX_CURVE_NONE;
     }
 }
 
-cx_err_t generate_public_key(cx_ecfp_public_key_t *public_key,
-                             bip32_path_with_curve_t const *const path_with_curve) {
-    if ((public_key == NULL) || (path_with_curve == NULL)) {
-        return CX_INVALID_PARAMETER;
+#ifdef HAVE_BLS
+/// Domain separation tag of the BLS12-381 signatures, as in the augmented scheme of Tezos
+static const char BLS_SIG_DST[] = "BLS_SIG_BLS12381G2_XMD:SHA-256_SSWU_RO_AUG_";
+
+/// Domain separation tag of the BLS12-381 proofs of possession
+static const char BLS_POP_DST[] = "BLS_POP_BLS12381G2_XMD:SHA-256_SSWU_RO_POP_";
+
+/// BLS12-381 field modulus
+static const uint8_t BLS_FIELD_MODULUS[] = {
+    0x1a, 0x01, 0x11, 0xea, 0x39, 0x7f, 0xe6, 0x9a, 0x4b, 0x1b, 0xa7, 0xb6, 0x43, 0x4b, 0xac, 0xd7,
+    0x64, 0x77, 0x4b, 0x84, 0xf3, 0x85, 0x12, 0xbf, 0x67, 0x30, 0xd2, 0xa0, 0xf6, 0xb0, 0xf6, 0x24,
+    0x1e, 0xab, 0xff, 0xfe, 0xb1, 0x53, 0xff, 0xff, 0xb9, 0xfe, 0xff, 0xff, 0xff, 0xff, 0xaa, 0xab};
+
+#define BLS_SEED_SIZE          64u  // bip32 derivation output
+#define BLS_KEY_GEN_MODE       0u   // derives the private key and its compressed public key
+#define BLS_FIELD_SIZE         sizeof(BLS_FIELD_MODULUS)
+#define BLS_FIELD_ELEMENT_SIZE 64u  // expanded bytes per field element, L = (381 + 128) / 8
+#define BLS_FIELD_ELEMENTS     4u   // two elements of Fp2
+#define BLS_EXPANDED_SIZE      (BLS_FIELD_ELEMENTS * BLS_FIELD_ELEMENT_SIZE)
+#define BLS_HASH_SIZE          (BLS_FIELD_ELEMENTS * BLS_FIELD_SIZE)
+#define SHA256_BLOCK_SIZE      64u
+
+/**
+ * @brief Derives a BLS12-381 private key and its compressed public key
+ *
+ * @param bip32_path: bip32 path of the key
+ * @param private_key: private key output
+ * @param public_key: compressed public key output, of BLS_PUBLIC_KEY_SIZE bytes
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t derive_bls_key(bip32_path_t const *const bip32_path,
+                               cx_ecfp_384_private_key_t *const private_key,
+                               uint8_t *const public_key) {
+    cx_err_t error = CX_OK;
+    uint8_t seed[BLS_SEED_SIZE] = {0};
+
+    CX_CHECK(os_derive_bip32_with_seed_no_throw(HDW_NORMAL,
+                                                CX_CURVE_BLS12_381_G1,
+                                                bip32_path->components,
+                                                bip32_path->length,
+                                                seed,
+                                                NULL,
+                                                NULL,
+                                                0));
+
+    CX_CHECK(cx_bls12381_key_gen(BLS_KEY_GEN_MODE,
+                                 seed,
+                                 sizeof(seed),
+                                 NULL,
+                                 0,
+                                 NULL,
+                                 0,
+                                 private_key,
+                                 public_key,
+                                 BLS_PUBLIC_KEY_SIZE));
+
+end:
+    explicit_bzero(seed, sizeof(seed));
+    return error;
+}
+
+/**
+ * @brief Absorbs the message independent prefix of `expand_message_xmd`
+ *
+ *        The augmented scheme signs the public key followed by the
+ *        message, both preceded by a zero block
+ *
+ * @param state: hash to curve state output
+ * @param public_key: compressed public key of the signing key
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t bls_hash_absorb_prefix(bls_hash_state_t *const state,
+                                       uint8_t const *const public_key) {
+    cx_err_t error = CX_OK;
+    uint8_t const z_pad[SHA256_BLOCK_SIZE] = {0};
+
+    state->initialized = false;
+    CX_CHECK(cx_sha256_init_no_throw(&state->state));
+    CX_CHECK(cx_hash_no_throw((cx_hash_t *) &state->state, 0, z_pad, sizeof(z_pad), NULL, 0));
+    CX_CHECK(
+        cx_hash_no_throw((cx_hash_t *) &state->state, 0, public_key, BLS_PUBLIC_KEY_SIZE, NULL, 0));
+    state->initialized = true;
+
+end:
+    return error;
+}
+
+/**
+ * @brief Absorbs the domain separation tag and its size, and finalizes the hash
+ *
+ * @param state: sha256 state
+ * @param dst: domain separation tag
+ * @param out: hash output, of CX_SHA256_SIZE bytes
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t bls_hash_dst_final(cx_sha256_t *const state,
+                                   char const *const dst,
+                                   uint8_t *const out) {
+    cx_err_t error = CX_OK;
+    uint8_t const dst_size = (uint8_t) strlen(dst);
+
+    CX_CHECK(
+        cx_hash_no_throw((cx_hash_t *) state, 0, (uint8_t const *) dst, dst_size, NULL, 0));
+    CX_CHECK(cx_hash_no_throw((cx_hash_t *) state,
+                              CX_LAST,
+                              &dst_size,
+                              sizeof(dst_size),
+                              out,
+                              CX_SHA256_SIZE));
+
+end:
+    return error;
+}
+
+/**
+ * @brief Finalizes the hash of a message to the field elements signed by BLS12-381
+ *
+ *        Follows `hash_to_field` of RFC 9380 for G2: expands the
+ *        message with `expand_message_xmd` and reduces it to two
+ *        elements of Fp2
+ *
+ * @param state: hash to curve state of the whole message
+ * @param dst: domain separation tag
+ * @param out: field elements output, of BLS_HASH_SIZE bytes
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t bls_hash_to_field(bls_hash_state_t *const state,
+                                  char const *const dst,
+                                  uint8_t *const out) {
+    cx_err_t error = CX_OK;
+    // I2OSP(BLS_EXPANDED_SIZE, 2) || I2OSP(0, 1)
+    uint8_t const size_suffix[] = {(uint8_t) (BLS_EXPANDED_SIZE >> 8u),
+                                   (uint8_t) BLS_EXPANDED_SIZE,
+                                   0x00u};
+    uint8_t b_0[CX_SHA256_SIZE] = {0};
+    uint8_t b_i[CX_SHA256_SIZE] = {0};
+    uint8_t expanded[BLS_EXPANDED_SIZE] = {0};
+    cx_sha256_t hash_state;
+
+    CX_CHECK(cx_hash_no_throw((cx_hash_t *) &state->state,
+                              0,
+                              size_suffix,
+                              sizeof(size_suffix),
+                              NULL,
+                              0));
+    CX_CHECK(bls_hash_dst_final(&state->state, dst, b_0));
+    state->initialized = false;
+
+    for (uint8_t i = 1u; i <= (BLS_EXPANDED_SIZE / CX_SHA256_SIZE); i++) {
+        // b_i = H(strxor(b_0, b_(i-1)) || I2OSP(i, 1) || DST_prime), b_1 = H(b_0 || ...)
+        for (uint8_t j = 0; j < CX_SHA256_SIZE; j++) {
+            b_i[j] ^= b_0[j];
+        }
+        CX_CHECK(cx_sha256_init_no_throw(&hash_state));
+        CX_CHECK(cx_hash_no_throw((cx_hash_t *) &hash_state, 0, b_i, sizeof(b_i), NULL, 0));
+        CX_CHECK(cx_hash_no_throw((cx_hash_t *) &hash_state, 0, &i, sizeof(i), NULL, 0));
+        CX_CHECK(bls_hash_dst_final(&hash_state, dst, b_i));
+        memcpy(expanded + ((i - 1u) * CX_SHA256_SIZE), b_i, sizeof(b_i));
+    }
+
+    for (uint8_t i = 0; i < BLS_FIELD_ELEMENTS; i++) {
+        uint8_t *const element = expanded + (i * BLS_FIELD_ELEMENT_SIZE);
+        CX_CHECK(cx_math_modm_no_throw(element,
+                                       BLS_FIELD_ELEMENT_SIZE,
+                                       BLS_FIELD_MODULUS,
+                                       BLS_FIELD_SIZE));
+        memcpy(out + (i * BLS_FIELD_SIZE),
+               element + (BLS_FIELD_ELEMENT_SIZE - BLS_FIELD_SIZE),
+               BLS_FIELD_SIZE);
     }
 
+end:
+    return error;
+}
+#endif
+
+/**
+ * @brief Derives a public key from a bip32 path and a curve
+ *
+ * @param public_key: public key output
+ * @param path_with_curve: bip32 path and curve
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t derive_public_key(cx_ecfp_public_key_t *public_key,
+                                  bip32_path_with_curve_t const *const path_with_curve) {
     cx_err_t error = CX_OK;
 
     bip32_path_t const *const bip32_path = &path_with_curve->bip32_path;
-    derivation_type_t derivation_type = path_with_curve->derivation_type;
+    derivation_type_t derivation_type = get_derivation_type(path_with_curve);
     unsigned int derivation_mode = derivation_type_to_derivation_mode(derivation_type);
     signature_type_t signature_type = derivation_type_to_signature_type(derivation_type);
     cx_curve_t cx_curve = signature_type_to_cx_curve(signature_type);
 
+    if (derivation_type == DERIVATION_TYPE_UNSET) {
+        return CX_INVALID_PARAMETER;
+    }
+
+#ifdef HAVE_BLS
+    if (signature_type == SIGNATURE_TYPE_BLS12_381) {
+        cx_ecfp_384_private_key_t private_key = {0};
+        public_key->W_len = BLS_PUBLIC_KEY_SIZE;
+        public_key->curve = cx_curve;
+        error = derive_bls_key(bip32_path, &private_key, public_key->W);
+        explicit_bzero(&private_key, sizeof(private_key));
+        return error;
+    }
+#endif
+
     public_key->W_len = ELLIPTIC_CURVE_PUB_KEY_LENGTH;
     public_key->curve = cx_curve;
 
@@ -101,12 +325,150 @@ cx_err_t generate_public_key(cx_ecfp_public_key_t *public_key,
                                                    NULL,
                                                    0));
 
+#ifdef HAVE_EDDSA_KEYS
     // If we're using the old curve, make sure to adjust accordingly.
     if (cx_curve == CX_CURVE_Ed25519) {
         CX_CHECK(
             cx_edwards_compress_point_no_throw(CX_CURVE_Ed25519, public_key->W, public_key->W_len));
         public_key->W_len = PUB_KEY_COMPPRESSED_LENGTH;
     }
+#endif
+
+end:
+    return error;
+}
+
+void clear_pubkey_cache(void) {
+    memset(&global.pubkey_cache, 0, sizeof(global.pubkey_cache));
+}
+
+/**
+ * @brief Finds the public key cache entry of a key
+ *
+ * @param path_with_curve: bip32 path and curve
+ * @return pubkey_cache_entry_t*: entry found, NULL if none
+ */
+static pubkey_cache_entry_t *find_pubkey_cache_entry(
+    bip32_path_with_curve_t const *const path_with_curve) {
+    pubkey_cache_t *const cache = &global.pubkey_cache;
+
+    for (uint8_t i = 0; i < PUBKEY_CACHE_SIZE; i++) {
+        if (cache->entries[i].is_set &&
+            bip32_path_with_curve_eq(&cache->entries[i].key, path_with_curve)) {
+            return &cache->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Adds a public key to the public key cache
+ *
+ *        Replaces the oldest entry, but never the authorized key
+ *
+ * @param path_with_curve: bip32 path and curve
+ * @param public_key: public key derived from `path_with_curve`
+ */
+static void add_pubkey_cache_entry(bip32_path_with_curve_t const *const path_with_curve,
+                                   cx_ecfp_public_key_t const *const public_key) {
+    pubkey_cache_t *const cache = &global.pubkey_cache;
+
+    if (cache->entries[cache->next].is_set &&
+        bip32_path_with_curve_eq(&cache->entries[cache->next].key, &g_hwm.baking_key)) {
+        cache->next = (cache->next + 1u) % PUBKEY_CACHE_SIZE;
+    }
+
+    pubkey_cache_entry_t *const entry = &cache->entries[cache->next];
+    cache->next = (cache->next + 1u) % PUBKEY_CACHE_SIZE;
+
+    memset(entry, 0, sizeof(*entry));
+    copy_bip32_path_with_curve(&entry->key, path_with_curve);
+    memcpy(&entry->public_key, public_key, sizeof(entry->public_key));
+    entry->is_set = true;
+}
+
+/**
+ * @brief Finds the data derived from the authorized key, stored in NVRAM
+ *
+ *        The data is ignored if it does not match the path and the
+ *        curve of the authorized key
+ *
+ * @param path_with_curve: bip32 path and curve
+ * @return baking_key_derived_t const*: data found, NULL if `path_with_curve`
+ *                                      is not the authorized key or if none
+ */
+static baking_key_derived_t const *find_baking_key_derived(
+    bip32_path_with_curve_t const *const path_with_curve) {
+    baking_key_derived_t const *const derived = &g_hwm.baking_key_derived;
+
+    if (!derived->is_set || !bip32_path_with_curve_eq(path_with_curve, &g_hwm.baking_key) ||
+        !bip32_path_with_curve_eq(&derived->key, &g_hwm.baking_key)) {
+        return NULL;
+    }
+
+    return derived;
+}
+
+/**
+ * @brief Gets the public key of the authorized key from its compressed form
+ *
+ *        Only ed25519 and BLS12-381 public keys can be recovered without
+ *        any computation, a compressed secp256k1 or secp256r1 public
+ *        key would have to be decompressed
+ *
+ * @param public_key: public key output
+ * @param derived: data derived from the authorized key
+ * @return bool: if the public key has been recovered
+ */
+static bool recover_public_key(cx_ecfp_public_key_t *const public_key,
+                               baking_key_derived_t const *const derived) {
+    switch (derivation_type_to_signature_type(derived->key.derivation_type)) {
+#ifdef HAVE_EDDSA_KEYS
+        case SIGNATURE_TYPE_ED25519:
+            // Compressed edwards points are prefixed by 0x02
+            public_key->W[0] = 0x02;
+            memcpy(public_key->W + 1, derived->public_key, derived->public_key_length);
+            public_key->W_len = derived->public_key_length + 1u;
+            return true;
+#endif
+#ifdef HAVE_BLS
+        case SIGNATURE_TYPE_BLS12_381:
+            memcpy(public_key->W, derived->public_key, derived->public_key_length);
+            public_key->W_len = derived->public_key_length;
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+cx_err_t generate_public_key(cx_ecfp_public_key_t *public_key,
+                             bip32_path_with_curve_t const *const path_with_curve) {
+    if ((public_key == NULL) || (path_with_curve == NULL)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    // The authorized key is derived once, when it is authorized
+    baking_key_derived_t const *const derived = find_baking_key_derived(path_with_curve);
+    if ((derived != NULL) && recover_public_key(public_key, derived)) {
+        return CX_OK;
+    }
+
+    pubkey_cache_entry_t const *const entry = find_pubkey_cache_entry(path_with_curve);
+    if (entry != NULL) {
+        memcpy(public_key, &entry->public_key, sizeof(*public_key));
+        return CX_OK;
+    }
+
+    cx_err_t error = CX_OK;
+
+    CX_CHECK(derive_public_key(public_key, path_with_curve));
+
+    // A PIN-locked app does not derive the actual key
+    if (os_global_pin_is_validated() == BOLOS_UX_OK) {
+        add_pubkey_cache_entry(path_with_curve, public_key);
+    }
 
 end:
     return error;
@@ -142,11 +504,14 @@ static cx_err_t public_key_hash(uint8_t *const hash_out,
     cx_ecfp_public_key_t compressed = {0};
 
     switch (signature_type) {
+#ifdef HAVE_EDDSA_KEYS
         case SIGNATURE_TYPE_ED25519: {
             compressed.W_len = public_key->W_len - 1;
             memcpy(compressed.W, public_key->W + 1, compressed.W_len);
             break;
         }
+#endif
+#ifdef HAVE_ECDSA_KEYS
         case SIGNATURE_TYPE_SECP256K1:
         case SIGNATURE_TYPE_SECP256R1: {
             memcpy(compressed.W, public_key->W, public_key->W_len);
@@ -154,6 +519,15 @@ static cx_err_t public_key_hash(uint8_t *const hash_out,
             compressed.W_len = PUB_KEY_COMPPRESSED_LENGTH;
             break;
         }
+#endif
+#ifdef HAVE_BLS
+        case SIGNATURE_TYPE_BLS12_381: {
+            // BLS12-381 public keys are already compressed
+            memcpy(compressed.W, public_key->W, public_key->W_len);
+            compressed.W_len = public_key->W_len;
+            break;
+        }
+#endif
         default:
             return CX_INVALID_PARAMETER;
     }
@@ -186,6 +560,28 @@ cx_err_t generate_public_key_hash(uint8_t *const hash_out,
         return CX_INVALID_PARAMETER;
     }
 
+    if (hash_out_size < KEY_HASH_SIZE) {
+        return CX_INVALID_PARAMETER_SIZE;
+    }
+
+    // The public key hash of the authorized key is derived once, when it is authorized
+    baking_key_derived_t const *const derived = find_baking_key_derived(path_with_curve);
+    if (derived != NULL) {
+        memcpy(hash_out, derived->pkh, KEY_HASH_SIZE);
+        if (compressed_out != NULL) {
+            memset(compressed_out, 0, sizeof(*compressed_out));
+            memcpy(compressed_out->W, derived->public_key, derived->public_key_length);
+            compressed_out->W_len = derived->public_key_length;
+        }
+        return CX_OK;
+    }
+
+    pubkey_cache_entry_t *entry = find_pubkey_cache_entry(path_with_curve);
+    if ((entry != NULL) && entry->has_hash && (compressed_out == NULL)) {
+        memcpy(hash_out, entry->hash, KEY_HASH_SIZE);
+        return CX_OK;
+    }
+
     cx_ecfp_public_key_t pubkey = {0};
     cx_err_t error = CX_OK;
 
@@ -194,12 +590,276 @@ cx_err_t generate_public_key_hash(uint8_t *const hash_out,
     CX_CHECK(public_key_hash(hash_out,
                              hash_out_size,
                              compressed_out,
-                             path_with_curve->derivation_type,
+                             get_derivation_type(path_with_curve),
                              &pubkey));
 
+    entry = find_pubkey_cache_entry(path_with_curve);
+    if (entry != NULL) {
+        memcpy(entry->hash, hash_out, KEY_HASH_SIZE);
+        entry->has_hash = true;
+    }
+
+end:
+    return error;
+}
+
+#if defined(HAVE_ECDSA_KEYS) || defined(HAVE_EDDSA_KEYS)
+/**
+ * @brief Signs a message with a private key
+ *
+ *        output_size will be updated to the signature size
+ *
+ * @param out: signature output
+ * @param out_size: output size
+ * @param signature_type: signature type of the key
+ * @param private_key: private key
+ * @param in: message input
+ * @param in_size: input size
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t sign_with_private_key(uint8_t *const out,
+                                      size_t *out_size,
+                                      signature_type_t const signature_type,
+                                      cx_ecfp_private_key_t const *const private_key,
+                                      uint8_t const *const in,
+                                      size_t const in_size) {
+    cx_err_t error = CX_OK;
+
+    switch (signature_type) {
+#ifdef HAVE_EDDSA_KEYS
+        case SIGNATURE_TYPE_ED25519: {
+            size_t domain_length;
+            CX_CHECK(cx_eddsa_sign_no_throw(private_key,
+                                            CX_SHA512,
+                                            (uint8_t const *) PIC(in),
+                                            in_size,
+                                            out,
+                                            *out_size));
+            CX_CHECK(cx_ecdomain_parameters_length(private_key->curve, &domain_length));
+            *out_size = domain_length * 2u;
+        } break;
+#endif
+#ifdef HAVE_ECDSA_KEYS
+        case SIGNATURE_TYPE_SECP256K1:
+        case SIGNATURE_TYPE_SECP256R1: {
+            uint32_t info;
+            CX_CHECK(cx_ecdsa_sign_no_throw(private_key,
+                                            CX_LAST | CX_RND_RFC6979,
+                                            CX_SHA256,
+                                            (uint8_t const *) PIC(in),
+                                            in_size,
+                                            out,
+                                            out_size,
+                                            &info));
+            if ((info & CX_ECCINFO_PARITY_ODD) != 0) {
+                out[0] |= 0x01;
+            }
+        } break;
+#endif
+        default:
+            error = CX_INVALID_PARAMETER;
+    }
+
 end:
     return error;
 }
+#endif
+
+cx_err_t load_baking_key_cache(void) {
+    baking_key_cache_t *const cache = &global.baking_key_cache;
+    bip32_path_with_curve_t const *const baking_key = &g_hwm.baking_key;
+
+    if (baking_key->bip32_path.length == 0u) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    if (cache->is_set && bip32_path_with_curve_eq(&cache->key, baking_key)) {
+        return CX_OK;
+    }
+
+    clear_baking_key_cache();
+
+    cx_err_t error = CX_OK;
+
+    derivation_type_t derivation_type = get_derivation_type(baking_key);
+    signature_type_t signature_type = derivation_type_to_signature_type(derivation_type);
+
+    switch (signature_type) {
+#ifdef HAVE_BLS
+        case SIGNATURE_TYPE_BLS12_381: {
+            uint8_t public_key[BLS_PUBLIC_KEY_SIZE] = {0};
+            CX_CHECK(
+                derive_bls_key(&baking_key->bip32_path, &cache->bls_private_key, public_key));
+            // The message independent part of the hash to curve is precomputed
+            CX_CHECK(bls_hash_absorb_prefix(&cache->bls_hash_prefix, public_key));
+        } break;
+#endif
+#if defined(HAVE_ECDSA_KEYS) || defined(HAVE_EDDSA_KEYS)
+        case SIGNATURE_TYPE_SECP256K1:
+        case SIGNATURE_TYPE_SECP256R1:
+        case SIGNATURE_TYPE_ED25519:
+            CX_CHECK(bip32_derive_with_seed_init_privkey_256(
+                derivation_type_to_derivation_mode(derivation_type),
+                signature_type_to_cx_curve(signature_type),
+                baking_key->bip32_path.components,
+                baking_key->bip32_path.length,
+                &cache->private_key,
+                NULL,
+                NULL,
+                0));
+            break;
+#endif
+        default:
+            error = CX_INVALID_PARAMETER;
+            goto end;
+    }
+
+    // The signature setup is resolved once for all the signatures
+    cache->signature_type = signature_type;
+    copy_bip32_path_with_curve(&cache->key, baking_key);
+    cache->is_set = true;
+
+end:
+    if (error != CX_OK) {
+        clear_baking_key_cache();
+    }
+    return error;
+}
+
+void clear_baking_key_cache(void) {
+    explicit_bzero(&global.baking_key_cache, sizeof(global.baking_key_cache));
+}
+
+#ifdef HAVE_BLS
+cx_err_t bls_hash_init(bls_hash_state_t *const state,
+                       bip32_path_with_curve_t const *const path_with_curve) {
+    if ((state == NULL) || (path_with_curve == NULL) ||
+        (path_with_curve->derivation_type != DERIVATION_TYPE_BLS12_381)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    // The authorized key hashes from its precomputed prefix
+    if (bip32_path_with_curve_eq(path_with_curve, &g_hwm.baking_key) &&
+        (load_baking_key_cache() == CX_OK)) {
+        memcpy(state, &global.baking_key_cache.bls_hash_prefix, sizeof(*state));
+        return CX_OK;
+    }
+
+    cx_err_t error = CX_OK;
+    cx_ecfp_public_key_t public_key = {0};
+
+    CX_CHECK(generate_public_key(&public_key, path_with_curve));
+    CX_CHECK(bls_hash_absorb_prefix(state, public_key.W));
+
+end:
+    return error;
+}
+
+cx_err_t bls_hash_update(bls_hash_state_t *const state,
+                         uint8_t const *const in,
+                         size_t const in_size) {
+    if ((state == NULL) || (in == NULL) || !state->initialized) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    return cx_hash_no_throw((cx_hash_t *) &state->state, 0, in, in_size, NULL, 0);
+}
+
+/**
+ * @brief Signs a message hashed with a BLS12-381 key under a domain separation tag
+ *
+ * @param out: signature output
+ * @param out_size: output size, updated to the signature size
+ * @param path_with_curve: bip32 path and curve of the key
+ * @param state: hash to curve state of the whole message
+ * @param dst: domain separation tag
+ * @return cx_err_t: error, CX_OK if none
+ */
+static cx_err_t bls_sign(uint8_t *const out,
+                         size_t *out_size,
+                         bip32_path_with_curve_t const *const path_with_curve,
+                         bls_hash_state_t *const state,
+                         char const *const dst) {
+    if ((out == NULL) || (out_size == NULL) || (path_with_curve == NULL) || (state == NULL) ||
+        !state->initialized) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    if (*out_size < BLS_SIGNATURE_SIZE) {
+        return CX_INVALID_PARAMETER_SIZE;
+    }
+
+    cx_err_t error = CX_OK;
+    uint8_t hash[BLS_HASH_SIZE] = {0};
+    cx_ecfp_384_private_key_t private_key = {0};
+    uint8_t public_key[BLS_PUBLIC_KEY_SIZE] = {0};
+    cx_ecfp_384_private_key_t const *key = &private_key;
+
+    PERF_COUNT_PHASE(PERF_PHASE_SIGN, BLS_HASH_SIZE);
+
+    CX_CHECK(bls_hash_to_field(state, dst, hash));
+
+    // The authorized key is derived once and then signs from the cache
+    if (bip32_path_with_curve_eq(path_with_curve, &g_hwm.baking_key) &&
+        (load_baking_key_cache() == CX_OK)) {
+        key = &global.baking_key_cache.bls_private_key;
+    } else {
+        CX_CHECK(derive_bls_key(&path_with_curve->bip32_path, &private_key, public_key));
+    }
+
+    CX_CHECK(ox_bls12381_sign(key, hash, sizeof(hash), out, BLS_SIGNATURE_SIZE));
+    *out_size = BLS_SIGNATURE_SIZE;
+
+end:
+    explicit_bzero(&private_key, sizeof(private_key));
+    return error;
+}
+
+cx_err_t sign_bls_hash(uint8_t *const out,
+                       size_t *out_size,
+                       bip32_path_with_curve_t const *const path_with_curve,
+                       bls_hash_state_t *const state) {
+    return bls_sign(out, out_size, path_with_curve, state, (char const *) PIC(BLS_SIG_DST));
+}
+
+cx_err_t generate_bls_proof_of_possession(uint8_t *const out,
+                                          size_t *out_size,
+                                          bip32_path_with_curve_t const *const path_with_curve) {
+    if ((out == NULL) || (out_size == NULL) || (path_with_curve == NULL)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    if (*out_size < BLS_SIGNATURE_SIZE) {
+        return CX_INVALID_PARAMETER_SIZE;
+    }
+
+    bls_proof_cache_t *const cache = &global.pubkey_cache.bls_proof;
+
+    if (cache->is_set && bip32_path_with_curve_eq(&cache->key, path_with_curve)) {
+        memcpy(out, cache->proof, BLS_SIGNATURE_SIZE);
+        *out_size = BLS_SIGNATURE_SIZE;
+        return CX_OK;
+    }
+
+    cx_err_t error = CX_OK;
+    bls_hash_state_t state = {0};
+
+    // The proof signs the public key alone, which is the prefix of the messages
+    CX_CHECK(bls_hash_init(&state, path_with_curve));
+    CX_CHECK(bls_sign(out, out_size, path_with_curve, &state, (char const *) PIC(BLS_POP_DST)));
+
+    // A PIN-locked app does not derive the actual key
+    if (os_global_pin_is_validated() == BOLOS_UX_OK) {
+        memset(cache, 0, sizeof(*cache));
+        copy_bip32_path_with_curve(&cache->key, path_with_curve);
+        memcpy(cache->proof, out, BLS_SIGNATURE_SIZE);
+        cache->is_set = true;
+    }
+
+end:
+    return error;
+}
+#endif
 
 cx_err_t sign(uint8_t *const out,
               size_t *out_size,
@@ -212,15 +872,40 @@ cx_err_t sign(uint8_t *const out,
 
     cx_err_t error = CX_OK;
 
+    derivation_type_t derivation_type = get_derivation_type(path_with_curve);
+
+#ifdef HAVE_BLS
+    // Counted by `sign_bls_hash`
+    if (derivation_type == DERIVATION_TYPE_BLS12_381) {
+        bls_hash_state_t state = {0};
+        CX_CHECK(bls_hash_init(&state, path_with_curve));
+        CX_CHECK(bls_hash_update(&state, (uint8_t const *) PIC(in), in_size));
+        return sign_bls_hash(out, out_size, path_with_curve, &state);
+    }
+#endif
+
+    PERF_COUNT_PHASE(PERF_PHASE_SIGN, in_size);
+
+#if defined(HAVE_ECDSA_KEYS) || defined(HAVE_EDDSA_KEYS)
+    // The authorized key is derived once and then signs from the cache
+    if (bip32_path_with_curve_eq(path_with_curve, &g_hwm.baking_key) &&
+        (load_baking_key_cache() == CX_OK)) {
+        return sign_with_private_key(out,
+                                     out_size,
+                                     global.baking_key_cache.signature_type,
+                                     &global.baking_key_cache.private_key,
+                                     in,
+                                     in_size);
+    }
+
     bip32_path_t const *const bip32_path = &path_with_curve->bip32_path;
-    derivation_type_t derivation_type = path_with_curve->derivation_type;
-    unsigned int derivation_mode = derivation_type_to_derivation_mode(derivation_type);
     signature_type_t signature_type = derivation_type_to_signature_type(derivation_type);
     cx_curve_t cx_curve = signature_type_to_cx_curve(signature_type);
-    uint32_t info;
 
     switch (signature_type) {
+#ifdef HAVE_EDDSA_KEYS
         case SIGNATURE_TYPE_ED25519: {
+            unsigned int derivation_mode = derivation_type_to_derivation_mode(derivation_type);
             CX_CHECK(bip32_derive_with_seed_eddsa_sign_hash_256(derivation_mode,
                                                                 cx_curve,
                                                                 bip32_path->components,
@@ -233,8 +918,11 @@ cx_err_t sign(uint8_t *const out,
                                                                 NULL,
                                                                 0));
         } break;
+#endif
+#ifdef HAVE_ECDSA_KEYS
         case SIGNATURE_TYPE_SECP256K1:
         case SIGNATURE_TYPE_SECP256R1: {
+            uint32_t info;
             CX_CHECK(bip32_derive_ecdsa_sign_hash_256(cx_curve,
                                                       bip32_path->components,
                                                       bip32_path->length,
@@ -249,10 +937,105 @@ cx_err_t sign(uint8_t *const out,
                 out[0] |= 0x01;
             }
         } break;
+#endif
         default:
             error = CX_INVALID_PARAMETER;
     }
+#else
+    error = CX_INVALID_PARAMETER;
+#endif
 
 end:
     return error;
 }
+
+
+#define COMPACT_SCALAR_SIZE 32u
+
+/**
+ * @brief Reads a DER integer and writes it as a fixed size big-endian scalar
+ *
+ * @param in: DER input, points to the integer tag
+ * @param in_size: input size
+ * @param out: scalar output of COMPACT_SCALAR_SIZE bytes
+ * @return size_t: size of the DER integer read, 0 if invalid
+ */
+static size_t read_der_scalar(uint8_t const *const in, size_t const in_size, uint8_t *const out) {
+    if ((in_size < 2u) || (in[0] != 0x02u) || ((size_t) in[1] + 2u > in_size)) {
+        return 0u;
+    }
+
+    uint8_t const *value = in + 2u;
+    size_t value_size = in[1];
+
+    // Positive integers with their high bit set carry a leading 0
+    if ((value_size == COMPACT_SCALAR_SIZE + 1u) && (value[0] == 0u)) {
+        value++;
+        value_size--;
+    }
+    if ((value_size == 0u) || (value_size > COMPACT_SCALAR_SIZE)) {
+        return 0u;
+    }
+
+    memset(out, 0, COMPACT_SCALAR_SIZE - value_size);
+    memcpy(out + COMPACT_SCALAR_SIZE - value_size, value, value_size);
+
+    return (size_t) in[1] + 2u;
+}
+
+cx_err_t compact_signature(uint8_t *const sig,
+                           size_t *const sig_size,
+                           derivation_type_t const derivation_type) {
+    if ((sig == NULL) || (sig_size == NULL)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    signature_type_t const signature_type = derivation_type_to_signature_type(derivation_type);
+
+    if ((signature_type == SIGNATURE_TYPE_ED25519) ||
+        (signature_type == SIGNATURE_TYPE_BLS12_381)) {
+        return CX_OK;
+    }
+    if ((signature_type != SIGNATURE_TYPE_SECP256K1) &&
+        (signature_type != SIGNATURE_TYPE_SECP256R1)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    // The parity bit set by `sign` is dropped
+    if ((*sig_size < 2u) || ((sig[0] & ~0x01u) != 0x30u) || ((size_t) sig[1] + 2u != *sig_size)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    uint8_t compact[2u * COMPACT_SCALAR_SIZE];
+    size_t offset = 2u;
+
+    size_t read = read_der_scalar(sig + offset, *sig_size - offset, compact);
+    if (read == 0u) {
+        return CX_INVALID_PARAMETER;
+    }
+    offset += read;
+
+    read = read_der_scalar(sig + offset, *sig_size - offset, compact + COMPACT_SCALAR_SIZE);
+    if ((read == 0u) || (offset + read != *sig_size)) {
+        return CX_INVALID_PARAMETER;
+    }
+
+    memcpy(sig, compact, sizeof(compact));
+    *sig_size = sizeof(compact);
+
+    return CX_OK;
+}
+
+// FNV-1a parameters
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+uint32_t hash_bip32_path_with_curve(bip32_path_with_curve_t const *const path_with_curve) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    hash = (hash ^ (uint32_t) path_with_curve->derivation_type) * FNV_PRIME;
+    hash = (hash ^ path_with_curve->bip32_path.length) * FNV_PRIME;
+    for (uint8_t i = 0; (i < path_with_curve->bip32_path.length) && (i < MAX_BIP32_PATH); i++) {
+        hash = (hash ^ path_with_curve->bip32_path.components[i]) * FNV_PRIME;
+    }
+    return hash;
+}
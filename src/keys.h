@@ -74,6 +74,9 @@ cx_err_t generate_public_key_hash(uint8_t *const hash_out,
  *
  *        output_size will be updated to the signature size
  *
+ *        ECDSA and EdDSA keys sign the message hash, BLS12-381 keys
+ *        sign the message itself
+ *
  * @param out: signature output
  * @param out_size: output size
  * @param path_with_curve: bip32 path and curve of the key
@@ -87,6 +90,114 @@ cx_err_t sign(uint8_t *const out,
               uint8_t const *const in,
               size_t const in_size);
 
+#ifdef HAVE_BLS
+/**
+ * @brief Starts hashing a message to be signed by a BLS12-381 key
+ *
+ *        The message independent prefix of the authorized key is
+ *        precomputed in the private key cache
+ *
+ * @param state: hash to curve state
+ * @param path_with_curve: bip32 path and curve of the BLS12-381 key
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t bls_hash_init(bls_hash_state_t *const state,
+                       bip32_path_with_curve_t const *const path_with_curve);
+
+/**
+ * @brief Hashes incrementally a part of a message to be signed by a BLS12-381 key
+ *
+ * @param state: hash to curve state, initialized by `bls_hash_init`
+ * @param in: part of the message
+ * @param in_size: input size
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t bls_hash_update(bls_hash_state_t *const state,
+                         uint8_t const *const in,
+                         size_t const in_size);
+
+/**
+ * @brief Signs a message hashed with a BLS12-381 key
+ *
+ *        output_size will be updated to the signature size
+ *
+ * @param out: signature output
+ * @param out_size: output size
+ * @param path_with_curve: bip32 path and curve of the key
+ * @param state: hash to curve state of the whole message
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t sign_bls_hash(uint8_t *const out,
+                       size_t *out_size,
+                       bip32_path_with_curve_t const *const path_with_curve,
+                       bls_hash_state_t *const state);
+
+/**
+ * @brief Generates the proof of possession of a BLS12-381 key
+ *
+ *        The proof is the signature of the public key under the proof
+ *        of possession domain separation tag. The last proof is cached
+ *        with the public keys.
+ *
+ *        output_size will be updated to the proof size
+ *
+ * @param out: proof output
+ * @param out_size: output size
+ * @param path_with_curve: bip32 path and curve of the key
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t generate_bls_proof_of_possession(uint8_t *const out,
+                                          size_t *out_size,
+                                          bip32_path_with_curve_t const *const path_with_curve);
+#endif
+
+/**
+ * @brief Converts in place a signature produced by `sign` to its compact form
+ *
+ *        ECDSA DER signatures become the 64-byte r || s, without parity.
+ *        Ed25519 and BLS12-381 signatures are already compact and are
+ *        left unchanged
+ *
+ * @param sig: signature, updated in place
+ * @param sig_size: signature size, updated to the compact size
+ * @param derivation_type: derivation type of the signing key
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t compact_signature(uint8_t *const sig,
+                           size_t *const sig_size,
+                           derivation_type_t const derivation_type);
+
+/**
+ * @brief Derives the authorized key and stores its private key in the cache
+ *
+ *        Does nothing if the cache already holds the authorized key
+ *
+ * @return cx_err_t: error, CX_OK if none
+ */
+cx_err_t load_baking_key_cache(void);
+
+/**
+ * @brief Wipes the private key cache
+ *
+ */
+void clear_baking_key_cache(void);
+
+/**
+ * @brief Empties the public key cache
+ *
+ */
+void clear_pubkey_cache(void);
+
+/**
+ * @brief Computes the hash of a bip32 path and its curve
+ *
+ *        Used to look up keys quickly, it is not a cryptographic hash
+ *
+ * @param path_with_curve: bip32 path and curve of the key
+ * @return uint32_t: hash of the key
+ */
+uint32_t hash_bip32_path_with_curve(bip32_path_with_curve_t const *const path_with_curve);
+
 /**
  * @brief Reads a curve code from wire-format and parse into `deviration_type`
  *
@@ -94,18 +205,38 @@ cx_err_t sign(uint8_t *const out,
  * @return derivation_type_t: derivation_type result
  */
 static inline derivation_type_t parse_derivation_type(uint8_t const curve_code) {
+    derivation_type_t derivation_type = DERIVATION_TYPE_UNSET;
+
     switch (curve_code) {
         case 0:
-            return DERIVATION_TYPE_ED25519;
+            derivation_type = DERIVATION_TYPE_ED25519;
+            break;
         case 1:
-            return DERIVATION_TYPE_SECP256K1;
+            derivation_type = DERIVATION_TYPE_SECP256K1;
+            break;
         case 2:
-            return DERIVATION_TYPE_SECP256R1;
+            derivation_type = DERIVATION_TYPE_SECP256R1;
+            break;
         case 3:
-            return DERIVATION_TYPE_BIP32_ED25519;
+            derivation_type = DERIVATION_TYPE_BIP32_ED25519;
+            break;
+#ifdef HAVE_BLS
+        case 4:
+            derivation_type = DERIVATION_TYPE_BLS12_381;
+            break;
+#endif
         default:
-            return DERIVATION_TYPE_UNSET;
+            break;
     }
+
+#ifdef SINGLE_DERIVATION_TYPE
+    // The keys of the other derivation types are refused
+    if (derivation_type != SINGLE_DERIVATION_TYPE) {
+        derivation_type = DERIVATION_TYPE_UNSET;
+    }
+#endif
+
+    return derivation_type;
 }
 
 /**
@@ -124,6 +255,8 @@ static inline int unparse_derivation_type(derivation_type_t const derivation_typ
             return 2;
         case DERIVATION_TYPE_BIP32_ED25519:
             return 3;
+        case DERIVATION_TYPE_BLS12_381:
+            return 4;
         default:
             return -1;
     }
@@ -145,6 +278,8 @@ static inline signature_type_t derivation_type_to_signature_type(
         case DERIVATION_TYPE_ED25519:
         case DERIVATION_TYPE_BIP32_ED25519:
             return SIGNATURE_TYPE_ED25519;
+        case DERIVATION_TYPE_BLS12_381:
+            return SIGNATURE_TYPE_BLS12_381;
         default:
             return SIGNATURE_TYPE_UNSET;
     }
@@ -20,6 +20,7 @@
 */
 
 #include "apdu.h"
+#include "apdu_sign.h"
 #include "globals.h"
 #include "memory.h"
 #include "ui.h"
@@ -64,5 +65,8 @@ void app_main(void) {
             PRINTF("=> apdu_dispatcher failure\n");
             return;
         }
+
+        // The response is sent, the next command is received meanwhile
+        sign_pipelined_message();
     }
 }
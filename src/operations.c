@@ -62,8 +62,6 @@ typedef enum {
         }                   \
     } while (0)
 
-#define STEP_HARD_FAIL -2
-
 /// Conversion/check functions
 
 /**
@@ -91,6 +89,9 @@ static tz_parser_result parse_raw_tezos_header_signature_type(
         case 2:
             signature_type_result = SIGNATURE_TYPE_SECP256R1;
             break;
+        case 3:
+            signature_type_result = SIGNATURE_TYPE_BLS12_381;
+            break;
         default:
             PARSER_FAIL();
     }
@@ -105,26 +106,31 @@ end:
 /**
  * @brief Extracts a compressed_pubkey and a contract from a key
  *
- * @param compressed_pubkey_out: compressed_pubkey output
- * @param contract_out: contract output
+ * @param out: parsing output, receives the compressed_pubkey and the contract
  * @param path_with_curve: bip32 path and curve of the key
  * @return tz_exc: exception, SW_OK if none
  */
-static inline tz_exc compute_pkh(cx_ecfp_public_key_t *const compressed_pubkey_out,
-                                 parsed_contract_t *const contract_out,
+static inline tz_exc compute_pkh(struct parsed_operation_group *const out,
                                  bip32_path_with_curve_t const *const path_with_curve) {
     tz_exc exc = SW_OK;
     cx_err_t error = CX_OK;
 
     TZ_ASSERT_NOT_NULL(path_with_curve);
-    TZ_ASSERT_NOT_NULL(compressed_pubkey_out);
-    TZ_ASSERT_NOT_NULL(contract_out);
+    TZ_ASSERT_NOT_NULL(out);
+
+    parsed_contract_t *const contract_out = &out->signing;
+    cx_ecfp_public_key_t compressed_pubkey = {0};
 
     CX_CHECK(generate_public_key_hash(contract_out->hash,
                                       sizeof(contract_out->hash),
-                                      compressed_pubkey_out,
+                                      &compressed_pubkey,
                                       path_with_curve));
 
+    // Only the compressed key is kept
+    TZ_ASSERT(compressed_pubkey.W_len <= sizeof(out->public_key), EXC_MEMORY_ERROR);
+    memcpy(out->public_key, compressed_pubkey.W, compressed_pubkey.W_len);
+    out->public_key_length = compressed_pubkey.W_len;
+
     contract_out->signature_type =
         derivation_type_to_signature_type(path_with_curve->derivation_type);
     TZ_ASSERT(contract_out->signature_type != SIGNATURE_TYPE_UNSET, EXC_MEMORY_ERROR);
@@ -161,105 +167,106 @@ end:
 }
 
 /**
- * @brief Helpers for sub parser
- *
- *       Subparsers: no function here should be called anywhere in
- *       this file without using the CALL_SUBPARSER macro above.
+ * @brief Kinds of field
  *
  */
-#define CALL_SUBPARSER_LN(func, line, ...) PARSER_CHECK(func(__VA_ARGS__, line))
-#define CALL_SUBPARSER(func, ...)          CALL_SUBPARSER_LN(func, __LINE__, __VA_ARGS__)
-
-#define NEXT_BYTE (byte)
+typedef enum {
+    FIELD_BYTES = 0,   /// fixed-size field, read as a byte range
+    FIELD_PUBLIC_KEY,  /// public key, of the size of the signing public key
+    FIELD_Z,           /// Z number, read byte per byte
+    FIELD_SKIP         /// fixed-size field, hashed but neither buffered nor checked
+} field_kind_t;
 
 /**
- * @brief Parses a Z number
+ * @brief Actions carried out once a field has been read
  *
- * @param current_byte: the current read byte
- * @param state: parsing state
- * @param lineno: line number of the caller
- * @return tz_parser_result: result of the parsing
  */
-static inline tz_parser_result parse_z(uint8_t current_byte,
-                                       struct int_subparser_state *state,
-                                       uint32_t lineno) {
-    tz_parser_result res = PARSER_CONTINUE;
-
-    if (state->lineno != lineno) {
-        // New call; initialize.
-        state->lineno = lineno;
-        state->value = 0;
-        state->shift = 0;
-    }
-    // Fails when the resulting shifted value overflows 64 bits
-    if ((state->shift > 63u) || ((state->shift == 63u) && (current_byte != 1u))) {
-        PARSER_FAIL();
-    }
-    state->value |= ((uint64_t) current_byte & 0x7Fu) << state->shift;
-    state->shift += 7u;
+typedef enum {
+    FIELD_ACTION_NONE = 0,               /// the field is ignored
+    FIELD_ACTION_TAG,                    /// operation tag
+    FIELD_ACTION_SOURCE,                 /// source of the operation
+    FIELD_ACTION_FEE,                    /// fee of the operation
+    FIELD_ACTION_STORAGE_LIMIT,          /// storage limit of the operation
+    FIELD_ACTION_REVEAL_SIGNATURE_TYPE,  /// type of the revealed public key
+    FIELD_ACTION_REVEAL_PUBLIC_KEY,      /// revealed public key
+    FIELD_ACTION_DELEGATE_PRESENCE,      /// if a delegate is set
+    FIELD_ACTION_DELEGATE,               /// delegate
+    FIELD_ACTION_REVEAL_PROOF            /// proof of possession of the revealed key
+} field_action_t;
 
-    if ((current_byte & 0x80u) == 0u) {
-        res = PARSER_DONE;
-    }
+/**
+ * @brief This structure represents a field descriptor
+ *
+ */
+typedef struct {
+    uint8_t kind;    ///< kind of the field, see `field_kind_t`
+    uint8_t size;    ///< size of a `FIELD_BYTES` or `FIELD_SKIP` field
+    uint8_t action;  ///< action once the field is read, see `field_action_t`
+} field_descriptor_t;
 
-end:
-    return res;
-}
-#define PARSE_Z                                                             \
-    ({                                                                      \
-        CALL_SUBPARSER(parse_z, (byte), &(state)->subparser_state.integer); \
-        (state)->subparser_state.integer.value;                             \
-    })
+/**
+ * @brief This structure represents a table of fields
+ *
+ */
+typedef struct {
+    field_descriptor_t const *fields;  ///< fields, in the wire order
+    uint8_t count;                     ///< number of fields
+} field_table_t;
+
+static field_descriptor_t const group_header_fields[] = {
+    {FIELD_BYTES, sizeof(struct operation_group_header), FIELD_ACTION_NONE},  // branch
+};
+
+static field_descriptor_t const operation_tag_fields[] = {
+    {FIELD_BYTES, 1u, FIELD_ACTION_TAG},
+};
+
+static field_descriptor_t const manager_fields[] = {
+    {FIELD_BYTES, sizeof(struct implicit_contract), FIELD_ACTION_SOURCE},
+    {FIELD_Z, 0u, FIELD_ACTION_FEE},
+    {FIELD_Z, 0u, FIELD_ACTION_NONE},  // counter
+    {FIELD_Z, 0u, FIELD_ACTION_NONE},  // gas limit
+    {FIELD_Z, 0u, FIELD_ACTION_STORAGE_LIMIT},
+};
+
+static field_descriptor_t const reveal_fields[] = {
+    {FIELD_BYTES, sizeof(raw_tezos_header_signature_type_t), FIELD_ACTION_REVEAL_SIGNATURE_TYPE},
+    {FIELD_PUBLIC_KEY, 0u, FIELD_ACTION_REVEAL_PUBLIC_KEY},
+};
+
+static field_descriptor_t const delegation_fields[] = {
+    {FIELD_BYTES, 1u, FIELD_ACTION_DELEGATE_PRESENCE},
+    {FIELD_BYTES, sizeof(struct delegation_contents), FIELD_ACTION_DELEGATE},
+};
+
+static field_descriptor_t const reveal_proof_fields[] = {
+    {FIELD_SKIP, BLS_SIGNATURE_SIZE, FIELD_ACTION_REVEAL_PROOF},
+};
+
+/// Tables of fields, indexed by `parse_table_t`
+static field_table_t const field_tables[PARSE_TABLE_COUNT] = {
+    [PARSE_TABLE_GROUP_HEADER] = {group_header_fields, NUM_ELEMENTS(group_header_fields)},
+    [PARSE_TABLE_OPERATION_TAG] = {operation_tag_fields, NUM_ELEMENTS(operation_tag_fields)},
+    [PARSE_TABLE_MANAGER] = {manager_fields, NUM_ELEMENTS(manager_fields)},
+    [PARSE_TABLE_REVEAL] = {reveal_fields, NUM_ELEMENTS(reveal_fields)},
+    [PARSE_TABLE_DELEGATION] = {delegation_fields, NUM_ELEMENTS(delegation_fields)},
+    [PARSE_TABLE_REVEAL_PROOF] = {reveal_proof_fields, NUM_ELEMENTS(reveal_proof_fields)},
+};
+
+/// Presence byte of the proof of possession following a reveal
+#define REVEAL_PROOF_ABSENT  0x00u
+#define REVEAL_PROOF_PRESENT 0xFFu
 
 /**
- * @brief Parses a wire type
+ * @brief Starts reading the fields of a table
  *
- * @param current_byte: the current read byte
  * @param state: parsing state
- * @param sizeof_type: size of the type
- * @param lineno: line number of the caller
- * @return tz_parser_result: result of the parsing
+ * @param table: table of fields
  */
-static tz_parser_result parse_next_type(uint8_t current_byte,
-                                        struct nexttype_subparser_state *state,
-                                        uint32_t sizeof_type,
-                                        uint32_t lineno) {
-    tz_parser_result res = PARSER_CONTINUE;
-
-#ifdef DEBUG
-    if (sizeof_type > sizeof(state->body)) {
-        PARSER_FAIL();  // Shouldn't happen, but error if it does and we're debugging. Neither side
-                        // is dynamic.
-    }
-#endif
-
-    if (state->lineno != lineno) {
-        state->lineno = lineno;
-        state->fill_idx = 0;
-    }
-
-    state->body.raw[state->fill_idx] = current_byte;
-    state->fill_idx++;
-
-    if (state->fill_idx == sizeof_type) {
-        res = PARSER_DONE;
-    }
-
-    if (state->fill_idx > sizeof_type) {
-        PARSER_FAIL();
-    }
-
-end:
-    return res;
+static inline void enter_table(struct parse_state *const state, parse_table_t const table) {
+    state->table = table;
+    state->step = 0;
 }
-// do _NOT_ keep pointers to this data around.
-#define NEXT_TYPE(type)                                                                          \
-    ({                                                                                           \
-        CALL_SUBPARSER(parse_next_type, byte, &(state->subparser_state.nexttype), sizeof(type)); \
-        (const type *) &(state->subparser_state.nexttype.body);                                  \
-    })
-
-// End of subparsers.
 
 /**
  * @brief Initialize the operation parser
@@ -276,30 +283,25 @@ static tz_exc parse_operations_init(struct parsed_operation_group *const out,
 
     TZ_ASSERT_NOT_NULL(out);
     TZ_ASSERT_NOT_NULL(path_with_curve);
+    TZ_ASSERT_NOT_NULL(state);
 
     memset(out, 0, sizeof(*out));
+    memset(state, 0, sizeof(*state));
 
     out->operation.tag = OPERATION_TAG_NONE;
 
-    TZ_CHECK(compute_pkh(&out->public_key, &out->signing, path_with_curve));
+    TZ_CHECK(compute_pkh(out, path_with_curve));
 
     // Start out with source = signing, for reveals
     memcpy(&out->operation.source, &out->signing, sizeof(out->signing));
 
-    state->op_step = 0;
-    state->subparser_state.integer.lineno = -1;
-    state->tag = OPERATION_TAG_NONE;  // This and the rest shouldn't be required.
+    enter_table(state, PARSE_TABLE_GROUP_HEADER);
+    state->tag = OPERATION_TAG_NONE;
 
 end:
     return exc;
 }
 
-/// Named steps in the top-level state machine
-#define STEP_END_OF_MESSAGE       -1
-#define STEP_OP_TYPE_DISPATCH     10001
-#define STEP_AFTER_MANAGER_FIELDS 10002
-#define STEP_HAS_DELEGATE         10003
-
 bool parse_operations_final(struct parse_state *const state,
                             struct parsed_operation_group *const out) {
     if ((state == NULL) || (out == NULL)) {
@@ -308,209 +310,281 @@ bool parse_operations_final(struct parse_state *const state,
     if ((out->operation.tag == OPERATION_TAG_NONE) && !out->has_reveal) {
         return false;
     }
-    return ((state->op_step == STEP_END_OF_MESSAGE) || (state->op_step == 1));
+    // The message must end between two operations
+    return !state->failed && (state->table == PARSE_TABLE_OPERATION_TAG) && (state->step == 0u);
 }
 
 /**
- * @brief Parse one bytes regarding the current parsing state
+ * @brief Reads a byte of a Z number
  *
- * @param byte: byte to read
+ * @param current_byte: the current read byte
  * @param state: parsing state
- * @param out: parsing output
  * @return tz_parser_result: result of the parsing
  */
-static inline tz_parser_result parse_byte(uint8_t byte,
-                                          struct parse_state *const state,
-                                          struct parsed_operation_group *const out) {
+static inline tz_parser_result parse_z(uint8_t current_byte, struct parse_state *const state) {
     tz_parser_result res = PARSER_CONTINUE;
 
-// OP_STEP finishes the current state transition, setting the state, and introduces the next state.
-// For linear chains of states, this keeps the code structurally similar to equivalent imperative
-// parsing code.
-#define OP_STEP                \
-    state->op_step = __LINE__; \
-    break;                     \
-    case __LINE__:
-
-// The same as OP_STEP, but with a particular name, such that we could jump to this state.
-#define OP_NAMED_STEP(name) \
-    state->op_step = name;  \
-    break;                  \
-    case name:
-
-// "jump" to specific state: (set state to foo and return.)
-#define JMP(step)          \
-    state->op_step = step; \
-    break;
-
-// Set the next state to start-of-payload; used after reveal.
-#define JMP_TO_TOP JMP(1)
-
-// Conditionally set the next state.
-#define OP_JMPIF(step, cond)   \
-    if (cond) {                \
-        state->op_step = step; \
-        break;                 \
+    // Fails when the resulting shifted value overflows 64 bits
+    if ((state->z.shift > 63u) || ((state->z.shift == 63u) && (current_byte != 1u))) {
+        PARSER_FAIL();
     }
+    state->z.value |= ((uint64_t) current_byte & 0x7Fu) << state->z.shift;
+    state->z.shift += 7u;
 
-    switch (state->op_step) {
-        case STEP_HARD_FAIL:
-            PARSER_FAIL();
+    if ((current_byte & 0x80u) == 0u) {
+        res = PARSER_DONE;
+    }
 
-        case STEP_END_OF_MESSAGE:
-            PARSER_FAIL();  // We already hit a hard end of message; fail.
+end:
+    return res;
+}
 
-        case 0: {
-            // Ignore block hash
-            NEXT_TYPE(struct operation_group_header);
-        }
+/**
+ * @brief Ends the operation that has been parsed
+ *
+ *        Then goes back to the top to catch the next operation
+ *
+ * @param state: parsing state
+ * @param out: parsing output
+ * @return tz_parser_result: result of the parsing
+ */
+static tz_parser_result end_operation(struct parse_state *const state,
+                                      struct parsed_operation_group *const out) {
+    tz_parser_result res = PARSER_CONTINUE;
 
-            OP_NAMED_STEP(1)
+    if (state->tag == OPERATION_TAG_REVEAL) {
+        out->has_reveal = true;
+        // The public key can be followed by the presence of a proof
+        state->after_reveal = true;
+    }
 
-            state->tag = NEXT_BYTE;
+    enter_table(state, PARSE_TABLE_OPERATION_TAG);
 
-            OP_STEP
+    return res;
+}
 
-            // Parse 'source'
-            switch (state->tag) {
-                // Tags that don't have "originated" byte only support tz accounts, not KT or tz.
-                case OPERATION_TAG_DELEGATION:
-                case OPERATION_TAG_REVEAL: {
-                    struct implicit_contract const *const implicit_source =
-                        NEXT_TYPE(struct implicit_contract);
+/**
+ * @brief Carries out the action of a field that has been read
+ *
+ *        The action can select the next table of fields, otherwise
+ *        the next field of the current table is read
+ *
+ * @param action: action of the field
+ * @param state: parsing state
+ * @param out: parsing output
+ * @return tz_parser_result: PARSER_DONE to read the next field,
+ *                           PARSER_CONTINUE if the next table has been selected
+ */
+static tz_parser_result apply_field_action(field_action_t const action,
+                                           struct parse_state *const state,
+                                           struct parsed_operation_group *const out) {
+    tz_parser_result res = PARSER_DONE;
 
-                    out->operation.source.originated = 0;
-                    PARSER_CHECK(parse_raw_tezos_header_signature_type(
-                        &implicit_source->signature_type,
-                        &out->operation.source.signature_type));
+    switch (action) {
+        case FIELD_ACTION_NONE:
+            break;
 
-                    memcpy(out->operation.source.hash,
-                           implicit_source->pkh,
-                           sizeof(out->operation.source.hash));
+        case FIELD_ACTION_TAG:
+            if (state->after_reveal) {
+                state->after_reveal = false;
+                // Reveals without presence byte are still accepted, as
+                // neither presence byte is an accepted tag
+                if (state->body.raw[0] == REVEAL_PROOF_ABSENT) {
+                    enter_table(state, PARSE_TABLE_OPERATION_TAG);
+                    res = PARSER_CONTINUE;
                     break;
                 }
-
-                default:
-                    PARSER_FAIL();
+                if (state->body.raw[0] == REVEAL_PROOF_PRESENT) {
+                    // Only BLS12-381 keys are revealed with a proof
+                    PARSER_ASSERT(out->signing.signature_type == SIGNATURE_TYPE_BLS12_381);
+                    enter_table(state, PARSE_TABLE_REVEAL_PROOF);
+                    res = PARSER_CONTINUE;
                     break;
+                }
             }
+            state->tag = state->body.raw[0];
+            // Tags that don't have "originated" byte only support tz accounts, not KT or tz.
+            PARSER_ASSERT((state->tag == OPERATION_TAG_DELEGATION) ||
+                          (state->tag == OPERATION_TAG_REVEAL));
+            enter_table(state, PARSE_TABLE_MANAGER);
+            res = PARSER_CONTINUE;
+            break;
 
-            // If the source is an implicit contract,...
-            if (!out->operation.source.originated) {
-                // ... it had better match our key, otherwise why are we signing it?
-                PARSER_ASSERT(COMPARE(out->operation.source, out->signing) == 0);
-            }
-            // OK, it passes muster.
-
-            OP_STEP
-
-            // out->operation.source IS NORMALIZED AT THIS POINT
-
-            // Parse common fields for non-governance related operations.
+        case FIELD_ACTION_SOURCE: {
+            struct implicit_contract const *const implicit_source = &state->body.ic;
 
-            out->total_fee += PARSE_Z;  // fee
-            OP_STEP
-            PARSE_Z;  // counter
-            OP_STEP
-            PARSE_Z;  // gas limit
-            OP_STEP
-            out->total_storage_limit += PARSE_Z;  // storage limit
+            out->operation.source.originated = 0;
+            PARSER_CHECK(
+                parse_raw_tezos_header_signature_type(&implicit_source->signature_type,
+                                                      &out->operation.source.signature_type));
+            memcpy(out->operation.source.hash,
+                   implicit_source->pkh,
+                   sizeof(out->operation.source.hash));
 
-            OP_JMPIF(STEP_AFTER_MANAGER_FIELDS, state->tag != OPERATION_TAG_REVEAL)
+            // The source had better match our key, otherwise why are we signing it?
+            PARSER_ASSERT(COMPARE(out->operation.source, out->signing) == 0);
+            break;
+        }
 
-            OP_STEP
+        case FIELD_ACTION_FEE:
+            out->total_fee += state->z.value;
+            break;
 
-            // We know this is a reveal
+        case FIELD_ACTION_STORAGE_LIMIT:
+            out->total_storage_limit += state->z.value;
 
-            // Public key up next! Ensure it matches signing key.
-            {
-                raw_tezos_header_signature_type_t const *const sig_type =
-                    NEXT_TYPE(raw_tezos_header_signature_type_t);
-                signature_type_t reveal_signature_type = {0};
-                PARSER_CHECK(
-                    parse_raw_tezos_header_signature_type(sig_type, &reveal_signature_type));
-                PARSER_ASSERT(reveal_signature_type == out->signing.signature_type);
+            if (state->tag == OPERATION_TAG_REVEAL) {
+                enter_table(state, PARSE_TABLE_REVEAL);
+            } else {
+                // We are only currently allowing one non-reveal operation
+                PARSER_ASSERT(out->operation.tag == OPERATION_TAG_NONE);
+                out->operation.tag = state->tag;
+                enter_table(state, PARSE_TABLE_DELEGATION);
             }
+            res = PARSER_CONTINUE;
+            break;
 
-            OP_STEP
-
-            {
-                size_t klen = out->public_key.W_len;
-
-                // klen must match one of the field sizes in the public_key union
+        case FIELD_ACTION_REVEAL_SIGNATURE_TYPE: {
+            // Public key up next! Ensure it matches signing key.
+            signature_type_t reveal_signature_type = {0};
+            PARSER_CHECK(parse_raw_tezos_header_signature_type(&state->body.sigtype,
+                                                               &reveal_signature_type));
+            PARSER_ASSERT(reveal_signature_type == out->signing.signature_type);
+            break;
+        }
 
-                CALL_SUBPARSER(parse_next_type, byte, &(state->subparser_state.nexttype), klen);
+        case FIELD_ACTION_REVEAL_PUBLIC_KEY:
+            PARSER_ASSERT(memcmp(out->public_key, state->body.raw, out->public_key_length) == 0);
+            res = end_operation(state, out);
+            break;
 
-                PARSER_ASSERT(memcmp(out->public_key.W,
-                                     &(state->subparser_state.nexttype.body.raw),
-                                     klen) == 0);
+        case FIELD_ACTION_DELEGATE_PRESENCE:
+            if (state->body.raw[0] == 0u) {
+                // Encode "not present"
+                out->operation.destination.originated = 0;
+                out->operation.destination.signature_type = SIGNATURE_TYPE_UNSET;
+                res = end_operation(state, out);
+            }
+            break;
 
-                out->has_reveal = true;
+        case FIELD_ACTION_DELEGATE:
+            PARSER_CHECK(parse_implicit(&out->operation.destination,
+                                        &state->body.dc.signature_type,
+                                        state->body.dc.hash));
+            res = end_operation(state, out);
+            break;
 
-                JMP_TO_TOP;
-            }
+        case FIELD_ACTION_REVEAL_PROOF:
+            // The proof is checked by the protocol, it is only part of the hash
+            enter_table(state, PARSE_TABLE_OPERATION_TAG);
+            res = PARSER_CONTINUE;
+            break;
 
-        case STEP_AFTER_MANAGER_FIELDS:  // Anything but a reveal
+        default:
+            PARSER_FAIL();
+    }
 
-            // We are only currently allowing one non-reveal operation
-            PARSER_ASSERT(out->operation.tag == OPERATION_TAG_NONE);
+end:
+    return res;
+}
 
-            // This is the one allowable non-reveal operation per set
+/**
+ * @brief Reads the current field with the bytes available in the buffer
+ *
+ *        Fixed-size fields are read as a whole byte range, possibly
+ *        over several packets. Skipped fields are consumed without
+ *        being buffered, so their size is not bounded by `body`
+ *
+ * @param buf: input buffer, not empty
+ * @param state: parsing state
+ * @param out: parsing output
+ * @return tz_parser_result: result of the parsing
+ */
+static tz_parser_result parse_field(buffer_t *buf,
+                                    struct parse_state *const state,
+                                    struct parsed_operation_group *const out) {
+    tz_parser_result res = PARSER_CONTINUE;
 
-            out->operation.tag = state->tag;
+    PARSER_ASSERT(!state->failed);
+    PARSER_ASSERT(state->table < PARSE_TABLE_COUNT);
+
+    field_table_t const *const table = (field_table_t const *) PIC(&field_tables[state->table]);
+    PARSER_ASSERT(state->step < table->count);
+
+    field_descriptor_t const *const field =
+        &((field_descriptor_t const *) PIC(table->fields))[state->step];
+
+    if (field->kind == FIELD_Z) {
+        uint8_t byte;
+        PARSER_ASSERT(buffer_read_u8(buf, &byte));
+        PARSER_CHECK(parse_z(byte, state));
+    } else {
+        size_t const size =
+            (field->kind == FIELD_PUBLIC_KEY) ? out->public_key_length : field->size;
+        size_t const length = CUSTOM_MIN(size - state->fill_idx, buf->size - buf->offset);
+        if (field->kind != FIELD_SKIP) {
+            PARSER_ASSERT(size <= sizeof(state->body));
+            memcpy(((uint8_t *) &state->body) + state->fill_idx, buf->ptr + buf->offset, length);
+        }
+        PARSER_ASSERT(buffer_seek_cur(buf, length));
+        state->fill_idx += length;
 
-            // Deliberate epsilon-transition.
-            state->op_step = STEP_OP_TYPE_DISPATCH;
-            __attribute__((fallthrough));
-        default:
+        if (state->fill_idx < size) {
+            // Wait for the next packet
+            goto end;
+        }
+    }
 
-            if (state->tag == OPERATION_TAG_DELEGATION) {
-                switch (state->op_step) {
-                    case STEP_OP_TYPE_DISPATCH: {
-                        bool delegate_present = NEXT_BYTE != 0u;
-
-                        OP_JMPIF(STEP_HAS_DELEGATE, delegate_present)
-                    }
-                        // Else branch: Encode "not present"
-                        out->operation.destination.originated = 0;
-                        out->operation.destination.signature_type = SIGNATURE_TYPE_UNSET;
-
-                        JMP_TO_TOP;  // These go back to the top to catch any reveals.
-
-                    case STEP_HAS_DELEGATE: {
-                        const struct delegation_contents *dlg =
-                            NEXT_TYPE(struct delegation_contents);
-                        PARSER_CHECK(parse_implicit(&out->operation.destination,
-                                                    &dlg->signature_type,
-                                                    dlg->hash));
-                    }
-                        JMP_TO_TOP;  // These go back to the top to catch any reveals.
-                    default:         // Any other tag; probably not possible here.
-                        PARSER_FAIL();
-                }
+    res = apply_field_action(field->action, state, out);
+    PARSER_ASSERT(res != PARSER_ERROR);
+
+    if (res == PARSER_DONE) {
+        state->step++;
+        if (state->step == table->count) {
+            if (state->table == PARSE_TABLE_GROUP_HEADER) {
+                enter_table(state, PARSE_TABLE_OPERATION_TAG);
+            } else {
+                // The other tables always select the next table
+                PARSER_FAIL();
             }
+        }
     }
 
+    state->fill_idx = 0;
+    state->z.value = 0;
+    state->z.shift = 0;
+
 end:
     if (res == PARSER_ERROR) {
-        global.apdu.u.sign.parse_state.op_step = STEP_HARD_FAIL;
+        state->failed = true;
     }
     return res;
 }
 
-#define G global.apdu.u.sign
+#define G global.apdu.u.sign.message.maybe_ops
 
 tz_exc parse_operations(buffer_t *buf,
                         struct parsed_operation_group *const out,
                         bip32_path_with_curve_t const *const path_with_curve) {
     tz_exc exc = SW_OK;
-    uint8_t byte;
 
     TZ_CHECK(parse_operations_init(out, path_with_curve, &G.parse_state));
 
-    while (buffer_read_u8(buf, &byte) == true) {
-        TZ_ASSERT(parse_byte(byte, &G.parse_state, out) != PARSER_ERROR, EXC_PARSE_ERROR);
-        PRINTF("Byte: %x - Next op_step state: %d\n", byte, G.parse_state.op_step);
+    TZ_CHECK(parse_operations_next(buf, out));
+
+end:
+    return exc;
+}
+
+tz_exc parse_operations_next(buffer_t *buf, struct parsed_operation_group *const out) {
+    tz_exc exc = SW_OK;
+
+    TZ_ASSERT_NOT_NULL(buf);
+    TZ_ASSERT_NOT_NULL(out);
+
+    while (buf->offset < buf->size) {
+        TZ_ASSERT(parse_field(buf, &G.parse_state, out) != PARSER_ERROR, EXC_PARSE_ERROR);
+        PRINTF("Next field: %d.%d\n", G.parse_state.table, G.parse_state.step);
     }
 
 end:
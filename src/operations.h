@@ -64,6 +64,9 @@ union public_key {
     uint8_t edpk[32];  ///< raw public key for a edpk key
     uint8_t sppk[33];  ///< raw public key for a sppk key
     uint8_t p2pk[33];  ///< raw public key for a p2pk key
+#ifdef HAVE_BLS
+    uint8_t blpk[BLS_PUBLIC_KEY_SIZE];  ///< raw public key for a BLpk key
+#endif
 } __attribute__((packed));
 
 /**
@@ -76,27 +79,34 @@ struct delegation_contents {
 } __attribute__((packed));
 
 /**
- * @brief This structure represents the state of a Z parser
+ * @brief Tables of fields read by the parser
  *
  */
-struct int_subparser_state {
-    uint32_t lineno;  ///< line number
-                      ///< Has to be in _all_ members of the subparser union.
-    uint64_t value;   ///< Read value
-                      /// Still need to fix this.
-    uint8_t shift;    ///< Z shift
-};
+typedef enum {
+    PARSE_TABLE_GROUP_HEADER = 0,  /// operation group header
+    PARSE_TABLE_OPERATION_TAG,     /// tag of the next operation
+    PARSE_TABLE_MANAGER,           /// fields common to all manager operations
+    PARSE_TABLE_REVEAL,            /// fields of a reveal
+    PARSE_TABLE_DELEGATION,        /// fields of a delegation
+    PARSE_TABLE_REVEAL_PROOF,      /// proof of possession of a revealed BLS12-381 key
+    PARSE_TABLE_COUNT
+} parse_table_t;
 
 /**
- * @brief This structure represents the state of a wire type parser
- *
- *        Allows to read data using wire representation types
+ * @brief This structure represents the parsing state
  *
- *        Fills body using raw and an increasing fill_idx
+ *        Fixed-size fields are filled in `body` as byte ranges, Z
+ *        numbers are read byte per byte in `z`, skipped fields are
+ *        only counted in `fill_idx`, whatever their size
  *
  */
-struct nexttype_subparser_state {
-    uint32_t lineno;  ///< line number
+struct parse_state {
+    uint8_t table;           ///< current table of fields, see `parse_table_t`
+    uint8_t step;            ///< index of the current field in `table`
+    uint8_t fill_idx;        ///< number of bytes of the current field already read
+    bool failed;             ///< if the parsing has failed
+    bool after_reveal;       ///< if the next byte can be the proof presence of a reveal
+    enum operation_tag tag;  ///< current operation tag
 
     /// union of all wire structure
     union {
@@ -113,26 +123,12 @@ struct nexttype_subparser_state {
 
         uint8_t raw[1];  ///< raw array to fill the body
     } body;
-    uint32_t fill_idx;  ///< current fill index
-};
 
-/**
- * @brief This structure represents the union of all subparsers
- *
- */
-union subparser_state {
-    struct int_subparser_state integer;        ///< state of a n integer parser
-    struct nexttype_subparser_state nexttype;  ///< state of a wire type parser
-};
-
-/**
- * @brief This structure represents the parsing state
- *
- */
-struct parse_state {
-    int16_t op_step;                        ///< current parsing step
-    union subparser_state subparser_state;  ///< state of subparser
-    enum operation_tag tag;                 ///< current operation tag
+    /// state of the Z parser
+    struct {
+        uint64_t value;  ///< read value
+        uint8_t shift;   ///< Z shift
+    } z;
 };
 
 /**
@@ -154,6 +150,18 @@ tz_exc parse_operations(buffer_t *buf,
                         struct parsed_operation_group *const out,
                         bip32_path_with_curve_t const *const path_with_curve);
 
+/**
+ * @brief Parses the next part of a group of operation
+ *
+ *        The parsing resumes where the previous part stopped, so
+ *        that a group of operation can be sent in several packets
+ *
+ * @param buf: input operation part
+ * @param out: parsing output
+ * @return tz_exc: exception, SW_OK if none
+ */
+tz_exc parse_operations_next(buffer_t *buf, struct parsed_operation_group *const out);
+
 /**
  * @brief Checks parsing has been completed successfully
  *
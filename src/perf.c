@@ -0,0 +1,79 @@
+/* Tezos Ledger application - Performance counters
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#ifdef HAVE_PERF_COUNTERS
+
+#include "perf.h"
+
+#include "apdu.h"
+#include "globals.h"
+#include "write.h"
+
+#include <string.h>
+
+#define g_perf global.perf_counters
+
+void perf_count_instruction(uint8_t ins) {
+    if (ins < PERF_INS_COUNT) {
+        g_perf.instructions[ins]++;
+    }
+}
+
+void perf_count_phase(perf_phase_t phase, size_t bytes) {
+    if (phase < PERF_PHASE_COUNT) {
+        g_perf.phases[phase].calls++;
+        g_perf.phases[phase].bytes += bytes;
+    }
+}
+
+void perf_reset(void) {
+    memset(&g_perf, 0, sizeof(g_perf));
+}
+
+int handle_query_perf(bool reset) {
+    uint8_t resp[2u + (PERF_INS_COUNT * sizeof(uint32_t)) +
+                 (PERF_PHASE_COUNT * 2u * sizeof(uint32_t))] = {0};
+    size_t offset = 0;
+
+    resp[offset] = PERF_INS_COUNT;
+    offset++;
+
+    for (uint8_t i = 0; i < PERF_INS_COUNT; i++) {
+        write_u32_be(resp, offset, g_perf.instructions[i]);
+        offset += sizeof(uint32_t);
+    }
+
+    resp[offset] = PERF_PHASE_COUNT;
+    offset++;
+
+    for (uint8_t i = 0; i < PERF_PHASE_COUNT; i++) {
+        write_u32_be(resp, offset, g_perf.phases[i].calls);
+        offset += sizeof(uint32_t);
+        write_u32_be(resp, offset, g_perf.phases[i].bytes);
+        offset += sizeof(uint32_t);
+    }
+
+    if (reset) {
+        perf_reset();
+    }
+
+    return io_send_response_pointer(resp, offset, SW_OK);
+}
+
+#endif
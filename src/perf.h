@@ -0,0 +1,104 @@
+/* Tezos Ledger application - Performance counters
+
+   Copyright 2024 TriliTech <contact@trili.tech>
+   Copyright 2024 Functori <contact@functori.com>
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Number of instructions counted, checked against the last instruction in `apdu.h`
+#define PERF_INS_COUNT 0x1Bu
+
+/**
+ * @brief Phases measured by the performance counters
+ *
+ */
+typedef enum {
+    PERF_PHASE_PARSE = 0,    /// parsing of a signed message
+    PERF_PHASE_HASH,         /// incremental hash of a signed message
+    PERF_PHASE_HASH_FINISH,  /// final hash of a signed message
+    PERF_PHASE_GUARD,        /// baking authorization checks
+    PERF_PHASE_NVM_WRITE,    /// NVRAM write
+    PERF_PHASE_SIGN,         /// signature
+    PERF_PHASE_HMAC,         /// HMAC computation
+    PERF_PHASE_PUBKEY,       /// public key derivation
+    PERF_PHASE_COUNT
+} perf_phase_t;
+
+/**
+ * @brief This structure represents the counters of a phase
+ *
+ */
+typedef struct {
+    uint32_t calls;  ///< number of times the phase was run
+    uint32_t bytes;  ///< number of bytes processed by the phase
+} perf_phase_counters_t;
+
+/**
+ * @brief This structure represents the performance counters
+ *
+ */
+typedef struct {
+    uint32_t instructions[PERF_INS_COUNT];           ///< number of calls per instruction
+    perf_phase_counters_t phases[PERF_PHASE_COUNT];  ///< counters per phase
+} perf_counters_t;
+
+#ifdef HAVE_PERF_COUNTERS
+
+/**
+ * @brief Counts a call to an instruction
+ *
+ * @param ins: instruction code
+ */
+void perf_count_instruction(uint8_t ins);
+
+/**
+ * @brief Counts a run of a phase
+ *
+ * @param phase: phase
+ * @param bytes: number of bytes processed
+ */
+void perf_count_phase(perf_phase_t phase, size_t bytes);
+
+/**
+ * @brief Resets the performance counters
+ *
+ */
+void perf_reset(void);
+
+/**
+ * @brief Gets the performance counters
+ *
+ *        If requested, the counters are reset after being sent
+ *
+ * @param reset: if the counters must be reset
+ * @return int: zero or positive integer if success, negative integer otherwise.
+ */
+int handle_query_perf(bool reset);
+
+#define PERF_COUNT_INSTRUCTION(ins)    perf_count_instruction(ins)
+#define PERF_COUNT_PHASE(phase, bytes) perf_count_phase(phase, bytes)
+
+#else
+
+#define PERF_COUNT_INSTRUCTION(ins)    ((void) 0)
+#define PERF_COUNT_PHASE(phase, bytes) ((void) 0)
+
+#endif
@@ -21,8 +21,6 @@
 
 #include "to_string.h"
 
-#include <base58.h>
-
 #include "apdu.h"
 #include "keys.h"
 #include "read.h"
@@ -75,6 +73,87 @@ static void compute_hash_checksum(uint8_t out[TEZOS_HASH_CHECKSUM_SIZE],
     memcpy(out, checksum, TEZOS_HASH_CHECKSUM_SIZE);
 }
 
+/// Base58 alphabet
+static const char BASE58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+/// 58^2, two base58 digits are extracted per division
+#define BASE58_SQUARE 3364u
+
+/// Maximum size of the data to encode in base58
+#define BASE58_MAX_INPUT_SIZE 28u
+
+/// Size of the base58 encoding of a prefixed and checksummed public key hash
+#define PKH_BASE58_SIZE 36u
+
+/// Size of the base58 encoding of a prefixed and checksummed chain id
+#define CHAIN_ID_BASE58_SIZE (CHAIN_ID_BASE58_STRING_SIZE - 1u)
+
+/**
+ * @brief Encodes data in base58 into a string of known length
+ *
+ *        The Tezos prefixes are chosen so that the length of the
+ *        encoding only depends on the size of the data. The data is
+ *        split in 16-bit limbs which are divided in place, so only
+ *        32-bit arithmetic and a small stack buffer are needed.
+ *
+ * @param dest: result output
+ * @param dest_size: output size
+ * @param in: data to encode
+ * @param in_size: size of the data
+ * @param out_size: length of the encoding, without the null byte
+ * @return int: size of the result, negative integer on failure
+ */
+static int base58_encode_fixed(char *const dest,
+                               size_t const dest_size,
+                               uint8_t const *const in,
+                               size_t const in_size,
+                               size_t const out_size) {
+    uint16_t limbs[BASE58_MAX_INPUT_SIZE / 2u] = {0};
+
+    if ((in_size > BASE58_MAX_INPUT_SIZE) || (dest_size <= out_size)) {
+        return -1;
+    }
+
+    // Big-endian limbs, the first one holds a single byte if the size is odd
+    size_t const nb_limbs = (in_size + 1u) / 2u;
+    for (size_t i = 0; i < in_size; i++) {
+        size_t const limb = nb_limbs - 1u - ((in_size - 1u - i) / 2u);
+        limbs[limb] = (uint16_t) ((limbs[limb] << 8u) | in[i]);
+    }
+
+    size_t first = 0;
+    size_t pos = out_size;
+    while (pos > 0u) {
+        uint32_t rem = 0;
+        for (size_t i = first; i < nb_limbs; i++) {
+            uint32_t const current = (rem << 16u) | limbs[i];
+            limbs[i] = (uint16_t) (current / BASE58_SQUARE);
+            rem = current % BASE58_SQUARE;
+        }
+        while ((first < nb_limbs) && (limbs[first] == 0u)) {
+            first++;
+        }
+
+        pos--;
+        dest[pos] = BASE58_ALPHABET[rem % 58u];
+        rem /= 58u;
+        if (pos > 0u) {
+            pos--;
+            dest[pos] = BASE58_ALPHABET[rem];
+        } else if (rem != 0u) {
+            return -1;
+        }
+    }
+
+    // The encoding does not fit in the expected length
+    if (first < nb_limbs) {
+        return -1;
+    }
+
+    dest[out_size] = '\0';
+    return (int) out_size;
+}
+
 /**
  * @brief Converts a public key hash to string
  *
@@ -121,6 +200,11 @@ static int pkh_to_string(char *const dest,
             data.prefix[1] = 161u;
             data.prefix[2] = 164u;
             break;
+        case SIGNATURE_TYPE_BLS12_381:
+            data.prefix[0] = 6u;
+            data.prefix[1] = 161u;
+            data.prefix[2] = 166u;
+            break;
         default:
             return -1;
     }
@@ -129,7 +213,11 @@ static int pkh_to_string(char *const dest,
     memcpy(data.hash, hash, sizeof(data.hash));
     compute_hash_checksum(data.checksum, &data, sizeof(data) - sizeof(data.checksum));
 
-    return base58_encode((const uint8_t *) &data, sizeof(data), dest, dest_size);
+    return base58_encode_fixed(dest,
+                               dest_size,
+                               (const uint8_t *) &data,
+                               sizeof(data),
+                               PKH_BASE58_SIZE);
 }
 
 /**
@@ -158,7 +246,11 @@ static int chain_id_to_string(char *const dest,
 
     compute_hash_checksum(data.checksum, &data, sizeof(data) - sizeof(data.checksum));
 
-    return base58_encode((const uint8_t *) &data, sizeof(data), dest, dest_size);
+    return base58_encode_fixed(dest,
+                               dest_size,
+                               (const uint8_t *) &data,
+                               sizeof(data),
+                               CHAIN_ID_BASE58_SIZE);
 }
 
 #define SAFE_STRCPY(dest, dest_size, in) \
@@ -24,6 +24,7 @@
 
 #include "exception.h"
 #include "bip32.h"
+#include "cx.h"
 #include "os.h"
 #include "os_io_seproxyhal.h"
 
@@ -48,16 +49,40 @@ typedef enum {
     DERIVATION_TYPE_SECP256K1 = 1,
     DERIVATION_TYPE_SECP256R1 = 2,
     DERIVATION_TYPE_ED25519 = 3,
-    DERIVATION_TYPE_BIP32_ED25519 = 4
+    DERIVATION_TYPE_BIP32_ED25519 = 4,
+    DERIVATION_TYPE_BLS12_381 = 5
 } derivation_type_t;
 
 typedef enum {
     SIGNATURE_TYPE_UNSET = 0,
     SIGNATURE_TYPE_SECP256K1 = 1,
     SIGNATURE_TYPE_SECP256R1 = 2,
-    SIGNATURE_TYPE_ED25519 = 3
+    SIGNATURE_TYPE_ED25519 = 3,
+    SIGNATURE_TYPE_BLS12_381 = 4
 } signature_type_t;
 
+/// Derivation type of the keys of an app specialized for a single
+/// curve, see `SINGLE_CURVE` in the Makefile, and signature schemes
+/// the app is built for
+#if defined(SINGLE_CURVE_SECP256K1)
+#define SINGLE_DERIVATION_TYPE DERIVATION_TYPE_SECP256K1
+#define HAVE_ECDSA_KEYS
+#elif defined(SINGLE_CURVE_SECP256R1)
+#define SINGLE_DERIVATION_TYPE DERIVATION_TYPE_SECP256R1
+#define HAVE_ECDSA_KEYS
+#elif defined(SINGLE_CURVE_ED25519)
+#define SINGLE_DERIVATION_TYPE DERIVATION_TYPE_ED25519
+#define HAVE_EDDSA_KEYS
+#elif defined(SINGLE_CURVE_BIP32_ED25519)
+#define SINGLE_DERIVATION_TYPE DERIVATION_TYPE_BIP32_ED25519
+#define HAVE_EDDSA_KEYS
+#elif defined(SINGLE_CURVE_BLS12_381)
+#define SINGLE_DERIVATION_TYPE DERIVATION_TYPE_BLS12_381
+#else
+#define HAVE_ECDSA_KEYS
+#define HAVE_EDDSA_KEYS
+#endif
+
 /**
  * @brief Type of baking message
  *
@@ -68,6 +93,9 @@ typedef enum {
     BAKING_TYPE_PREATTESTATION
 } baking_type_t;
 
+/// Number of baking message types
+#define BAKING_TYPE_COUNT 3u
+
 /**
  * @brief magic byte of operations
  * See: https://tezos.gitlab.io/user/key-management.html#signer-requests
@@ -196,23 +224,112 @@ typedef struct {
     bool had_preattestation;  ///< if a pre-attestation has been seen at current level/round
 } high_watermark_t;
 
+/// Number of chains, other than the main chain, having their own HWM
+#ifdef TARGET_NANOS
+#define HWM_CHAIN_SLOTS 2u
+#else
+#define HWM_CHAIN_SLOTS 8u
+#endif
+
 /**
- * @brief This structure represents data store in NVRAM
+ * @brief This structure represents the HWM of a chain other than the main chain
  *
  */
 typedef struct {
-    chain_id_t main_chain_id;  ///< main chain id
+    chain_id_t chain_id;   ///< chain id, 0 if the slot is free
+    high_watermark_t hwm;  ///< HWM of the chain
+} chain_high_watermark_t;
+
+/**
+ * @brief This structure represents the high watermarks information
+ *
+ */
+typedef struct {
+    high_watermark_t main;                           ///< HWM of main
+    high_watermark_t test;                           ///< HWM of the test chains without a slot
+    chain_high_watermark_t chains[HWM_CHAIN_SLOTS];  ///< HWM of the test chains with a slot
+} high_watermarks_t;
+
+/// Number of keys authorized in addition to the authorized key
+#ifdef TARGET_NANOS
+#define MAX_COMPANION_KEYS 1u
+#else
+#define MAX_COMPANION_KEYS 2u
+#endif
+
+/**
+ * @brief This structure represents the signing statistics of a key
+ *
+ *        The device has no clock: the last signature is dated by its level
+ *
+ */
+typedef struct {
+    uint32_t signatures[BAKING_TYPE_COUNT];  ///< number of signatures per `baking_type_t`
+    level_t last_level;                      ///< level of the last signed baking message
+} sign_stats_t;
+
+/**
+ * @brief This structure represents a key authorized in addition to the authorized key
+ *
+ *        Each companion key has its own HWM, a companion key can
+ *        sign the same level and round as the authorized key.
+ *
+ */
+typedef struct {
+    bip32_path_with_curve_t key;  ///< authorized key, its path is empty if the slot is free
+    uint32_t key_hash;            ///< hash of the key, compared first on lookups
+    high_watermark_t main;        ///< HWM of main
+    high_watermark_t test;        ///< HWM of test
+    sign_stats_t stats;           ///< signing statistics, stored along with the HWM
+} companion_key_t;
+
+#define KEY_HASH_SIZE 20u
 
-    /// high watermarks information
-    struct {
-        high_watermark_t main;  ///< HWM of main
-        high_watermark_t test;  ///< HWM of test
-    } hwm;
+#define BLS_PUBLIC_KEY_SIZE 48u  // compressed G1 point
+#define BLS_SIGNATURE_SIZE  96u  // compressed G2 point
 
-    bip32_path_with_curve_t baking_key;  ///< authorized key
-    bool hwm_disabled;                   /**< Set HWM setting on/off,
-                                              e.g. if you are using signer assisted HWM,
-                                              no need to track HWM using Ledger.*/
+#ifdef HAVE_BLS
+#define MAX_COMPRESSED_PUBLIC_KEY_SIZE BLS_PUBLIC_KEY_SIZE
+#else
+#define MAX_COMPRESSED_PUBLIC_KEY_SIZE 33u
+#endif
+
+/**
+ * @brief This structure represents the data derived from the authorized key
+ *
+ *        Derived once when the key is authorized, instead of on each
+ *        start of the app. `key` guards the data against a mismatch
+ *        with the path and the curve of the authorized key.
+ *
+ */
+typedef struct {
+    bool is_set;                                         ///< if the data is derived from the key
+    bip32_path_with_curve_t key;                         ///< key the data is derived from
+    uint8_t public_key[MAX_COMPRESSED_PUBLIC_KEY_SIZE];  ///< compressed public key of the key
+    uint8_t public_key_length;                           ///< length of `public_key`
+    uint8_t pkh[KEY_HASH_SIZE];                          ///< public key hash of the key
+} baking_key_derived_t;
+
+/**
+ * @brief This structure represents data store in NVRAM
+ *
+ */
+typedef struct {
+    chain_id_t main_chain_id;  ///< main chain id
+    high_watermarks_t hwm;     ///< high watermarks information
+
+    bip32_path_with_curve_t baking_key;                  ///< authorized key
+    baking_key_derived_t baking_key_derived;             ///< data derived from baking_key
+    sign_stats_t sign_stats;                             ///< signing statistics of baking_key
+    companion_key_t companion_keys[MAX_COMPANION_KEYS];  ///< companion keys
+    bool hwm_disabled;                                   /**< Set HWM setting on/off,
+                                                              e.g. if you are using signer
+                                                              assisted HWM, no need to track
+                                                              HWM using Ledger.*/
+    bool hwm_level_only;                                 /**< If the HWM only tracks levels,
+                                                              e.g. if the signer tracks the
+                                                              rounds, only a level regression
+                                                              is refused.*/
 } baking_data;
 
 #define SIGN_HASH_SIZE 32u
@@ -222,7 +339,19 @@ typedef struct {
 #define PROTOCOL_HASH_BASE58_STRING_SIZE \
     sizeof("ProtoBetaBetaBetaBetaBetaBetaBetaBetaBet11111a5ug96")
 
-#define KEY_HASH_SIZE 20u
+#ifdef HAVE_BLS
+/**
+ * @brief This structure represents the state needed to hash messages to a BLS12-381 curve
+ *
+ *        BLS12-381 keys sign the message itself, not its blake2b hash.
+ *        The state holds the sha256 of `expand_message_xmd` absorbing
+ *        the message, see `bls_hash_update`.
+ */
+typedef struct {
+    cx_sha256_t state;  ///< sha256 state
+    bool initialized;   ///< if the state has already been initialized
+} bls_hash_state_t;
+#endif
 
 /**
  * @brief This structure represents the content of a parsed baking data
@@ -275,12 +404,13 @@ struct parsed_operation {
  *
  */
 struct parsed_operation_group {
-    cx_ecfp_public_key_t public_key;    ///< signer public key
-    uint64_t total_fee;                 ///< sum of all fees
-    uint64_t total_storage_limit;       ///< sum of all storage limits
-    bool has_reveal;                    ///< if the bundle contains at least a reveal
-    struct parsed_contract signing;     ///< contract form of signer
-    struct parsed_operation operation;  ///< operation parsed
+    uint8_t public_key[MAX_COMPRESSED_PUBLIC_KEY_SIZE];  ///< compressed signer public key
+    uint8_t public_key_length;                           ///< length of `public_key`
+    uint64_t total_fee;                                  ///< sum of all fees
+    uint64_t total_storage_limit;                        ///< sum of all storage limits
+    bool has_reveal;                                     ///< if the bundle has at least a reveal
+    struct parsed_contract signing;                      ///< contract form of signer
+    struct parsed_operation operation;                   ///< operation parsed
 };
 
 #define CUSTOM_MAX(a, b)                     \
@@ -42,16 +42,18 @@ void __attribute__((noreturn)) app_exit(void);
 
 #ifdef HAVE_BAGL
 
-#ifdef TARGET_NANOS
 /**
  * @brief Sets low-cost display mode
  *
- *       Low-cost display stop handling `TICKER_EVENT`
+ *       Low-cost display stop handling `TICKER_EVENT`, the display is
+ *       only refreshed once per second, out of the signatures
+ *
+ *       The mode starts with a baking signature or after 2 min on the
+ *       home screen without user interaction
  *
  * @param enable: if enable the mode or not
  */
 void ux_set_low_cost_display_mode(bool enable);
-#endif  // HAVE_BAGL
 
 /**
  * @brief Calculates the chain id for the idle screens
@@ -74,6 +76,15 @@ tz_exc calculate_idle_screen_authorized_key(void);
  */
 tz_exc calculate_idle_screen_hwm(void);
 
+/**
+ * @brief Marks the HWM of the idle screens as outdated
+ *
+ *        The HWM will be calculated again before being displayed,
+ *        outside of the signing path
+ *
+ */
+void invalidate_idle_screen_hwm(void);
+
 /**
  * @brief Calculates baking values for the idle screens
  *
@@ -115,3 +126,13 @@ extern const ux_flow_step_t ux_prompt_flow_accept_step;
 void refresh_screens(void);
 
 #endif  // HAVE_BAGL
+
+/**
+ * @brief Marks the chain id and the authorized key of the idle screens as outdated
+ *
+ *        They only change on setup and authorization, they are
+ *        calculated again on the next ticks on BAGL devices, and the
+ *        next time the settings pages are built on NBGL devices
+ *
+ */
+void invalidate_idle_screen_strings(void);
@@ -28,6 +28,7 @@
 #include "exception.h"
 #include "globals.h"
 #include "glyphs.h"  // ui-menu
+#include "io.h"
 #include "keys.h"
 #include "memory.h"
 #include "os_cx.h"  // ui-menu
@@ -39,13 +40,19 @@
 
 #define G_display global.dynamic_display
 
-#ifdef TARGET_NANOS
-#include "io.h"
+/// Ticks without user interaction on the home screen before the low-cost display mode starts
+#define LOW_COST_DISPLAY_IDLE_TICKS 1200u  // 2 min
+/// Ticks between two refreshes of the display in low-cost display mode
+#define LOW_COST_DISPLAY_REFRESH_TICKS 10u  // 1 s
+
+static void update_idle_screen_hwm(void);
+static void low_cost_display_apply_tick(void);
 
 void ux_set_low_cost_display_mode(bool enable) {
     if (G_display.low_cost_display_mode != enable) {
         G_display.low_cost_display_mode = enable;
         if (G_display.low_cost_display_mode) {
+            G_display.refresh_ticks = 0u;
             ux_screensaver_start_clock();
         } else {
             ux_screensaver_stop();
@@ -71,6 +78,7 @@ uint8_t io_event(uint8_t channel) {
         case SEPROXYHAL_TAG_BUTTON_PUSH_EVENT:
             // Pressing any button will stop the low-cost display mode.
             ux_set_low_cost_display_mode(false);
+            G_display.idle_ticks = 0u;
             UX_BUTTON_PUSH_EVENT(G_io_seproxyhal_spi_buffer);
             break;
         case SEPROXYHAL_TAG_STATUS_EVENT:
@@ -100,7 +108,7 @@ uint8_t io_event(uint8_t channel) {
                 app_ticker_event_callback();
                 UX_TICKER_EVENT(G_io_seproxyhal_spi_buffer, {});
             } else {
-                ux_screensaver_apply_tick();
+                low_cost_display_apply_tick();
             }
             break;
         default:
@@ -115,8 +123,6 @@ uint8_t io_event(uint8_t channel) {
     return 1;
 }
 
-#endif  // TARGET_NANOS
-
 static void ui_refresh_idle_hwm_screen(void);
 
 /**
@@ -128,6 +134,9 @@ typedef struct {
     char authorized_key[PKH_STRING_SIZE];
     char hwm[MAX_INT_DIGITS + 1u + MAX_INT_DIGITS + 1u];
     char hwm_status[HWM_STATUS_SIZE];
+    bool hwm_is_outdated;  ///< if `hwm` must be calculated again
+    bool strings_are_set;  ///< if `chain_id` and `authorized_key` are up to date
+    bool is_displayed;     ///< if the idle flow is displayed
 } HomeContext_t;
 
 /// Current home context
@@ -173,6 +182,9 @@ UX_FLOW(ux_idle_flow,
         FLOW_LOOP);
 
 void ui_menu_init(void) {
+    update_idle_screen_hwm();
+    home_context.is_displayed = true;
+    G_display.idle_ticks = 0u;
     ux_flow_init(0, ux_idle_flow, NULL);
 }
 
@@ -188,6 +200,7 @@ void ui_settings(void) {
     hwm_status_to_string(home_context.hwm_status,
                          sizeof(home_context.hwm_status),
                          &g_hwm.hwm_disabled);
+    home_context.is_displayed = false;
     ux_flow_init(0, ux_settings_flow, NULL);
 }
 
@@ -233,6 +246,8 @@ end:
 tz_exc calculate_idle_screen_hwm(void) {
     tz_exc exc = SW_OK;
 
+    home_context.hwm_is_outdated = false;
+
     memset(&home_context.hwm, 0, sizeof(home_context.hwm));
 
     TZ_ASSERT(hwm_to_string(home_context.hwm, sizeof(home_context.hwm), &g_hwm.hwm.main) >= 0,
@@ -242,12 +257,84 @@ end:
     return exc;
 }
 
+void invalidate_idle_screen_hwm(void) {
+    home_context.hwm_is_outdated = true;
+}
+
+/**
+ * @brief Calculates the HWM for the idle screens if it is outdated
+ *
+ */
+static void update_idle_screen_hwm(void) {
+    if (home_context.hwm_is_outdated) {
+        // Ignore calculation errors
+        calculate_idle_screen_hwm();
+    }
+}
+
+/**
+ * @brief Calculates the chain id and the authorized key for the idle
+ *        screens if they are outdated
+ *
+ *        Calculated on ticks rather than when the idle screens are
+ *        displayed, so that APDUs are served as soon as the app starts.
+ *        Never calculated between the packets of a signature.
+ *
+ */
+static void update_idle_screen_strings(void) {
+    if (!home_context.strings_are_set && !G_display.sign_in_flight) {
+        // Ignore calculation errors
+        calculate_baking_idle_screens_data();
+    }
+}
+
+void app_ticker_event_callback(void) {
+    update_idle_screen_strings();
+    update_idle_screen_hwm();
+    // A home screen left alone switches to the low-cost display mode
+    if (home_context.is_displayed && !g_prompt.is_pending) {
+        G_display.idle_ticks++;
+        if (G_display.idle_ticks >= LOW_COST_DISPLAY_IDLE_TICKS) {
+            ux_set_low_cost_display_mode(true);
+        }
+    }
+}
+
+/**
+ * @brief Applies one tick to the low-cost display mode
+ *
+ *        The HWM screen and the screensaver are refreshed together,
+ *        once every `LOW_COST_DISPLAY_REFRESH_TICKS` ticks, and never
+ *        between the packets of a signature
+ *
+ */
+static void low_cost_display_apply_tick(void) {
+    if (G_display.refresh_ticks < LOW_COST_DISPLAY_REFRESH_TICKS) {
+        G_display.refresh_ticks++;
+    }
+    if ((G_display.refresh_ticks < LOW_COST_DISPLAY_REFRESH_TICKS) || G_display.sign_in_flight) {
+        return;
+    }
+    G_display.refresh_ticks = 0u;
+    update_idle_screen_hwm();
+    ux_screensaver_apply_ticks(LOW_COST_DISPLAY_REFRESH_TICKS);
+}
+
+void invalidate_idle_screen_strings(void) {
+    home_context.strings_are_set = false;
+}
+
 tz_exc calculate_baking_idle_screens_data(void) {
     tz_exc exc = SW_OK;
 
-    TZ_CHECK(calculate_idle_screen_chain_id());
+    if (!home_context.strings_are_set) {
+        // Not calculated again on each tick if it fails
+        home_context.strings_are_set = true;
 
-    TZ_CHECK(calculate_idle_screen_authorized_key());
+        TZ_CHECK(calculate_idle_screen_chain_id());
+
+        TZ_CHECK(calculate_idle_screen_authorized_key());
+    }
 
     TZ_CHECK(calculate_idle_screen_hwm());
 
@@ -256,19 +343,16 @@ end:
 }
 
 void ui_initial_screen(void) {
-    tz_exc exc = SW_OK;
-
     // reserve a display stack slot if none yet
     if (G_ux.stack_count == 0) {
         ux_stack_push();
     }
 
-    TZ_CHECK(calculate_baking_idle_screens_data());
+    // The chain id and the authorized key are calculated on the next
+    // ticks, `ui_menu_init` calculates the HWM
+    invalidate_idle_screen_hwm();
 
     ui_menu_init();
-    return;
-end:
-    TZ_EXC_PRINT(exc);
 }
 
 /**
@@ -278,10 +362,13 @@ end:
  *
  */
 static void ui_refresh_idle_hwm_screen(void) {
+    update_idle_screen_hwm();
+    home_context.is_displayed = true;
     ux_flow_init(0, ux_idle_flow, &ux_hwm_step);
 }
 
 void ux_prepare_confirm_callbacks(ui_callback_t ok_c, ui_callback_t cxl_c) {
+    home_context.is_displayed = false;
     if (ok_c) {
         G_display.ok_callback = ok_c;
     }
@@ -34,7 +34,7 @@
 
 #include <string.h>
 
-#define G global.apdu.u.sign
+#define G global.apdu.u.sign.message
 
 /**
  * @brief This structure represents a context needed for delegation screens navigation
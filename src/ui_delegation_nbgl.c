@@ -34,7 +34,7 @@
 
 #include <string.h>
 
-#define G global.apdu.u.sign
+#define G global.apdu.u.sign.message
 
 #define MAX_LENGTH 100
 
@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "nbgl_screen.h"
 #include "nbgl_use_case.h"
 
 static const char* const infoTypes[] = {"Version", "Developer", "Copyright"};
@@ -43,6 +44,18 @@ static const char* const infoContents[] = {APPVERSION, "Ledger", "(c) 2023 Ledge
 #define MAX_LENGTH 200
 static char* bakeInfoContents[3];
 static char buffer[3][MAX_LENGTH];
+/// if the chain id and the authorized key in `buffer` are up to date
+static bool buffer_strings_are_set = false;
+
+/// Ticks between two refreshes of the displayed HWM
+#define HWM_REFRESH_TICKS 50u  // 5 s
+
+/// HWM written in `buffer`
+static high_watermark_t displayed_hwm = {0};
+/// if the page displaying `buffer` is on screen
+static bool hwm_is_displayed = false;
+/// Ticks since the last refresh of the displayed HWM
+static uint8_t hwm_refresh_ticks = 0u;
 
 static const char* const bakeInfoTypes[] = {
     "Chain",
@@ -79,18 +92,27 @@ static bool navigation_cb_baking(uint8_t page, nbgl_pageContent_t* content) {
     bakeInfoContents[2] = buffer[2];
     const bool hwm_disabled = g_hwm.hwm_disabled;
 
-    TZ_ASSERT(
-        chain_id_to_string_with_aliases(buffer[0], sizeof(buffer[0]), &g_hwm.main_chain_id) >= 0,
-        EXC_WRONG_LENGTH);
-
-    if (g_hwm.baking_key.bip32_path.length == 0u) {
-        TZ_ASSERT(copy_string(buffer[1], sizeof(buffer[1]), "No Key Authorized"), EXC_WRONG_LENGTH);
-    } else {
-        TZ_CHECK(
-            bip32_path_with_curve_to_pkh_string(buffer[1], sizeof(buffer[1]), &g_hwm.baking_key));
+    if (!buffer_strings_are_set) {
+        TZ_ASSERT(chain_id_to_string_with_aliases(buffer[0],
+                                                  sizeof(buffer[0]),
+                                                  &g_hwm.main_chain_id) >= 0,
+                  EXC_WRONG_LENGTH);
+
+        if (g_hwm.baking_key.bip32_path.length == 0u) {
+            TZ_ASSERT(copy_string(buffer[1], sizeof(buffer[1]), "No Key Authorized"),
+                      EXC_WRONG_LENGTH);
+        } else {
+            TZ_CHECK(bip32_path_with_curve_to_pkh_string(buffer[1],
+                                                         sizeof(buffer[1]),
+                                                         &g_hwm.baking_key));
+        }
+
+        buffer_strings_are_set = true;
     }
 
     TZ_ASSERT(hwm_to_string(buffer[2], sizeof(buffer[2]), &g_hwm.hwm.main) >= 0, EXC_WRONG_LENGTH);
+    memcpy(&displayed_hwm, &g_hwm.hwm.main, sizeof(displayed_hwm));
+    hwm_is_displayed = (page == 0u);
 
     switch (page) {
         case 0:
@@ -124,6 +146,10 @@ end:
     return true;
 }
 
+void invalidate_idle_screen_strings(void) {
+    buffer_strings_are_set = false;
+}
+
 static void controls_callback(int token, uint8_t index) {
     UNUSED(index);
     if (token == HWM_ENABLED_TOKEN) {
@@ -149,9 +175,48 @@ static void ui_menu_about_baking(void) {
                          controls_callback);
 }
 
+/**
+ * @brief Refreshes the displayed HWM if it changed
+ *
+ *        Only the HWM text is updated, the page is not rebuilt. The
+ *        screen is refreshed at most once every `HWM_REFRESH_TICKS`
+ *        ticks, and never between the packets of a signature
+ *
+ */
+static void refresh_displayed_hwm(void) {
+    if (hwm_refresh_ticks < HWM_REFRESH_TICKS) {
+        hwm_refresh_ticks++;
+    }
+
+    if (!hwm_is_displayed || g_prompt.is_pending || global.dynamic_display.sign_in_flight ||
+        (hwm_refresh_ticks < HWM_REFRESH_TICKS)) {
+        return;
+    }
+
+    if ((displayed_hwm.highest_level == g_hwm.hwm.main.highest_level) &&
+        (displayed_hwm.highest_round == g_hwm.hwm.main.highest_round)) {
+        return;
+    }
+
+    if (hwm_to_string(buffer[2], sizeof(buffer[2]), &g_hwm.hwm.main) < 0) {
+        return;
+    }
+    memcpy(&displayed_hwm, &g_hwm.hwm.main, sizeof(displayed_hwm));
+    hwm_refresh_ticks = 0u;
+
+    // The page displays `buffer`, it only needs to be redrawn
+    nbgl_screenRedraw();
+    nbgl_refreshSpecial(FULL_COLOR_PARTIAL_REFRESH);
+}
+
+void app_ticker_event_callback(void) {
+    refresh_displayed_hwm();
+}
+
 #define SETTINGS_BUTTON_ENABLED (true)
 
 void ui_initial_screen(void) {
+    hwm_is_displayed = false;
     nbgl_useCaseHome("Tezos Baking",
                      &C_tezos,
                      NULL,
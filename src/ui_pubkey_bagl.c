@@ -60,7 +60,7 @@ int prompt_pubkey(bool authorize, ui_callback_t ok_cb, ui_callback_t cxl_cb) {
 
     TZ_CHECK(bip32_path_with_curve_to_pkh_string(address_context.public_key_hash,
                                                  sizeof(address_context.public_key_hash),
-                                                 &global.path_with_curve));
+                                                 &g_prompt.u.request.path_with_curve));
 
     ux_prepare_confirm_callbacks(ok_cb, cxl_cb);
     if (authorize) {
@@ -68,7 +68,7 @@ int prompt_pubkey(bool authorize, ui_callback_t ok_cb, ui_callback_t cxl_cb) {
     } else {
         ux_flow_init(0, ux_provide_flow, NULL);
     }
-    return 0;
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
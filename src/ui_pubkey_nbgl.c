@@ -33,8 +33,6 @@
 
 #include <string.h>
 
-#define G global.apdu.u.baking
-
 /**
  * @brief This structure represents a context needed for address screens navigation
  *
@@ -95,7 +93,7 @@ int prompt_pubkey(bool authorize, ui_callback_t ok_cb, ui_callback_t cxl_cb) {
 
     TZ_CHECK(bip32_path_with_curve_to_pkh_string(address_context.buffer,
                                                  sizeof(address_context.buffer),
-                                                 &global.path_with_curve));
+                                                 &g_prompt.u.request.path_with_curve));
 
     const char* text;
     if (authorize) {
@@ -104,7 +102,7 @@ int prompt_pubkey(bool authorize, ui_callback_t ok_cb, ui_callback_t cxl_cb) {
         text = "Verify Tezos\naddress";
     }
     nbgl_useCaseReviewStart(&C_tezos, text, NULL, "Cancel", verify_address_page, cancel_callback);
-    return 0;
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
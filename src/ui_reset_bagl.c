@@ -33,7 +33,7 @@
 
 #include <string.h>
 
-#define G global.apdu.u.baking
+#define G g_prompt.u.request.u.baking
 
 /**
  * @brief This structure represents a context needed for reset screens navigation
@@ -62,7 +62,7 @@ int prompt_reset(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
 
     ux_prepare_confirm_callbacks(ok_cb, cxl_cb);
     ux_flow_init(0, ux_reset_flow, NULL);
-    return 0;
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
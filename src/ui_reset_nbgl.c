@@ -33,7 +33,7 @@
 #include <string.h>
 
 #include "nbgl_use_case.h"
-#define G global.apdu.u.baking
+#define G g_prompt.u.request.u.baking
 
 /**
  * @brief This structure represents a context needed for reset screens navigation
@@ -113,7 +113,7 @@ int prompt_reset(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
                             "Cancel",
                             confirm_reset_page,
                             cancel_callback);
-    return 0;
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
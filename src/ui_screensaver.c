@@ -112,13 +112,13 @@ void ux_screensaver_stop_clock(void) {
     G_screensaver_state.clock.on = false;
 }
 
-void ux_screensaver_apply_tick(void) {
+void ux_screensaver_apply_ticks(unsigned int ticks) {
     if (G_screensaver_state.clock.on) {
-        if (G_screensaver_state.clock.timeout < MS) {
+        if (G_screensaver_state.clock.timeout < (ticks * MS)) {
             ui_start_screensaver();
             ux_screensaver_stop_clock();
         } else {
-            G_screensaver_state.clock.timeout -= MS;
+            G_screensaver_state.clock.timeout -= ticks * MS;
         }
     }
 }
@@ -42,8 +42,6 @@ typedef struct {
  *
  *        Waits a click to return to home screen
  *
- *        Applies only for Nanos devices
- *
  */
 void ui_start_screensaver(void);
 
@@ -66,11 +64,12 @@ void ux_screensaver_start_clock(void);
 void ux_screensaver_stop_clock(void);
 
 /**
- * @brief Apply one tick to the clock
+ * @brief Apply ticks to the clock
  *
- *        The tick is assumed to be 100 ms
+ *        A tick is assumed to be 100 ms
  *
+ * @param ticks: number of ticks elapsed
  */
-void ux_screensaver_apply_tick(void);
+void ux_screensaver_apply_ticks(unsigned int ticks);
 
 #endif
@@ -33,7 +33,7 @@
 
 #include <string.h>
 
-#define G global.apdu.u.setup
+#define G g_prompt.u.request.u.setup
 
 /**
  * @brief This structure represents a context needed for setup screens navigation
@@ -55,6 +55,8 @@ UX_STEP_NOCB(ux_chain_step, bnnn_paging, {"Chain", setup_context.chain});
 UX_STEP_NOCB(ux_main_hwm_step, bnnn_paging, {"Main Chain HWM", setup_context.main_hwm});
 UX_STEP_NOCB(ux_test_hwm_step, bnnn_paging, {"Test Chain HWM", setup_context.test_hwm});
 
+UX_STEP_NOCB(ux_hwm_level_only_step, bnnn_paging, {"HWM Tracking", "Level only"});
+
 UX_CONFIRM_FLOW(ux_setup_flow,
                 &ux_setup_step,
                 &ux_address_step,
@@ -62,6 +64,14 @@ UX_CONFIRM_FLOW(ux_setup_flow,
                 &ux_main_hwm_step,
                 &ux_test_hwm_step);
 
+UX_CONFIRM_FLOW(ux_setup_level_only_flow,
+                &ux_setup_step,
+                &ux_address_step,
+                &ux_chain_step,
+                &ux_main_hwm_step,
+                &ux_test_hwm_step,
+                &ux_hwm_level_only_step);
+
 int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
     tz_exc exc = SW_OK;
 
@@ -69,7 +79,7 @@ int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
 
     TZ_CHECK(bip32_path_with_curve_to_pkh_string(setup_context.address,
                                                  sizeof(setup_context.address),
-                                                 &global.path_with_curve));
+                                                 &g_prompt.u.request.path_with_curve));
 
     TZ_ASSERT(chain_id_to_string_with_aliases(setup_context.chain,
                                               sizeof(setup_context.chain),
@@ -85,8 +95,12 @@ int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
         EXC_WRONG_LENGTH);
 
     ux_prepare_confirm_callbacks(ok_cb, cxl_cb);
-    ux_flow_init(0, ux_setup_flow, NULL);
-    return 0;
+    if (G.hwm_level_only) {
+        ux_flow_init(0, ux_setup_level_only_flow, NULL);
+    } else {
+        ux_flow_init(0, ux_setup_flow, NULL);
+    }
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
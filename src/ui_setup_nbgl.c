@@ -33,7 +33,7 @@
 
 #include <string.h>
 
-#define G global.apdu.u.setup
+#define G g_prompt.u.request.u.setup
 
 #define MAX_LENGTH 100
 
@@ -44,7 +44,7 @@
 typedef struct {
     ui_callback_t ok_cb;   /// accept callback
     ui_callback_t cxl_cb;  /// cancel callback
-    nbgl_layoutTagValue_t tagValuePair[4];
+    nbgl_layoutTagValue_t tagValuePair[5];
     nbgl_layoutTagValueList_t tagValueList;
     nbgl_pageInfoLongPress_t infoLongPress;
     char buffer[4][MAX_LENGTH];  /// values buffers
@@ -100,7 +100,7 @@ int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
 
     TZ_CHECK(bip32_path_with_curve_to_pkh_string(setup_context.buffer[0],
                                                  sizeof(setup_context.buffer[0]),
-                                                 &global.path_with_curve));
+                                                 &g_prompt.u.request.path_with_curve));
 
     TZ_ASSERT(chain_id_to_string_with_aliases(setup_context.buffer[1],
                                               sizeof(setup_context.buffer[1]),
@@ -128,6 +128,12 @@ int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
     setup_context.tagValuePair[3].value = setup_context.buffer[3];
 
     setup_context.tagValueList.nbPairs = 4;
+
+    if (G.hwm_level_only) {
+        setup_context.tagValuePair[4].item = "HWM Tracking";
+        setup_context.tagValuePair[4].value = "Level only";
+        setup_context.tagValueList.nbPairs = 5;
+    }
     setup_context.tagValueList.pairs = setup_context.tagValuePair;
 
     setup_context.infoLongPress.text = "Confirm baking setup";
@@ -138,7 +144,7 @@ int prompt_setup(ui_callback_t const ok_cb, ui_callback_t const cxl_cb) {
                             "Cancel",
                             confirm_setup_page,
                             cancel_callback);
-    return 0;
+    return prompt_displayed();
 
 end:
     return io_send_apdu_err(exc);
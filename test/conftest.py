@@ -15,20 +15,74 @@
 
 """Pytest configuration file."""
 
+import sys
+from pathlib import Path
+from typing import Generator, List, Optional
+
 import pytest
 from ragger.backend import BackendInterface
 from ragger.conftest import configuration
 from ragger.firmware import Firmware
 from ragger.navigator import Navigator
+from utils.benchmark import BenchmarkResult, write_results
 from utils.client import TezosClient
+from utils.helper import get_current_commit
 from utils.navigator import TezosNavigator
 from common import DEFAULT_SEED
 
 configuration.OPTIONAL.CUSTOM_SEED = DEFAULT_SEED
 
+# The host client is tested from its sources
+sys.path.insert(0, str(Path(__file__).parent.parent / "client"))
+
 # Pull all features from the base ragger conftest using the overridden configuration
 pytest_plugins = ("ragger.conftest.base_conftest", )
 
+def pytest_addoption(parser):
+    """Add the benchmark options."""
+    parser.addoption("--benchmark-output", action="store", default=None,
+                     help="Run the benchmarks and write their results in this JSON file")
+    parser.addoption("--benchmark-iterations", action="store", type=int, default=50,
+                     help="Number of requests measured by each benchmark")
+    parser.addoption("--replay-trace", action="store", default=None,
+                     help="Trace of APDUs replayed by the replay benchmark")
+
+@pytest.fixture(scope="session")
+def benchmark_iterations(pytestconfig) -> int:
+    """Get the number of requests measured by each benchmark."""
+    return pytestconfig.getoption("benchmark_iterations")
+
+@pytest.fixture(scope="session")
+def replay_trace(pytestconfig) -> Path:
+    """Get the trace replayed by the replay benchmark.
+
+    The replay benchmark is skipped if no trace is given."""
+    trace: Optional[str] = pytestconfig.getoption("replay_trace")
+    if trace is None:
+        pytest.skip("Replay benchmark requires --replay-trace")
+    return Path(trace)
+
+@pytest.fixture(scope="session")
+def benchmark_results(
+        pytestconfig,
+        firmware: Firmware,
+        backend_name: str) -> Generator[List[BenchmarkResult], None, None]:
+    """Get the benchmark results, written once all benchmarks have run.
+
+    Benchmarks are skipped if no output file is given."""
+    output: Optional[str] = pytestconfig.getoption("benchmark_output")
+    if output is None:
+        pytest.skip("Benchmarks require --benchmark-output")
+
+    results: List[BenchmarkResult] = []
+    yield results
+
+    write_results(results, Path(output), {
+        "commit": get_current_commit(),
+        "device": firmware.name,
+        "backend": backend_name,
+    })
+
 @pytest.fixture(scope="function")
 def client(backend: BackendInterface) -> TezosClient:
     """Get a tezos client."""
@@ -0,0 +1,140 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Module gathering the baking app latency benchmarks.
+
+The benchmarks only run with `--benchmark-output <file.json>`."""
+
+from pathlib import Path
+from typing import Callable, Dict, List
+
+import pytest
+
+from utils.account import Account
+from utils.benchmark import BenchmarkResult, measure
+from utils.client import TezosClient, Hwm
+from utils.message import (
+    Message,
+    Preattestation,
+    Attestation,
+    Fitness,
+    BlockHeader,
+    Block,
+    DEFAULT_CHAIN_ID
+)
+from utils.navigator import TezosNavigator
+from utils.replay import read_trace, replay
+from common import ZEBRA_ACCOUNTS
+
+# Each iteration is signed at a new level
+BAKING_MESSAGES: Dict[str, Callable[[int], Message]] = {
+    "block": lambda level: Block(
+        header=BlockHeader(level=level, fitness=Fitness(current_round=0))
+    ).forge(chain_id=DEFAULT_CHAIN_ID),
+    "preattestation": lambda level: Preattestation(
+        op_level=level, op_round=0
+    ).forge(chain_id=DEFAULT_CHAIN_ID),
+    "attestation": lambda level: Attestation(
+        op_level=level, op_round=0
+    ).forge(chain_id=DEFAULT_CHAIN_ID),
+}
+
+
+@pytest.mark.parametrize("account", ZEBRA_ACCOUNTS)
+@pytest.mark.parametrize("kind", list(BAKING_MESSAGES))
+@pytest.mark.parametrize("with_hash", [False, True])
+def test_benchmark_sign(
+        account: Account,
+        kind: str,
+        with_hash: bool,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator,
+        benchmark_results: List[BenchmarkResult],
+        benchmark_iterations: int) -> None:
+    """Benchmark the SIGN and SIGN_WITH_HASH instructions on baking messages."""
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    build_message = BAKING_MESSAGES[kind]
+    sign = client.sign_message_with_hash if with_hash else client.sign_message
+
+    result = measure(
+        f"sign_with_hash_{kind}" if with_hash else f"sign_{kind}",
+        account.sig_scheme.name,
+        lambda i: sign(account, build_message(i + 1)),
+        benchmark_iterations
+    )
+    benchmark_results.append(result)
+
+    _, main_hwm, _ = client.get_all_hwm()
+    assert main_hwm.highest_level == benchmark_iterations, \
+        f"Expected main hwm at level {benchmark_iterations} but got {main_hwm}"
+
+
+@pytest.mark.parametrize("account", ZEBRA_ACCOUNTS)
+def test_benchmark_get_public_key(
+        account: Account,
+        client: TezosClient,
+        benchmark_results: List[BenchmarkResult],
+        benchmark_iterations: int) -> None:
+    """Benchmark the GET_PUBLIC_KEY instruction."""
+
+    result = measure(
+        "get_public_key",
+        account.sig_scheme.name,
+        lambda _: client.get_public_key_silent(account),
+        benchmark_iterations
+    )
+    benchmark_results.append(result)
+
+
+@pytest.mark.parametrize("account", ZEBRA_ACCOUNTS)
+def test_benchmark_hmac(
+        account: Account,
+        client: TezosClient,
+        benchmark_results: List[BenchmarkResult],
+        benchmark_iterations: int) -> None:
+    """Benchmark the HMAC instruction."""
+
+    message = bytes.fromhex("00" * 32)
+
+    result = measure(
+        "hmac",
+        account.sig_scheme.name,
+        lambda _: client.hmac(account, message),
+        benchmark_iterations
+    )
+    benchmark_results.append(result)
+
+
+def test_benchmark_replay(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator,
+        benchmark_results: List[BenchmarkResult],
+        replay_trace: Path) -> None:
+    """Benchmark the replay of a recorded trace of APDUs.
+
+    The queueing and service times of its signatures are reported."""
+
+    report = replay(client, read_trace(replay_trace), on_prompt=tezos_navigator.replay_prompt)
+    assert report.signatures, f"No signature in {replay_trace}"
+
+    benchmark_results.append(report.queueing)
+    benchmark_results.append(report.service)
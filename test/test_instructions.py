@@ -18,20 +18,28 @@
 from pathlib import Path
 from typing import Callable, Optional, Tuple
 
+import copy
 import hashlib
 import hmac
+import json
 import time
 
 import pytest
+from py_ecc.bls import G2MessageAugmentation, G2ProofOfPossession
 from pytezos import pytezos
+from pytezos.michelson import forge
 
 from ragger.backend import BackendInterface
 from ragger.firmware import Firmware
-from utils.client import TezosClient, Version, Hwm, StatusCode
-from utils.account import Account
+from tezos_baking_client import BakingClient, Feature, SnapshotTag
+from utils.client import TezosClient, Version, Hwm, StatusCode, BakingType, MAX_APDU_SIZE
+from utils.client import Ins, Index, SignFlag, BackendTransport, LegacyTransport
+from utils.account import Account, SigScheme, Signature
 from utils.helper import get_current_commit
 from utils.message import (
     Message,
+    RawMessage,
+    OperationTag,
     UnsafeOp,
     Delegation,
     Reveal,
@@ -44,6 +52,7 @@ from utils.message import (
     DEFAULT_CHAIN_ID
 )
 from utils.navigator import TezosNavigator, send_and_navigate
+from utils.replay import TraceRecorder, read_trace, replay
 from common import (
     DEFAULT_ACCOUNT,
     DEFAULT_ACCOUNT_2,
@@ -440,7 +449,8 @@ def test_ledger_screensaver(firmware: Firmware,
         time.sleep(1)
 
     res = input("Has the Ledger screensaver been activated?")
-    if firmware.device == "nanos":
+    if firmware.is_nano:
+        # The low-cost screensaver of the app takes over while signing
         assert (res.find("y") == -1), "Ledger screensaver should not have been activated"
     else:
         assert (res.find("y") != -1), "Ledger screensaver should have activated"
@@ -684,6 +694,38 @@ def test_get_all_hwm(
         f"Expected test hmw {test_hwm} but got {received_test_hwm}"
 
 
+def test_nvram_write_skipped(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Test that setting up the same context twice does not write the NVRAM again."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+    main_hwm = Hwm(0, 0)
+    test_hwm = Hwm(0, 0)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    performed_writes, skipped_writes = client.get_nvram_stats()
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    new_performed_writes, new_skipped_writes = client.get_nvram_stats()
+
+    assert new_performed_writes == performed_writes, \
+        f"Expected {performed_writes} NVRAM writes but got {new_performed_writes}"
+    assert new_skipped_writes > skipped_writes, \
+        f"Expected more than {skipped_writes} skipped NVRAM writes but got {new_skipped_writes}"
+
+
 def build_preattestation(op_level, op_round, chain_id):
     """Build a preattestation."""
     return Preattestation(
@@ -967,10 +1009,161 @@ def test_sign_block_at_reset_level(client: TezosClient, tezos_navigator: TezosNa
         chain_id=main_chain_id
     )
 
-    with StatusCode.WRONG_VALUES.expected():
+    with StatusCode.STALE_LEVEL_ROUND.expected():
         client.sign_message(account, block)
 
 
+@pytest.mark.parametrize("account", ACCOUNTS)
+@pytest.mark.parametrize("use_authorized_key", [False, True])
+def test_sign_with_key(
+        account: Account,
+        use_authorized_key: bool,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Test the SIGN instruction when the key and the message are sent in a single apdu."""
+
+    main_chain_id = DEFAULT_CHAIN_ID
+    main_hwm = Hwm(0, 0)
+    test_hwm = Hwm(0, 0)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    attestation = build_attestation(
+        op_level=1,
+        op_round=2,
+        chain_id=main_chain_id
+    )
+
+    signature = client.sign_message_with_key(account, attestation, use_authorized_key)
+    account.check_signature(signature, bytes(attestation))
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == Hwm(1, 2), \
+        f"Expected main hmw {Hwm(1, 2)} but got {received_main_hwm}"
+
+
+def test_sign_with_authorized_key_when_no_key(client: TezosClient) -> None:
+    """Test that signing with the authorized key fails when there is no authorized key."""
+
+    client.deauthorize()
+
+    attestation = build_attestation(
+        op_level=1,
+        op_round=0,
+        chain_id=DEFAULT_CHAIN_ID
+    )
+
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.sign_message_with_key(DEFAULT_ACCOUNT, attestation, use_authorized_key=True)
+
+
+@pytest.mark.parametrize("account", ACCOUNTS)
+def test_sign_batch(
+        account: Account,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Test the SIGN_BATCH instruction."""
+
+    main_chain_id = DEFAULT_CHAIN_ID
+    main_hwm = Hwm(0, 0)
+    test_hwm = Hwm(0, 0)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    messages = [
+        build_preattestation(op_level=1, op_round=0, chain_id=main_chain_id),
+        build_attestation(op_level=1, op_round=0, chain_id=main_chain_id),
+        build_preattestation(op_level=1, op_round=1, chain_id=main_chain_id),
+        build_attestation_dal(op_level=1, op_round=1, chain_id=main_chain_id),
+    ]
+
+    signatures = client.sign_batch(account, messages)
+
+    assert len(signatures) == len(messages), \
+        f"Expected {len(messages)} signatures but got {len(signatures)}"
+    for message, signature in zip(messages, signatures):
+        account.check_signature(signature, bytes(message))
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == Hwm(1, 1), \
+        f"Expected main hmw {Hwm(1, 1)} but got {received_main_hwm}"
+
+
+def test_sign_batch_refused(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Test that a batch containing a refused message is not signed at all."""
+
+    account = DEFAULT_ACCOUNT
+
+    main_chain_id = DEFAULT_CHAIN_ID
+    main_hwm = Hwm(0, 0)
+    test_hwm = Hwm(0, 0)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    messages = [
+        build_attestation(op_level=1, op_round=0, chain_id=main_chain_id),
+        build_preattestation(op_level=1, op_round=0, chain_id=main_chain_id),
+    ]
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_batch(account, messages)
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == main_hwm, \
+        f"Expected main hmw {main_hwm} but got {received_main_hwm}"
+
+
+
+def test_sign_batch_after_error(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Test that a batch is cancelled by an error on one of its packets."""
+
+    account = DEFAULT_ACCOUNT
+
+    main_chain_id = DEFAULT_CHAIN_ID
+    main_hwm = Hwm(0, 0)
+    test_hwm = Hwm(0, 0)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm,
+        test_hwm
+    )
+
+    # The valid message precedes the invalid one in the same packet
+    valid_message = build_preattestation(op_level=1, op_round=0, chain_id=main_chain_id)
+    invalid_message = RawMessage(bytes.fromhex("12" + "00" * 16))
+
+    with StatusCode.PARSE_ERROR.expected():
+        client.sign_batch_packet([valid_message, invalid_message], Index.FIRST)
+
+    last_message = build_attestation(op_level=1, op_round=0, chain_id=main_chain_id)
+    with StatusCode.WRONG_PARAM.expected():
+        client.sign_batch_packet([last_message], Index.LAST)
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == main_hwm, \
+        f"Expected main hmw {main_hwm} but got {received_main_hwm}"
+
+    signatures = client.sign_batch(account, [valid_message, last_message])
+    for message, signature in zip([valid_message, last_message], signatures):
+        account.check_signature(signature, bytes(message))
+
 PARAMETERS_SIGN_LEVEL_AUTHORIZED = [
     (build_attestation,    (0, 0), build_preattestation,  (0, 1), True ),
     (build_block,          (0, 1), build_attestation_dal, (1, 0), True ),
@@ -1040,7 +1233,7 @@ def test_sign_level_authorized(
     if success:
         client.sign_message(account, message_2)
     else:
-        with StatusCode.WRONG_VALUES.expected():
+        with StatusCode.STALE_LEVEL_ROUND.expected():
             client.sign_message(account, message_2)
 
 
@@ -1461,6 +1654,32 @@ def test_sign_multiple_operation(
         account.check_signature(signature, bytes(message))
 
 
+def test_sign_operation_in_several_packets(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Test signing an operation group sent in several packets."""
+
+    account = DEFAULT_ACCOUNT
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    operation = build_reveal(account)
+    for _ in range(4):
+        operation = operation.merge(build_reveal(account))
+
+    message = operation.forge()
+    assert len(bytes(message)) > MAX_APDU_SIZE, \
+        "The operation group is expected to need several packets"
+
+    signature = client.sign_message(account, message)
+    account.check_signature(signature, bytes(message))
+
+
 def test_sign_when_hwm_disabled(
         client: TezosClient,
         backend: BackendInterface,
@@ -1513,7 +1732,7 @@ def test_sign_when_hwm_disabled(
         "NetXH12Af5mrXhq"  # Chain = 2
     )
 
-    with StatusCode.WRONG_VALUES.expected():
+    with StatusCode.STALE_LEVEL_ROUND.expected():
         client.sign_message(account, attestation)
 
     tezos_navigator.check_app_context(
@@ -1526,6 +1745,47 @@ def test_sign_when_hwm_disabled(
 
 
 @pytest.mark.parametrize("exit_style", ["abruptly", "properly"])
+def test_hwm_reserved_levels(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that the NVRAM is only written once the HWM reaches the reserved levels."""
+
+    _, capabilities = client.capabilities()
+    reserved_levels = capabilities[0x04][6]
+    if reserved_levels == 0:
+        pytest.skip("The app stores the exact HWM")
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    # The first signature stores the HWM with the next levels reserved
+    client.sign_message(account, build_attestation(1, 0, main_chain_id))
+    performed_writes, _ = client.get_nvram_stats()
+
+    for level in range(1, 1 + reserved_levels):
+        for message in (build_block(level, 1, main_chain_id),
+                        build_preattestation(level, 1, main_chain_id),
+                        build_attestation(level, 1, main_chain_id)):
+            client.sign_message(account, message)
+
+    new_performed_writes, _ = client.get_nvram_stats()
+    assert new_performed_writes == performed_writes, \
+        f"Expected {performed_writes} NVRAM writes but got {new_performed_writes}"
+    assert client.get_all_hwm() == (main_chain_id, Hwm(reserved_levels, 1), Hwm(0, 0))
+
+    # The reserved levels have been reached
+    client.sign_message(account, build_block(1 + reserved_levels, 0, main_chain_id))
+
+    new_performed_writes, _ = client.get_nvram_stats()
+    assert new_performed_writes > performed_writes, \
+        f"Expected more than {performed_writes} NVRAM writes but got {new_performed_writes}"
+
+
 def test_hwm_disabled_exit(client: TezosClient, tezos_navigator: TezosNavigator, exit_style, backend_name) -> None:
     """On device test to verify HWM settings operation. Can run the test with hwm setting enabled or disabled.
        When HWM is disabled, an abrupt power off will result in HWM reset to 0.
@@ -1544,6 +1804,9 @@ def test_hwm_disabled_exit(client: TezosClient, tezos_navigator: TezosNavigator,
     if hwm_input.find("y") != -1:
         hwm_disabled = True
 
+    _, capabilities = client.capabilities()
+    reserved_levels = capabilities[0x04][6]
+
     tezos_navigator.setup_app_context(
         account,
         DEFAULT_CHAIN_ID,  # Chain = 0
@@ -1561,6 +1824,13 @@ def test_hwm_disabled_exit(client: TezosClient, tezos_navigator: TezosNavigator,
     expected_hwm = Hwm(10,0)
     if hwm_disabled and exit_style == "abruptly":
         expected_hwm.highest_level = 0
+    elif exit_style == "abruptly" and reserved_levels != 0:
+        # The HWM stored in NVRAM holds the levels reserved ahead of it
+        stored_level = 0
+        for level in range(1, 11):
+            if level >= stored_level:
+                stored_level = level + reserved_levels
+        expected_hwm.highest_level = stored_level
     output = "No"
     output = input(f"""
                     1. Now switch off the device {exit_style}.
@@ -1619,7 +1889,7 @@ def test_sign_when_no_chain_setup(
         "NetXH12Af5mrXhq" # Chain = 2
     )
 
-    with StatusCode.WRONG_VALUES.expected():
+    with StatusCode.STALE_LEVEL_ROUND.expected():
         client.sign_message(account, attestation)
 
     tezos_navigator.check_app_context(
@@ -1679,7 +1949,7 @@ def test_sign_when_chain_is_setup(
         "NetXH12Af5mrXhq" # Chain = 2
     )
 
-    with StatusCode.WRONG_VALUES.expected():
+    with StatusCode.STALE_LEVEL_ROUND.expected():
         client.sign_message(account, attestation)
 
     tezos_navigator.check_app_context(
@@ -1691,6 +1961,124 @@ def test_sign_when_chain_is_setup(
     )
 
 
+def test_sign_on_several_test_chains(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that each test chain has its own HWM."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+    test_chain_ids = ["NetXH12Af5mrXhq", "NetXH12Af8zUiFb"] # Chain = 2, 3
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    client.sign_message(account, build_attestation(5, 0, test_chain_ids[0]))
+
+    # The other test chain is not constrained by the first one
+    client.sign_message(account, build_attestation(3, 0, test_chain_ids[1]))
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_attestation(4, 0, test_chain_ids[0]))
+
+    assert client.get_hwm_table() == [
+        (test_chain_ids[0], Hwm(5, 0)),
+        (test_chain_ids[1], Hwm(3, 0)),
+    ]
+
+    chain_id, main_hwm, test_hwm = client.get_all_hwm()
+    assert chain_id == main_chain_id
+    assert main_hwm == Hwm(0, 0)
+    assert test_hwm == Hwm(0, 0)
+
+
+def test_sign_with_companion_key(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that a companion key signs with its own HWM."""
+
+    account = DEFAULT_ACCOUNT
+    companion = DEFAULT_ACCOUNT_2
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    attestation = build_attestation(1, 0, DEFAULT_CHAIN_ID)
+
+    with StatusCode.SECURITY.expected():
+        client.sign_message(companion, attestation)
+
+    tezos_navigator.authorize_companion_key(companion)
+
+    signature = client.sign_message(account, attestation)
+    account.check_signature(signature, bytes(attestation))
+
+    # The companion key can sign the same level and round
+    signature = client.sign_message(companion, attestation)
+    companion.check_signature(signature, bytes(attestation))
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(companion, attestation)
+
+    # The authorized key is unchanged
+    sig_scheme, path = client.get_auth_key_with_curve()
+    assert path == account.path, \
+        f"Expected {account.path} but got {path}"
+    assert sig_scheme == account.sig_scheme, \
+        f"Expected {account.sig_scheme.name} but got {sig_scheme.name}"
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    with StatusCode.SECURITY.expected():
+        client.sign_message(companion, build_attestation(2, 0, DEFAULT_CHAIN_ID))
+
+
+def test_query_snapshot(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that the snapshot contains the whole app state."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    client.sign_message(account, build_attestation(1, 2, main_chain_id))
+
+    format_version, entries = client.get_snapshot()
+    assert format_version == 1
+    snapshot = dict(entries)
+
+    assert Version.from_bytes(snapshot[0x01]) == client.version()
+    assert snapshot[0x02] == client.git().encode('utf-8') + b'\x00'
+    assert forge.unforge_chain_id(snapshot[0x03]) == main_chain_id
+    # Level 1, round 2, attestation signed
+    assert snapshot[0x04] == (1).to_bytes(4, 'big') + (2).to_bytes(4, 'big') + b'\x01'
+    assert snapshot[0x05] == bytes(8) + b'\x00'
+    assert snapshot[0x07] == b'\x00'
+    assert snapshot[0x08] == \
+        bytes([account.sig_scheme]) + bytes(account.path)
+    assert snapshot[0x09] == client.get_public_key_silent(account)[1:]
+
+
 KEY_SHA256_HEX = "6c4e7e706c54d367c87a8d89c16adfe06cb5680cb7d18e625a90475ec0dbdb9f"
 
 def get_hmac_key(account):
@@ -1728,3 +2116,901 @@ def test_hmac(
     data = client.hmac(account, message)
     assert hmac.compare_digest(calculated_hmac, data), \
         f"Expected HMAC {calculated_hmac.hex()} but got {data.hex()}"
+
+
+def test_hmac_with_several_keys(client: TezosClient) -> None:
+    """Test the HMAC instruction when the key changes between requests."""
+
+    message = bytes.fromhex(HMAC_TEST_SET[-1])
+
+    for account in [*TZ1_ACCOUNTS, *TZ1_ACCOUNTS, TZ1_ACCOUNTS[0]]:
+        calculated_hmac = hmac.digest(
+            key=get_hmac_key(account),
+            msg=message,
+            digest=hashlib.sha256
+        )
+
+        data = client.hmac(account, message)
+        assert hmac.compare_digest(calculated_hmac, data), \
+            f"Expected HMAC {calculated_hmac.hex()} but got {data.hex()}"
+
+
+def test_async_prompt(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that baking messages are signed while an asynchronous prompt is pending."""
+
+    account = DEFAULT_ACCOUNT
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.get_prompt_result()
+
+    client.reset_app_context(5, async_prompt=True)
+
+    with StatusCode.PROMPT_PENDING.expected():
+        client.get_prompt_result()
+
+    with StatusCode.PROMPT_PENDING.expected():
+        client.reset_app_context(6, async_prompt=True)
+
+    attestation = build_attestation(1, 0, DEFAULT_CHAIN_ID)
+    signature = client.sign_message(account, attestation)
+    account.check_signature(signature, bytes(attestation))
+
+    tezos_navigator.accept_reset_navigate()
+
+    assert client.get_prompt_result() == b''
+
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.get_prompt_result()
+
+    chain_id, main_hwm, test_hwm = client.get_all_hwm()
+    assert chain_id == DEFAULT_CHAIN_ID
+    assert main_hwm == Hwm(5, 0)
+    assert test_hwm == Hwm(5, 0)
+
+
+def test_sign_interleaved_with_queries(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that queries and HMAC sent between two packets do not interrupt a signature."""
+
+    account = DEFAULT_ACCOUNT
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    attestation = build_attestation(1, 0, DEFAULT_CHAIN_ID)
+
+    client.select_signing_key(account)
+
+    client.hmac(account, bytes.fromhex("00"))
+    client.get_all_hwm()
+    client.get_public_key_silent(DEFAULT_ACCOUNT_2)
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.get_prompt_result()
+
+    signature = client.sign_selected_message(account, attestation)
+    account.check_signature(signature, bytes(attestation))
+
+
+@pytest.mark.parametrize("account", ACCOUNTS)
+def test_sign_compact_response(
+        account: Account,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check the compact signature and the HWM returned by the SIGN instruction."""
+
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    attestation = build_attestation(1, 2, DEFAULT_CHAIN_ID)
+
+    signature, hwm = client.sign_message_compact(account, attestation)
+    account.check_signature(signature, bytes(attestation))
+    assert hwm is None
+
+    block = build_block(3, 0, DEFAULT_CHAIN_ID)
+
+    signature, hwm = client.sign_message_compact(account, block, with_hwm=True)
+    account.check_signature(signature, bytes(block))
+    assert hwm is not None and hwm.hwm == Hwm(3, 0)
+
+    with StatusCode.WRONG_PARAM.expected():
+        client.sign_message_compact(account, build_transaction(account), with_hwm=True)
+
+
+def test_sign_hwm_state(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check the HWM state returned with the signatures of each chain."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+    test_chain_id = "NetXH12Af5mrXhq" # Chain = 2
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    _, state = client.sign_message_compact(
+        account, build_block(1, 0, main_chain_id), with_hwm=True)
+    assert state is not None
+    assert state.hwm == Hwm(1, 0)
+    assert not state.had_attestation and not state.had_preattestation
+    assert state.slot == 0x00
+
+    _, state = client.sign_message_compact(
+        account, build_preattestation(1, 0, main_chain_id), with_hwm=True)
+    assert state is not None
+    assert state.hwm == Hwm(1, 0)
+    assert not state.had_attestation and state.had_preattestation
+    assert state.slot == 0x00
+
+    _, state = client.sign_message_compact(
+        account, build_attestation(1, 0, main_chain_id), with_hwm=True)
+    assert state is not None
+    assert state.hwm == Hwm(1, 0)
+    assert state.had_attestation and state.had_preattestation
+    assert state.slot == 0x00
+
+    _, state = client.sign_message_compact(
+        account, build_attestation(2, 1, test_chain_id), with_hwm=True)
+    assert state is not None
+    assert state.hwm == Hwm(2, 1)
+    assert state.had_attestation and not state.had_preattestation
+    assert state.slot == 0x02
+
+    assert client.get_main_hwm() == Hwm(1, 0)
+
+
+def test_check_authorization(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that CHECK_AUTHORIZATION answers as SIGN would without updating the HWM."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+    test_chain_id = "NetXH12Af5mrXhq" # Chain = 2
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(5, 0),
+        test_hwm=Hwm(3, 0)
+    )
+
+    checks = [
+        (main_chain_id, 5, 0, BakingType.BLOCK),
+        (main_chain_id, 5, 1, BakingType.BLOCK),
+        (main_chain_id, 5, 0, BakingType.ATTESTATION),
+        (main_chain_id, 5, 0, BakingType.PREATTESTATION),
+        (main_chain_id, 4, 9, BakingType.ATTESTATION),
+        (test_chain_id, 3, 0, BakingType.BLOCK),
+        (test_chain_id, 4, 0, BakingType.PREATTESTATION),
+    ]
+    expected = [False, True, True, True, False, False, True]
+
+    assert client.check_authorization(account, checks) == expected
+    assert client.check_authorization(None, checks) == expected
+
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 0), Hwm(3, 0))
+    assert client.get_hwm_table() == []
+
+    attestation = build_attestation(5, 0, main_chain_id)
+    signature = client.sign_message(account, attestation)
+    account.check_signature(signature, bytes(attestation))
+
+    assert client.check_authorization(account, checks[2:4]) == [False, False]
+
+    with StatusCode.SECURITY.expected():
+        client.check_authorization(DEFAULT_ACCOUNT_2, checks)
+
+    with StatusCode.WRONG_LENGTH.expected():
+        client.check_authorization(account, [])
+
+
+def bls_supported(client: TezosClient) -> bool:
+    """Check whether the app has been built to sign with BLS12-381 keys."""
+    _, capabilities = client.capabilities()
+    return (capabilities[0x02][0] >> SigScheme.BLS12_381) & 1 == 1
+
+
+def test_get_public_key_bls(client: TezosClient) -> None:
+    """Check that BLS12-381 public keys are compressed G1 points, only in BLS builds."""
+
+    account = copy.copy(DEFAULT_ACCOUNT)
+    account.sig_scheme = SigScheme.BLS12_381
+
+    if not bls_supported(client):
+        with StatusCode.WRONG_PARAM.expected():
+            client.get_public_key_silent(account)
+        return
+
+    public_key = client.get_public_key_silent(account)
+
+    assert len(public_key) == 1 + 48
+    assert public_key[0] == 48
+    # Compressed points have their compression flag set
+    assert public_key[1] & 0x80
+    assert G2ProofOfPossession.KeyValidate(public_key[1:]), \
+        f"Expected a valid BLS12-381 public key but got {public_key.hex()}"
+
+    assert client.get_public_key_silent(account) == public_key
+
+
+BLS_DERIVATION_PATHS = [
+    "m/44'/1729'/0'/0'",
+    "m/44'/1729'/1'/0'",
+    "m/9'/12'/13'/8'/78'",
+]
+
+
+def test_bls_key_derivation(firmware: Firmware, client: TezosClient, golden_run: bool) -> None:
+    """Check the BLS12-381 public keys derived for known paths.
+
+    The expected keys are recorded with `--golden_run`."""
+
+    if not bls_supported(client):
+        pytest.skip("The app is not built with BLS12-381 keys")
+
+    public_keys = {}
+    for path in BLS_DERIVATION_PATHS:
+        account = Account(path, SigScheme.BLS12_381, "", 0)
+        public_keys[path] = client.get_public_key_silent(account)[1:].hex()
+
+    assert len(set(public_keys.values())) == len(BLS_DERIVATION_PATHS), \
+        f"Expected a different public key for each path but got {public_keys}"
+
+    golden_path = Path(__file__).parent / "snapshots" / firmware.device / \
+        "test_bls_key_derivation" / "public_keys.json"
+    if golden_run:
+        golden_path.parent.mkdir(parents=True, exist_ok=True)
+        golden_path.write_text(json.dumps(public_keys, indent=4) + "\n")
+    if not golden_path.is_file():
+        pytest.skip(f"No recorded BLS12-381 public keys for {firmware.device}")
+
+    expected = json.loads(golden_path.read_text())
+    assert public_keys == expected, \
+        f"Expected public keys {expected} but got {public_keys}"
+
+
+def test_sign_bls(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that BLS12-381 signatures verify with the augmented scheme of Tezos."""
+
+    if not bls_supported(client):
+        pytest.skip("The app is not built with BLS12-381 keys")
+
+    account = copy.copy(DEFAULT_ACCOUNT)
+    account.sig_scheme = SigScheme.BLS12_381
+    tezos_navigator.authorize_baking(account)
+
+    public_key = client.get_public_key_silent(account)[1:]
+
+    for level in range(1, 4):
+        message = bytes(build_attestation(level, 0, DEFAULT_CHAIN_ID))
+        _, signature = client.sign_message_with_ack(account, message)
+        assert len(signature) == Signature.BLS_SIZE, \
+            f"Expected a BLS12-381 signature but got {signature.hex()}"
+        assert G2MessageAugmentation.Verify(public_key, message, signature), \
+            f"Expected the signature {signature.hex()} of {message.hex()} to be valid"
+        assert not G2ProofOfPossession.Verify(public_key, message, signature), \
+            "Expected the signature not to be made with the proof of possession tag"
+
+
+def test_get_proof_of_possession(client: TezosClient,
+                                 tezos_navigator: TezosNavigator) -> None:
+    """Check that the proof of possession is only given for a BLS12-381 authorized key."""
+
+    if not bls_supported(client):
+        with StatusCode.INVALID_INS.expected():
+            client.get_proof_of_possession()
+        return
+
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.get_proof_of_possession()
+
+    tezos_navigator.authorize_baking(DEFAULT_ACCOUNT)
+
+    with StatusCode.WRONG_PARAM.expected():
+        client.get_proof_of_possession()
+
+    account = copy.copy(DEFAULT_ACCOUNT)
+    account.sig_scheme = SigScheme.BLS12_381
+    tezos_navigator.authorize_baking(account)
+
+    public_key, proof = client.get_proof_of_possession()
+    assert public_key == client.get_public_key_silent(account)[1:]
+    assert len(proof) == 96
+    assert G2ProofOfPossession.PopVerify(public_key, proof), \
+        f"Expected the proof of possession {proof.hex()} to be valid"
+
+    # The proof is cached and deterministic
+    assert client.get_proof_of_possession() == (public_key, proof)
+
+
+def test_export_import_hwm(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that an authenticated HWM export can only raise the HWM once imported."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.export_hwm()
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(5, 0),
+        test_hwm=Hwm(3, 0)
+    )
+
+    attestation = build_attestation(7, 2, main_chain_id)
+    client.sign_message(account, attestation)
+
+    export = client.export_hwm()
+    assert len(export) == 4 + 2 * 9 + 32
+
+    tezos_navigator.reset_app_context(1)
+    assert client.get_all_hwm() == (main_chain_id, Hwm(1, 0), Hwm(1, 0))
+
+    client.import_hwm(export)
+    assert client.get_all_hwm() == (main_chain_id, Hwm(7, 2), Hwm(3, 0))
+
+    # The attestation flag has been imported too
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, attestation)
+
+    block = build_block(9, 0, main_chain_id)
+    client.sign_message(account, block)
+
+    # An older export never lowers the HWM
+    client.import_hwm(export)
+    assert client.get_all_hwm() == (main_chain_id, Hwm(9, 0), Hwm(3, 0))
+
+    tampered = bytearray(export)
+    tampered[7] ^= 0x01
+    with StatusCode.SECURITY.expected():
+        client.import_hwm(bytes(tampered))
+
+    with StatusCode.WRONG_LENGTH.expected():
+        client.import_hwm(export[:-1])
+
+
+
+def test_replay_trace(client: TezosClient,
+                      tezos_navigator: TezosNavigator,
+                      tmp_path: Path) -> None:
+    """Check that a recorded trace of APDUs can be replayed."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    trace_path = tmp_path / "trace.jsonl"
+    with TraceRecorder(client) as recorder:
+        tezos_navigator.reset_app_context(1)
+        client.sign_message(account, build_attestation(1, 0, main_chain_id))
+        client.sign_message(account, build_block(2, 0, main_chain_id))
+    recorder.write(trace_path)
+
+    trace = read_trace(trace_path)
+    assert trace == recorder.entries
+    assert all(entry.status == StatusCode.OK for entry in trace)
+
+    report = replay(client, trace, speed=10.0, on_prompt=tezos_navigator.replay_prompt)
+    assert report.skipped == 0
+    assert len(report.signatures) == 2
+    assert all(request.status == StatusCode.OK for request in report.signatures)
+    assert all(request.service > 0 for request in report.signatures)
+
+    # Without the reset, the HWM forbids signing the same messages again
+    report = replay(client, trace, speed=10.0)
+    assert report.skipped == 1
+    assert all(request.status == StatusCode.STALE_LEVEL_ROUND for request in report.signatures)
+
+
+def test_sign_with_hwm_level_only(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that a HWM tracking only levels only refuses a level regression."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(5, 0),
+        test_hwm=Hwm(0, 0),
+        hwm_level_only=True
+    )
+
+    _, entries = client.get_snapshot()
+    assert dict(entries)[0x0d] == b'\x01'
+
+    # Rounds and consensus operations are tracked by the signer
+    client.sign_message(account, build_attestation(5, 2, main_chain_id))
+    client.sign_message(account, build_attestation(5, 2, main_chain_id))
+    client.sign_message(account, build_block(5, 1, main_chain_id))
+    client.sign_message(account, build_preattestation(5, 0, main_chain_id))
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 0), Hwm(0, 0))
+
+    client.sign_message(account, build_block(6, 3, main_chain_id))
+    assert client.get_all_hwm() == (main_chain_id, Hwm(6, 0), Hwm(0, 0))
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_attestation(5, 4, main_chain_id))
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(5, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    _, entries = client.get_snapshot()
+    assert dict(entries)[0x0d] == b'\x00'
+
+    client.sign_message(account, build_attestation(5, 2, main_chain_id))
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_attestation(5, 2, main_chain_id))
+
+
+def test_sign_stats(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that the signatures of the authorized key are counted per type."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    def get_sign_stats() -> Tuple[int, int, int, int]:
+        _, entries = client.get_snapshot()
+        stats = [value for (tag, value) in entries if tag == 0x0e]
+        assert len(stats) == 1 and stats[0][0] == 0, "Expected the stats of the authorized key"
+        return (
+            int.from_bytes(stats[0][1:5], 'big'),
+            int.from_bytes(stats[0][5:9], 'big'),
+            int.from_bytes(stats[0][9:13], 'big'),
+            int.from_bytes(stats[0][13:17], 'big'),
+        )
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+    # Blocks, attestations, pre-attestations, last level
+    assert get_sign_stats() == (0, 0, 0, 0)
+
+    client.sign_message(account, build_block(1, 0, main_chain_id))
+    client.sign_message(account, build_preattestation(1, 0, main_chain_id))
+    client.sign_message(account, build_attestation(1, 0, main_chain_id))
+    client.sign_message(account, build_attestation(2, 0, main_chain_id))
+    assert get_sign_stats() == (1, 2, 1, 2)
+
+    # Refused signatures are not counted
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_block(1, 0, main_chain_id))
+    assert get_sign_stats() == (1, 2, 1, 2)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+    assert get_sign_stats() == (0, 0, 0, 0)
+
+
+@pytest.mark.parametrize("account", ACCOUNTS)
+def test_sign_pipelined(
+        account: Account,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Test the SIGN_PIPELINED instruction."""
+
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    messages = [
+        build_preattestation(op_level=1, op_round=0, chain_id=main_chain_id),
+        build_attestation(op_level=1, op_round=0, chain_id=main_chain_id),
+        build_block(level=2, current_round=0, chain_id=main_chain_id),
+        build_attestation_dal(op_level=2, op_round=0, chain_id=main_chain_id),
+    ]
+
+    signatures = client.sign_pipelined(account, messages)
+
+    assert len(signatures) == len(messages), \
+        f"Expected {len(messages)} signatures but got {len(signatures)}"
+    for message, signature in zip(messages, signatures):
+        account.check_signature(signature, bytes(message))
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == Hwm(2, 0), \
+        f"Expected main hmw {Hwm(2, 0)} but got {received_main_hwm}"
+
+    # Each message is checked against the HWM raised by the previous ones
+    messages = [
+        build_attestation(op_level=3, op_round=0, chain_id=main_chain_id),
+        build_preattestation(op_level=3, op_round=0, chain_id=main_chain_id),
+    ]
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_pipelined(account, messages)
+
+    _, received_main_hwm, _ = client.get_all_hwm()
+    assert received_main_hwm == Hwm(3, 0), \
+        f"Expected main hmw {Hwm(3, 0)} but got {received_main_hwm}"
+
+    # The pipeline has ended with the refusal
+    with StatusCode.REFERENCED_DATA_NOT_FOUND.expected():
+        client.sign_pipelined(account, [])
+
+
+def test_sign_pipelined_restart(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that a pipeline can only be restarted once its last signature is sent."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    message = build_attestation(op_level=1, op_round=0, chain_id=main_chain_id)
+    data = client.sign_pipelined_packet(Index.FIRST, message)
+    assert data == b'', "The first message has no previous signature"
+
+    # The signature of the first message has not been sent yet
+    other_message = build_attestation(op_level=2, op_round=0, chain_id=main_chain_id)
+    with StatusCode.WRONG_PARAM.expected():
+        client.sign_pipelined_packet(Index.FIRST, other_message)
+
+    # The refusal kept the pipeline
+    data = client.sign_pipelined_packet(Index.FETCH)
+    account.check_signature(Signature.from_bytes(data, account.sig_scheme), bytes(message))
+
+    # Once fetched, a new pipeline can start
+    messages = [
+        build_attestation(op_level=2, op_round=0, chain_id=main_chain_id),
+        build_block(level=3, current_round=0, chain_id=main_chain_id),
+    ]
+
+    signatures = client.sign_pipelined(account, messages)
+
+    assert len(signatures) == len(messages), \
+        f"Expected {len(messages)} signatures but got {len(signatures)}"
+    for message, signature in zip(messages, signatures):
+        account.check_signature(signature, bytes(message))
+
+
+@pytest.mark.parametrize("account", ACCOUNTS)
+def test_host_client(
+        account: Account,
+        backend: BackendInterface,
+        tezos_navigator: TezosNavigator) -> None:
+    """Test the host client, with the current and with the older instructions."""
+
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    host = BakingClient(BackendTransport(backend))
+    legacy_host = BakingClient(LegacyTransport(backend))
+
+    for level, current_host, is_supported in [(1, host, True), (3, legacy_host, False)]:
+
+        attestation = build_attestation(op_level=level, op_round=0, chain_id=main_chain_id)
+        raw_signature = current_host.sign(current_host.prepare(bytes(attestation)))
+        account.check_signature(
+            Signature.from_bytes(raw_signature, account.sig_scheme),
+            bytes(attestation))
+
+        messages = [
+            build_block(level=level + 1, current_round=0, chain_id=main_chain_id),
+            build_preattestation(op_level=level + 1, op_round=0, chain_id=main_chain_id),
+            build_attestation(op_level=level + 1, op_round=0, chain_id=main_chain_id),
+        ]
+        raw_signatures = current_host.sign_batch([bytes(message) for message in messages])
+        assert len(raw_signatures) == len(messages), \
+            f"Expected {len(messages)} signatures but got {len(raw_signatures)}"
+        for message, raw_signature in zip(messages, raw_signatures):
+            account.check_signature(
+                Signature.from_bytes(raw_signature, account.sig_scheme),
+                bytes(message))
+
+        snapshot = current_host.snapshot()
+        [raw_main_hwm] = snapshot[SnapshotTag.MAIN_HWM]
+        main_hwm = Hwm.from_bytes(raw_main_hwm[:8])
+        assert main_hwm == Hwm(level + 1, 0), \
+            f"Expected main hmw {Hwm(level + 1, 0)} but got {main_hwm}"
+
+        for feature in Feature:
+            assert current_host.supports(feature) == is_supported, \
+                f"Expected {feature.name} support to be {is_supported}"
+
+        # Only the current app advertises its capabilities
+        assert (current_host.capabilities is not None) == is_supported, \
+            f"Expected capabilities to be advertised: {is_supported}"
+
+
+def test_version_capabilities(firmware: Firmware, client: TezosClient) -> None:
+    """Test the VERSION instruction requesting the capabilities."""
+
+    version, capabilities = client.capabilities()
+
+    assert version == client.version(), \
+        f"Expected {client.version()} but got {version}"
+
+    instructions = int.from_bytes(capabilities[0x01], 'big')
+    optional_instructions = {Ins.QUERY_PERF, Ins.GET_PROOF_OF_POSSESSION}
+    for ins in Ins:
+        is_supported = (instructions >> ins) & 1 == 1
+        if ins == Ins.SIGN_UNSAFE:
+            assert not is_supported, f"Expected {ins.name} not to be supported"
+        elif ins not in optional_instructions:
+            assert is_supported, f"Expected {ins.name} to be supported"
+
+    is_nanos = firmware.device == "nanos"
+
+    # BLS12-381 keys are an opt-in of the build, never available on Nano S
+    curves = capabilities[0x02][0]
+    is_bls_supported = (curves >> SigScheme.BLS12_381) & 1 == 1
+    assert not (is_nanos and is_bls_supported), "Expected BLS12-381 not to be supported"
+    for sig_scheme in SigScheme:
+        is_supported = (curves >> sig_scheme) & 1 == 1
+        expected = is_bls_supported if sig_scheme == SigScheme.BLS12_381 else True
+        assert is_supported == expected, \
+            f"Expected {sig_scheme.name} support to be {expected}"
+
+    is_pop_supported = (instructions >> Ins.GET_PROOF_OF_POSSESSION) & 1 == 1
+    assert is_pop_supported == is_bls_supported, \
+        f"Expected {Ins.GET_PROOF_OF_POSSESSION.name} support to be {is_bls_supported}"
+
+    assert capabilities[0x03][0] & 0x7f == 0x7f, \
+        f"Expected all options to be supported but got {capabilities[0x03].hex()}"
+
+    expected_limits = bytes([MAX_APDU_SIZE, 4, 2, 2 if is_nanos else 8, 1 if is_nanos else 2, 200, 8])
+    assert capabilities[0x04] == expected_limits, \
+        f"Expected limits {expected_limits.hex()} but got {capabilities[0x04].hex()}"
+
+
+def forge_reveal_with_proof(source: bytes,
+                            public_key: bytes,
+                            proof: Optional[bytes],
+                            count: int = 1) -> RawMessage:
+    """Forge an operation group of reveals, each followed by the presence of its proof."""
+    reveal = bytes([OperationTag.BABYLON_REVEAL]) + source
+    for value in (374, 23732, 1000, 0):  # fee, counter, gas limit and storage limit
+        reveal += forge.forge_nat(value)
+    reveal += public_key
+    reveal += b'\x00' if proof is None else b'\xff' + proof
+    return RawMessage(b'\x03' + bytes(32) + reveal * count)  # magic byte and branch
+
+
+def test_sign_reveal_with_proof(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that a reveal carrying a proof is streamed over acknowledged packets."""
+
+    account = DEFAULT_ACCOUNT
+    tezos_navigator.authorize_baking(account)
+
+    source = forge.forge_address(account.public_key_hash, tz_only=True)
+    public_key = forge.forge_public_key(account.public_key)
+
+    # Without proof
+    message = forge_reveal_with_proof(source, public_key, None)
+    acks, signature = client.sign_message_with_ack(account, message, packet_size=32)
+    expected_acks = [(index + 1, (index + 1) * 32) for index in range(len(bytes(message)) // 32)]
+    assert acks == expected_acks, f"Expected acknowledgements {expected_acks} but got {acks}"
+    account.check_signature(Signature.from_bytes(signature, account.sig_scheme), bytes(message))
+
+    # Only BLS12-381 keys are revealed with a proof
+    message = forge_reveal_with_proof(source, public_key, bytes(96))
+    with StatusCode.PARSE_ERROR.expected():
+        client.sign_message_with_ack(account, message)
+
+    if not bls_supported(client):
+        return
+
+    account = copy.copy(DEFAULT_ACCOUNT)
+    account.sig_scheme = SigScheme.BLS12_381
+    tezos_navigator.authorize_baking(account)
+
+    raw_public_key, proof = client.get_proof_of_possession()
+    source = b'\x03' + hashlib.blake2b(raw_public_key, digest_size=20).digest()
+    message = forge_reveal_with_proof(source, b'\x03' + raw_public_key, proof, count=2)
+    assert len(bytes(message)) > MAX_APDU_SIZE, \
+        "The operation group is expected to need several packets"
+
+    acks, signature = client.sign_message_with_ack(account, message, packet_size=100)
+    expected_acks = [(index + 1, (index + 1) * 100) for index in range(len(bytes(message)) // 100)]
+    assert acks == expected_acks, f"Expected acknowledgements {expected_acks} but got {acks}"
+    assert len(signature) == Signature.BLS_SIZE, \
+        f"Expected a BLS12-381 signature but got {signature.hex()}"
+    assert G2MessageAugmentation.Verify(raw_public_key, bytes(message), signature), \
+        f"Expected the signature {signature.hex()} to be valid"
+
+
+def test_sign_with_host_hwm(client: TezosClient, tezos_navigator: TezosNavigator) -> None:
+    """Check that the HWM of the host raises the HWM of the session without NVRAM writes."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+    test_chain_id = "NetXH12Af5mrXhq"
+    snap_path = Path(f"{account}")
+
+    tezos_navigator.disable_hwm(snap_path)
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    performed_writes, _ = client.get_nvram_stats()
+
+    block = build_block(5, 1, main_chain_id)
+    signature = client.sign_message_with_host_hwm(account, block, Hwm(5, 0))
+    account.check_signature(signature, bytes(block))
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 1), Hwm(0, 0))
+
+    # The host has signed up to the round 3, the refusal raises nothing
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message_with_host_hwm(account, build_block(5, 2, main_chain_id), Hwm(5, 3))
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 1), Hwm(0, 0))
+
+    # The flags are tracked at the level and round of the host
+    attestation = build_attestation(5, 3, main_chain_id)
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message_with_host_hwm(account, attestation, Hwm(5, 3), flags=0x01)
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 1), Hwm(0, 0))
+
+    # Once signed, the HWM is raised to the one of the host
+    signature = client.sign_message_with_host_hwm(account, attestation, Hwm(5, 3), flags=0x02)
+    account.check_signature(signature, bytes(attestation))
+    assert client.get_all_hwm() == (main_chain_id, Hwm(5, 3), Hwm(0, 0))
+
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_preattestation(5, 3, main_chain_id))
+
+    # A HWM of the host below the one of the session is ignored
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message_with_host_hwm(account, build_block(5, 2, main_chain_id), Hwm(0, 0))
+
+    block = build_block(6, 0, main_chain_id)
+    signature = client.sign_message_with_host_hwm(account, block, Hwm(5, 0))
+    account.check_signature(signature, bytes(block))
+
+    # A refused message does not assign a slot to its test chain
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message_with_host_hwm(account, build_block(3, 0, test_chain_id), Hwm(4, 0))
+    assert client.get_hwm_table() == []
+
+    new_performed_writes, _ = client.get_nvram_stats()
+    assert new_performed_writes == performed_writes, \
+        f"Expected {performed_writes} NVRAM writes but got {new_performed_writes}"
+
+    # Operations have no HWM
+    with StatusCode.WRONG_PARAM.expected():
+        client.sign_message_with_host_hwm(account, build_reveal(account).forge(), Hwm(0, 0))
+
+    with StatusCode.WRONG_VALUES.expected():
+        client.sign_message_with_host_hwm(account, build_block(7, 0, main_chain_id), Hwm(0, 0),
+                                          flags=0x04)
+
+
+def test_sign_with_host_hwm_when_hwm_enabled(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that the HWM of the host is refused while the HWM is enabled."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = DEFAULT_CHAIN_ID
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    with StatusCode.WRONG_PARAM.expected():
+        client.sign_message_with_host_hwm(account, build_block(5, 0, main_chain_id), Hwm(4, 0))
+
+    assert client.get_all_hwm() == (main_chain_id, Hwm(0, 0), Hwm(0, 0))
+
+    block = build_block(5, 0, main_chain_id)
+    signature = client.sign_message(account, block)
+    account.check_signature(signature, bytes(block))
+
+
+def test_refused_sign_keeps_test_chain_slots(
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that a refused signature does not assign a slot to its test chain."""
+
+    account = DEFAULT_ACCOUNT
+    main_chain_id = "NetXH12AexHqTQa" # Chain = 1
+    test_chain_id = "NetXH12Af5mrXhq" # Chain = 2
+
+    tezos_navigator.setup_app_context(
+        account,
+        main_chain_id,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(5, 0)
+    )
+
+    # A new test chain starts from the test HWM
+    with StatusCode.STALE_LEVEL_ROUND.expected():
+        client.sign_message(account, build_attestation(3, 0, test_chain_id))
+
+    assert client.get_hwm_table() == []
+
+    client.sign_message(account, build_attestation(6, 0, test_chain_id))
+
+    assert client.get_hwm_table() == [(test_chain_id, Hwm(6, 0))]
+
+
+@pytest.mark.parametrize(
+    "flag",
+    [
+        SignFlag.WITH_HOST_HWM,
+        SignFlag.WITH_ACK,
+        SignFlag.COMPACT_SIGNATURE,
+        SignFlag.WITH_HWM
+    ],
+    ids=lambda flag: flag.name
+)
+def test_select_signing_key_refuses_response_flags(
+        flag: SignFlag,
+        client: TezosClient,
+        tezos_navigator: TezosNavigator) -> None:
+    """Check that the key packet refuses the flags of the message packets."""
+
+    account = DEFAULT_ACCOUNT
+    tezos_navigator.setup_app_context(
+        account,
+        DEFAULT_CHAIN_ID,
+        main_hwm=Hwm(0, 0),
+        test_hwm=Hwm(0, 0)
+    )
+
+    with StatusCode.WRONG_PARAM.expected():
+        client.select_signing_key(account, flags=flag)
+
+    client.select_signing_key(account)
@@ -35,6 +35,7 @@ class SigScheme(IntEnum):
     SECP256K1     = 0x01
     SECP256R1     = 0x02
     BIP32_ED25519 = 0x03
+    BLS12_381     = 0x04
     DEFAULT       = ED25519
 
 class BipPath:
@@ -82,6 +83,8 @@ class Signature:
     """Class representing signature."""
 
     GENERIC_SIGNATURE_PREFIX = bytes.fromhex("04822b") # sig(96)
+    COMPACT_SIZE = 64
+    BLS_SIZE = 96
 
     def __init__(self, value: bytes):
         value = Signature.GENERIC_SIGNATURE_PREFIX + value
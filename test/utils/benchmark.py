@@ -0,0 +1,92 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Module providing latency measurements of the app instructions."""
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Any, Callable, Dict, List
+
+import json
+import math
+import time
+
+@dataclass
+class BenchmarkResult:
+    """Class representing the latencies measured for a request."""
+
+    name: str
+    curve: str
+    latencies: List[float] = field(default_factory=list)
+
+    def percentile(self, percent: float) -> float:
+        """Return the latency, in seconds, below which `percent`% of the requests are."""
+        assert self.latencies, "No latency measured"
+        latencies = sorted(self.latencies)
+        rank = math.ceil(percent / 100 * len(latencies)) - 1
+        return latencies[max(rank, 0)]
+
+    @property
+    def p50(self) -> float:
+        """Median latency, in seconds."""
+        return self.percentile(50)
+
+    @property
+    def p99(self) -> float:
+        """99th percentile latency, in seconds."""
+        return self.percentile(99)
+
+    @property
+    def throughput(self) -> float:
+        """Sustained number of requests per second."""
+        total = sum(self.latencies)
+        return len(self.latencies) / total if total > 0 else 0.0
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Return the result as a JSON serializable dictionary."""
+        return {
+            "name": self.name,
+            "curve": self.curve,
+            "iterations": len(self.latencies),
+            "p50_ms": self.p50 * 1000,
+            "p99_ms": self.p99 * 1000,
+            "throughput_per_s": self.throughput,
+        }
+
+def measure(name: str,
+            curve: str,
+            request: Callable[[int], Any],
+            iterations: int) -> BenchmarkResult:
+    """Measure the latency of `iterations` requests.
+
+    The request is given the index of the iteration, so that each
+    baking request can be built for a new level."""
+    result = BenchmarkResult(name, curve)
+    for i in range(iterations):
+        start = time.perf_counter()
+        request(i)
+        result.latencies.append(time.perf_counter() - start)
+    return result
+
+def write_results(results: List[BenchmarkResult],
+                  path: Path,
+                  metadata: Dict[str, Any]) -> None:
+    """Write the results in a JSON file."""
+    data = {
+        **metadata,
+        "results": [result.to_dict() for result in results],
+    }
+    with open(path, 'w', encoding="utf-8") as file:
+        json.dump(data, file, indent=2)
@@ -15,7 +15,7 @@
 
 """Module providing a tezos client."""
 
-from typing import Tuple, Optional, Generator
+from typing import Dict, List, Tuple, Optional, Generator
 from enum import IntEnum
 from contextlib import contextmanager
 
@@ -118,6 +118,25 @@ class Hwm:
 
         return Hwm(highest_level, highest_round)
 
+class HwmState:
+    """Class representing the HWM returned with a signature."""
+
+    HAD_ATTESTATION    = 0x01
+    HAD_PREATTESTATION = 0x02
+
+    def __init__(self, hwm: Hwm, flags: int, slot: int):
+        self.hwm = hwm
+        self.had_attestation = (flags & HwmState.HAD_ATTESTATION) != 0
+        self.had_preattestation = (flags & HwmState.HAD_PREATTESTATION) != 0
+        self.slot = slot
+
+    def __repr__(self) -> str :
+        return f"(HWM={self.hwm}, " \
+            f"Attestation={self.had_attestation}, " \
+            f"Preattestation={self.had_preattestation}, " \
+            f"Slot=0x{self.slot:02x})"
+
+
 class Cla(IntEnum):
     """Class representing APDU class."""
 
@@ -143,14 +162,47 @@ class Ins(IntEnum):
     RESET                     = 0x06
     SETUP                     = 0x0a
     SIGN_WITH_HASH            = 0x0f
+    SIGN_BATCH                = 0x10
+    QUERY_NVRAM_STATS         = 0x11
+    QUERY_PERF                = 0x12
+    QUERY_HWM_TABLE           = 0x13
+    QUERY_SNAPSHOT            = 0x14
+    PROMPT_RESULT             = 0x15
+    CHECK_AUTHORIZATION       = 0x16
+    GET_PROOF_OF_POSSESSION   = 0x17
+    EXPORT_HWM                = 0x18
+    IMPORT_HWM                = 0x19
+    SIGN_PIPELINED            = 0x1a
 
 
 class Index(IntEnum):
     """Class representing packet index."""
 
-    FIRST = 0x00
-    OTHER = 0x01
-    LAST  = 0x81
+    FIRST         = 0x00
+    OTHER         = 0x01
+    LAST          = 0x81
+    WITH_KEY_LAST = 0x82
+    FIRST_LAST    = 0x80
+    FETCH         = 0x03
+    ASYNC_PROMPT  = 0x40
+
+
+class SignFlag(IntEnum):
+    """Class representing the signature response flags."""
+
+    NONE              = 0x00
+    WITH_HOST_HWM     = 0x04
+    WITH_ACK          = 0x08
+    COMPACT_SIGNATURE = 0x10
+    WITH_HWM          = 0x20
+
+
+class BakingType(IntEnum):
+    """Class representing the type of baking message."""
+
+    BLOCK          = 0x00
+    ATTESTATION    = 0x01
+    PREATTESTATION = 0x02
 
 
 class StatusCode(IntEnum):
@@ -169,6 +221,8 @@ class StatusCode(IntEnum):
     HID_REQUIRED              = 0x6983
     CLASS                     = 0x6e00
     MEMORY_ERROR              = 0x9200
+    PROMPT_PENDING            = 0x9101
+    STALE_LEVEL_ROUND         = 0x9102
 
     @contextmanager
     def expected(self) -> Generator[None, None, None]:
@@ -216,10 +270,40 @@ class TezosClient:
 
         return rapdu.data
 
+    def _send_message(self, ins: Ins, message: bytes, flags: int = SignFlag.NONE) -> bytes:
+        """Send a message in as many packets as needed.
+
+        The flags are set on the last packet."""
+
+        packets = [message[i:i + MAX_APDU_SIZE]
+                   for i in range(0, len(message), MAX_APDU_SIZE)] or [b'']
+
+        for packet in packets[:-1]:
+            self._exchange(ins=ins, index=Index.OTHER, payload=packet)
+
+        return self._exchange(ins=ins, index=Index.LAST | flags, payload=packets[-1])
+
     def version(self) -> Version:
         """Send the VERSION instruction."""
         return Version.from_bytes(self._exchange(ins=Ins.VERSION))
 
+    def capabilities(self) -> Tuple[Version, Dict[int, bytes]]:
+        """Send the VERSION instruction requesting the capabilities.
+
+        Returns the version and the capabilities by tag."""
+        data = self._exchange(ins=Ins.VERSION, index=Index.OTHER)
+
+        reader = BytesReader(data)
+        version = Version.from_bytes(reader.read_bytes(4))
+        format_version = reader.read_int(1)
+        assert format_version == 0x01, f"Unknown capabilities format {format_version}"
+        capabilities: Dict[int, bytes] = {}
+        while not reader.has_finished():
+            tag = reader.read_int(1)
+            capabilities[tag] = reader.read_bytes(reader.read_int(1))
+
+        return (version, capabilities)
+
     def git(self) -> str:
         """Send the GIT instruction."""
         raw_commit = self._exchange(ins=Ins.GIT)
@@ -242,6 +326,15 @@ class TezosClient:
             sig_scheme=sig_scheme,
             payload=payload)
 
+    def authorize_companion_key(self, account: Account) -> bytes:
+        """Send the AUTHORIZE_BAKING instruction for a companion key."""
+
+        return self._exchange(
+            ins=Ins.AUTHORIZE_BAKING,
+            index=Index.OTHER,
+            sig_scheme=account.sig_scheme,
+            payload=bytes(account.path))
+
     def deauthorize(self) -> None:
         """Send the DEAUTHORIZE instruction."""
         data = self._exchange(ins=Ins.DEAUTHORIZE)
@@ -273,27 +366,62 @@ class TezosClient:
             sig_scheme=account.sig_scheme,
             payload=bytes(account.path))
 
-    def reset_app_context(self, reset_level: int) -> None:
-        """Send the RESET instruction."""
+    def get_proof_of_possession(self) -> Tuple[bytes, bytes]:
+        """Send the GET_PROOF_OF_POSSESSION instruction.
+
+        Returns the public key of the authorized key and its proof of possession."""
+        data = self._exchange(ins=Ins.GET_PROOF_OF_POSSESSION)
+
+        reader = BytesReader(data)
+        public_key = reader.read_bytes(reader.read_int(1))
+        proof = reader.read_bytes(Signature.BLS_SIZE)
+        reader.assert_finished()
+
+        return (public_key, proof)
+
+    def export_hwm(self) -> bytes:
+        """Send the EXPORT_HWM instruction.
+
+        Returns the authenticated export of the HWM of the authorized key."""
+        return self._exchange(ins=Ins.EXPORT_HWM)
+
+    def import_hwm(self, export: bytes) -> None:
+        """Send the IMPORT_HWM instruction."""
+        self._exchange(ins=Ins.IMPORT_HWM, payload=export)
+
+    def reset_app_context(self, reset_level: int, async_prompt: bool = False) -> None:
+        """Send the RESET instruction.
+
+        With async_prompt, the response must be fetched with get_prompt_result."""
         reset_level_raw = reset_level.to_bytes(4, byteorder='big')
         data = self._exchange(
             ins=Ins.RESET,
+            index=Index.ASYNC_PROMPT if async_prompt else Index.FIRST,
             payload=reset_level_raw)
         assert data == b'', f"No data expected but got {data.hex()}"
 
+    def get_prompt_result(self) -> bytes:
+        """Send the PROMPT_RESULT instruction."""
+        return self._exchange(ins=Ins.PROMPT_RESULT)
+
 
     def setup_app_context(self,
                           account: Account,
                           main_chain_id: str,
                           main_hwm: Hwm,
-                          test_hwm: Hwm) -> bytes:
-        """Send the SETUP instruction."""
+                          test_hwm: Hwm,
+                          hwm_level_only: bool = False) -> bytes:
+        """Send the SETUP instruction.
+
+        With hwm_level_only, the HWM will only track levels."""
 
         data: bytes = b''
         data += forge.forge_base58(main_chain_id)
         data += bytes(main_hwm)
         data += bytes(test_hwm)
         data += bytes(account.path)
+        if hwm_level_only:
+            data += b'\x01'
 
         return self._exchange(
             ins=Ins.SETUP,
@@ -320,23 +448,214 @@ class TezosClient:
 
         return (main_chain_id, main_hwm, test_hwm)
 
+    def check_authorization(self,
+                            account: Optional[Account],
+                            checks: List[Tuple[str, int, int, BakingType]]) -> List[bool]:
+        """Send the CHECK_AUTHORIZATION instruction.
+
+        Each check is a chain id, a level, a round and a baking type.
+        Use no account to check the authorized key.
+        Returns if each check would be signed."""
+
+        data: bytes = b'\x00' if account is None else bytes(account.path)
+        for (chain_id, level, current_round, baking_type) in checks:
+            data += forge.forge_base58(chain_id)
+            data += level.to_bytes(4, 'big')
+            data += current_round.to_bytes(4, 'big')
+            data += baking_type.to_bytes(1, 'big')
+
+        raw_data = self._exchange(
+            ins=Ins.CHECK_AUTHORIZATION,
+            sig_scheme=SigScheme.DEFAULT if account is None else account.sig_scheme,
+            payload=data)
+
+        reader = BytesReader(raw_data)
+        results = [reader.read_int(1) == 0x00 for _ in checks]
+        reader.assert_finished()
+
+        return results
+
+    def get_hwm_table(self) -> List[Tuple[str, Hwm]]:
+        """Send the QUERY_HWM_TABLE instruction."""
+        raw_data = self._exchange(ins=Ins.QUERY_HWM_TABLE)
+
+        reader = BytesReader(raw_data)
+        hwm_table = []
+        for _ in range(reader.read_int(1)):
+            chain_id = forge.unforge_chain_id(reader.read_bytes(4))
+            hwm = Hwm.from_bytes(reader.read_bytes(Hwm.raw_length(migrated=True)))
+            hwm_table.append((chain_id, hwm))
+        reader.assert_finished()
+
+        return hwm_table
+
+    SNAPSHOT_PAGE_SIZE = 200
+
+    def get_snapshot(self) -> Tuple[int, List[Tuple[int, bytes]]]:
+        """Send the QUERY_SNAPSHOT instruction until the last page.
+
+        Returns the format version and the TLV entries."""
+        raw_data = b''
+        page_index = 0
+        while True:
+            rapdu: RAPDU = self.backend.exchange(Cla.DEFAULT,
+                                                 Ins.QUERY_SNAPSHOT,
+                                                 p1=page_index)
+            if rapdu.status != StatusCode.OK:
+                raise ExceptionRAPDU(rapdu.status, rapdu.data)
+            raw_data += rapdu.data
+            page_index += 1
+            if len(rapdu.data) < self.SNAPSHOT_PAGE_SIZE:
+                break
+
+        reader = BytesReader(raw_data)
+        format_version = reader.read_int(1)
+        entries = []
+        while not reader.has_finished():
+            tag = reader.read_int(1)
+            entries.append((tag, reader.read_bytes(reader.read_int(1))))
+
+        return (format_version, entries)
+
+    def get_nvram_stats(self) -> Tuple[int, int]:
+        """Send the QUERY_NVRAM_STATS instruction."""
+        raw_data = self._exchange(ins=Ins.QUERY_NVRAM_STATS)
+
+        reader = BytesReader(raw_data)
+        performed_writes = reader.read_int(4)
+        skipped_writes = reader.read_int(4)
+        reader.assert_finished()
+
+        return (performed_writes, skipped_writes)
+
+    def get_perf_counters(self, reset: bool = False) -> Tuple[List[int], List[Tuple[int, int]]]:
+        """Send the QUERY_PERF instruction.
+
+        Returns the number of calls per instruction and, per phase,
+        the number of runs and of processed bytes."""
+        raw_data = self._exchange(ins=Ins.QUERY_PERF,
+                                  index=Index.OTHER if reset else Index.FIRST)
+
+        reader = BytesReader(raw_data)
+        instructions = [reader.read_int(4) for _ in range(reader.read_int(1))]
+        phases = [(reader.read_int(4), reader.read_int(4)) for _ in range(reader.read_int(1))]
+        reader.assert_finished()
+
+        return (instructions, phases)
+
+    def select_signing_key(self, account: Account, flags: int = SignFlag.NONE) -> None:
+        """Send the first packet of the SIGN instruction."""
+        data = self._exchange(
+            ins=Ins.SIGN,
+            index=Index.FIRST | flags,
+            sig_scheme=account.sig_scheme,
+            payload=bytes(account.path))
+        assert data == b'', f"No data expected but got {data.hex()}"
+
+    def sign_selected_message(self,
+                              account: Account,
+                              message: Message) -> Signature:
+        """Send the other packets of the SIGN instruction."""
+
+        signature = self._send_message(Ins.SIGN, bytes(message))
+
+        return Signature.from_bytes(signature, account.sig_scheme)
+
     def sign_message(self,
                      account: Account,
                      message: Message) -> Signature:
         """Send the SIGN instruction."""
 
-        self._exchange(
+        self.select_signing_key(account)
+
+        return self.sign_selected_message(account, message)
+
+    def sign_message_with_ack(self,
+                              account: Account,
+                              message: Message,
+                              packet_size: int = MAX_APDU_SIZE) \
+                              -> Tuple[List[Tuple[int, int]], bytes]:
+        """Send the SIGN instruction with the intermediate packets acknowledged.
+
+        Returns the acknowledgements, as the packet index and the number
+        of bytes received, and the raw signature."""
+
+        self.select_signing_key(account)
+
+        raw_message = bytes(message)
+        packets = [raw_message[i:i + packet_size]
+                   for i in range(0, len(raw_message), packet_size)] or [b'']
+
+        acks = []
+        for packet in packets[:-1]:
+            reader = BytesReader(self._exchange(ins=Ins.SIGN,
+                                                index=Index.OTHER | SignFlag.WITH_ACK,
+                                                payload=packet))
+            acks.append((reader.read_int(1), reader.read_int(4)))
+            reader.assert_finished()
+
+        signature = self._exchange(ins=Ins.SIGN, index=Index.LAST, payload=packets[-1])
+
+        return (acks, signature)
+
+    def sign_message_with_key(self,
+                              account: Account,
+                              message: Message,
+                              use_authorized_key: bool = False) -> Signature:
+        """Send the SIGN instruction with the key and the message in a single apdu."""
+
+        path = b'\x00' if use_authorized_key else bytes(account.path)
+
+        signature = self._exchange(
             ins=Ins.SIGN,
+            index=Index.WITH_KEY_LAST,
             sig_scheme=account.sig_scheme,
-            payload=bytes(account.path))
+            payload=path + bytes(message))
+
+        return Signature.from_bytes(signature, account.sig_scheme)
+
+    def sign_message_with_host_hwm(self,
+                                   account: Account,
+                                   message: Message,
+                                   host_hwm: Hwm,
+                                   flags: int = 0) -> Signature:
+        """Send the SIGN instruction with the key, the HWM of the host and the message
+        in a single apdu."""
+
+        raw_host_hwm = host_hwm.highest_level.to_bytes(4, 'big') + \
+            host_hwm.highest_round.to_bytes(4, 'big') + \
+            bytes([flags])
 
         signature = self._exchange(
             ins=Ins.SIGN,
-            index=Index.LAST,
-            payload=bytes(message))
+            index=Index.WITH_KEY_LAST | SignFlag.WITH_HOST_HWM,
+            sig_scheme=account.sig_scheme,
+            payload=bytes(account.path) + raw_host_hwm + bytes(message))
 
         return Signature.from_bytes(signature, account.sig_scheme)
 
+    def sign_message_compact(self,
+                             account: Account,
+                             message: Message,
+                             with_hwm: bool = False) -> Tuple[Signature, Optional[HwmState]]:
+        """Send the SIGN instruction requesting a compact signature.
+
+        Returns the signature and, if requested, the updated HWM state."""
+
+        self.select_signing_key(account)
+
+        flags = SignFlag.COMPACT_SIGNATURE | (SignFlag.WITH_HWM if with_hwm else SignFlag.NONE)
+        data = self._send_message(Ins.SIGN, bytes(message), flags)
+
+        reader = BytesReader(data)
+        signature = Signature(reader.read_bytes(Signature.COMPACT_SIZE))
+        hwm = HwmState(Hwm(reader.read_int(4), reader.read_int(4)),
+                       reader.read_int(1),
+                       reader.read_int(1)) if with_hwm else None
+        reader.assert_finished()
+
+        return (signature, hwm)
+
     def sign_message_with_hash(self,
                      account: Account,
                      message: Message) -> Tuple[bytes, Signature]:
@@ -347,10 +666,7 @@ class TezosClient:
             sig_scheme=account.sig_scheme,
             payload=bytes(account.path))
 
-        data = self._exchange(
-            ins=Ins.SIGN_WITH_HASH,
-            index=Index.LAST,
-            payload=bytes(message))
+        data = self._send_message(Ins.SIGN_WITH_HASH, bytes(message))
 
         return (
             data[:Message.HASH_SIZE],
@@ -360,6 +676,82 @@ class TezosClient:
             )
         )
 
+    def sign_batch(self,
+                   account: Account,
+                   messages: List[Message]) -> List[Signature]:
+        """Send the SIGN_BATCH instruction."""
+
+        # Split the batch on message boundaries
+        packets: List[bytes] = []
+        packet: bytes = b''
+        for message in messages:
+            raw_message = bytes(message)
+            item = len(raw_message).to_bytes(1, 'big') + raw_message
+            if len(packet) + len(item) > MAX_APDU_SIZE:
+                packets.append(packet)
+                packet = b''
+            packet += item
+        packets.append(packet)
+
+        data: bytes = b''
+        for i, packet in enumerate(packets):
+            index = Index.FIRST if i == 0 else Index.OTHER
+            if i == len(packets) - 1:
+                index = Index(index | 0x80)
+            data = self._exchange(
+                ins=Ins.SIGN_BATCH,
+                index=index,
+                payload=packet)
+
+        signatures: List[Signature] = []
+        while True:
+            reader = BytesReader(data)
+            while reader.remaining_size() > 0:
+                size = reader.read_int(1)
+                signatures.append(
+                    Signature.from_bytes(reader.read_bytes(size), account.sig_scheme))
+            if len(signatures) >= len(messages):
+                break
+            data = self._exchange(ins=Ins.SIGN_BATCH, index=Index.FETCH)
+
+        return signatures
+
+    def sign_batch_packet(self,
+                          messages: List[Message],
+                          index: Index) -> bytes:
+        """Send a single packet of the SIGN_BATCH instruction."""
+        payload = b''.join(
+            len(bytes(message)).to_bytes(1, 'big') + bytes(message)
+            for message in messages
+        )
+        return self._exchange(ins=Ins.SIGN_BATCH, index=index, payload=payload)
+
+    def sign_pipelined_packet(self,
+                              index: Index,
+                              message: Optional[Message] = None) -> bytes:
+        """Send one packet of the SIGN_PIPELINED instruction."""
+        payload = b'' if message is None else bytes(message)
+        return self._exchange(ins=Ins.SIGN_PIPELINED, index=index, payload=payload)
+
+    def sign_pipelined(self,
+                       account: Account,
+                       messages: List[Message]) -> List[Signature]:
+        """Send the SIGN_PIPELINED instruction.
+
+        Each message is answered with the signature of the previous
+        one, the signature of the last message is fetched."""
+
+        signatures: List[Signature] = []
+        for i, message in enumerate(messages):
+            data = self.sign_pipelined_packet(Index.FIRST if i == 0 else Index.OTHER, message)
+            if data:
+                signatures.append(Signature.from_bytes(data, account.sig_scheme))
+
+        data = self.sign_pipelined_packet(Index.FETCH)
+        signatures.append(Signature.from_bytes(data, account.sig_scheme))
+
+        return signatures
+
     def hmac(self,
              account: Account,
              message: bytes) -> bytes:
@@ -373,3 +765,38 @@ class TezosClient:
             ins=Ins.HMAC,
             sig_scheme=account.sig_scheme,
             payload=data)
+
+
+class BackendTransport:
+    """Class representing a transport of the host client over a backend."""
+
+    backend: BackendInterface
+
+    def __init__(self, backend: BackendInterface) -> None:
+        self.backend = backend
+
+    def exchange(self, cla: int, ins: int, p1: int, p2: int, data: bytes) -> Tuple[int, bytes]:
+        """Send an APDU and return the status word and the response data."""
+        try:
+            rapdu: RAPDU = self.backend.exchange(cla, ins, p1=p1, p2=p2, data=data)
+        except ExceptionRAPDU as e:
+            return (e.status, e.data)
+        return (rapdu.status, rapdu.data)
+
+    def close(self) -> None:
+        """The backend is closed by the tests."""
+
+
+class LegacyTransport(BackendTransport):
+    """Class representing a transport to an app that only knows the older instructions."""
+
+    def exchange(self, cla: int, ins: int, p1: int, p2: int, data: bytes) -> Tuple[int, bytes]:
+        """Refuse the newer instructions as an older app would."""
+        if ins == Ins.VERSION and p1 != Index.FIRST:
+            return (StatusCode.WRONG_PARAM, b'')
+        if ins in (Ins.SIGN_BATCH, Ins.QUERY_SNAPSHOT):
+            return (StatusCode.INVALID_INS, b'')
+        flags = Index.FIRST_LAST | SignFlag.COMPACT_SIGNATURE | SignFlag.WITH_HWM
+        if ins == Ins.SIGN and (p1 & ~flags) == (Index.WITH_KEY_LAST & ~flags):
+            return (StatusCode.WRONG_PARAM, b'')
+        return super().exchange(cla, ins, p1, p2, data)
@@ -36,12 +36,13 @@ from ragger.firmware.touch.positions import Position
 from ragger.navigator import Navigator, NavInsID, NavIns
 
 from common import TESTS_ROOT_DIR, EMPTY_PATH
-from utils.client import TezosClient, Hwm
+from utils.client import TezosClient, Hwm, Ins
 from utils.account import Account, Signature
 from utils.message import (
     Delegation,
     DEFAULT_BLOCK_HASH
 )
+from utils.replay import TraceEntry, exchange_entry
 
 RESPONSE = TypeVar('RESPONSE')
 
@@ -368,6 +369,18 @@ class TezosNavigator(metaclass=MetaScreen):
             navigate=lambda: navigate(**kwargs)
         )
 
+    def authorize_companion_key(self,
+                                account: Account,
+                                navigate: Optional[Callable] = None,
+                                **kwargs) -> bytes:
+        """Send an authorize companion key request and navigate until accept"""
+        if navigate is None:
+            navigate = self.accept_key_navigate
+        return send_and_navigate(
+            send=lambda: self.client.authorize_companion_key(account),
+            navigate=lambda: navigate(**kwargs)
+        )
+
     def get_public_key_prompt(self,
                               account: Account,
                               navigate: Optional[Callable] = None,
@@ -438,6 +451,7 @@ class TezosNavigator(metaclass=MetaScreen):
                           main_hwm: Hwm,
                           test_hwm: Hwm,
                           navigate: Optional[Callable] = None,
+                          hwm_level_only: bool = False,
                           **kwargs) -> bytes:
         """Send a setup request and navigate until accept"""
         if navigate is None:
@@ -447,11 +461,26 @@ class TezosNavigator(metaclass=MetaScreen):
                 account,
                 main_chain_id,
                 main_hwm,
-                test_hwm
+                test_hwm,
+                hwm_level_only
             ),
             navigate=lambda: navigate(**kwargs)
         )
 
+    def replay_prompt(self, entry: TraceEntry, **kwargs) -> int:
+        """Send a prompting request of a trace and navigate until accept"""
+        navigates = {
+            Ins.AUTHORIZE_BAKING: self.accept_key_navigate,
+            Ins.PROMPT_PUBLIC_KEY: self.accept_key_navigate,
+            Ins.RESET: self.accept_reset_navigate,
+            Ins.SETUP: self.accept_setup_navigate,
+        }
+        navigate = navigates[Ins(entry.ins)]
+        return send_and_navigate(
+            send=lambda: exchange_entry(self.client, entry),
+            navigate=lambda: navigate(**kwargs)
+        )
+
     def accept_sign_navigate(self, **kwargs):
         """Navigate until accept signing"""
         if self.firmware.is_nano:
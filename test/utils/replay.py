@@ -0,0 +1,286 @@
+# Copyright 2024 Functori <contact@functori.com>
+# Copyright 2024 Trilitech <contact@trili.tech>
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#     http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Module providing the capture and the replay of the APDU traffic of a baker.
+
+A trace is a JSON Lines file, one APDU per line:
+
+    {"time": 0.512, "ins": 4, "p1": 129, "p2": 0, "data": "13...", "status": 36864}
+
+`time` is the time, in seconds, at which the APDU was sent since the
+start of the capture, and `status` the status word it was answered
+with, if known.
+"""
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Any, Callable, Dict, List, Optional
+
+import json
+import time
+
+from ragger.error import ExceptionRAPDU
+from utils.benchmark import BenchmarkResult
+from utils.client import TezosClient, Ins, Index, StatusCode
+
+# Instructions waiting for the user, they cannot be replayed unattended
+PROMPT_INSTRUCTIONS = {
+    Ins.AUTHORIZE_BAKING,
+    Ins.PROMPT_PUBLIC_KEY,
+    Ins.RESET,
+    Ins.SETUP,
+}
+
+# Instructions whose request is sent in several packets
+PACKET_INSTRUCTIONS = {
+    Ins.SIGN,
+    Ins.SIGN_WITH_HASH,
+    Ins.SIGN_BATCH,
+}
+
+# Instructions of which the queueing and service times are reported
+SIGN_INSTRUCTIONS = PACKET_INSTRUCTIONS | {Ins.SIGN_PIPELINED}
+
+LAST_PACKET_MARKER = 0x80
+
+
+@dataclass
+class TraceEntry:
+    """Class representing an APDU of a trace."""
+
+    time: float
+    ins: int
+    p1: int
+    p2: int
+    data: bytes = b''
+    status: Optional[int] = None
+
+    @property
+    def ends_request(self) -> bool:
+        """Whether the APDU is the last packet of its request."""
+        if self.ins not in PACKET_INSTRUCTIONS:
+            return True
+        return (self.p1 & LAST_PACKET_MARKER) != 0 or self.p1 == Index.FETCH
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Return the entry as a JSON serializable dictionary."""
+        entry: Dict[str, Any] = {
+            "time": self.time,
+            "ins": self.ins,
+            "p1": self.p1,
+            "p2": self.p2,
+            "data": self.data.hex(),
+        }
+        if self.status is not None:
+            entry["status"] = self.status
+        return entry
+
+    @classmethod
+    def from_dict(cls, entry: Dict[str, Any]) -> 'TraceEntry':
+        """Get an entry from its JSON representation."""
+        return cls(
+            time=float(entry["time"]),
+            ins=int(entry["ins"]),
+            p1=int(entry["p1"]),
+            p2=int(entry["p2"]),
+            data=bytes.fromhex(entry.get("data", "")),
+            status=entry.get("status"),
+        )
+
+
+def read_trace(path: Path) -> List[TraceEntry]:
+    """Read a trace from a JSON Lines file."""
+    with open(path, 'r', encoding="utf-8") as file:
+        return [TraceEntry.from_dict(json.loads(line)) for line in file if line.strip()]
+
+
+def write_trace(path: Path, entries: List[TraceEntry]) -> None:
+    """Write a trace in a JSON Lines file."""
+    with open(path, 'w', encoding="utf-8") as file:
+        for entry in entries:
+            file.write(json.dumps(entry.to_dict()) + "\n")
+
+
+def exchange_entry(client: TezosClient, entry: TraceEntry) -> int:
+    """Send the APDU of an entry and return the status word of its response."""
+    try:
+        # pylint: disable=protected-access
+        client._exchange(ins=entry.ins,        # type: ignore[arg-type]
+                         index=entry.p1,       # type: ignore[arg-type]
+                         sig_scheme=entry.p2,  # type: ignore[arg-type]
+                         payload=entry.data)
+        return StatusCode.OK
+    except ExceptionRAPDU as e:
+        return e.status
+
+
+class TraceRecorder:
+    """Class recording the APDUs sent by a client.
+
+    Used as a context manager, every APDU sent by the client through
+    `_exchange` in the context is recorded."""
+
+    def __init__(self, client: TezosClient):
+        self.client = client
+        self.entries: List[TraceEntry] = []
+        self._start: float = 0.0
+
+    def __enter__(self) -> 'TraceRecorder':
+        self._start = time.perf_counter()
+        exchange = self.client._exchange  # pylint: disable=protected-access
+
+        def recorded_exchange(ins, index=Index.FIRST, sig_scheme=0, payload=b''):
+            entry = TraceEntry(time=time.perf_counter() - self._start,
+                               ins=int(ins),
+                               p1=int(index),
+                               p2=int(sig_scheme),
+                               data=bytes(payload))
+            self.entries.append(entry)
+            try:
+                data = exchange(ins, index, sig_scheme, payload)
+            except ExceptionRAPDU as e:
+                entry.status = e.status
+                raise
+            entry.status = StatusCode.OK
+            return data
+
+        self.client._exchange = recorded_exchange  # type: ignore[method-assign]
+        return self
+
+    def __exit__(self, *args) -> None:
+        del self.client._exchange
+
+    def write(self, path: Path) -> None:
+        """Write the recorded trace in a JSON Lines file."""
+        write_trace(path, self.entries)
+
+
+@dataclass
+class RequestTiming:
+    """Class representing the timing of a replayed request.
+
+    A request gathers all the packets of a message."""
+
+    ins: int
+    time: float
+    queueing: float
+    service: float
+    status: int
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Return the timing as a JSON serializable dictionary."""
+        return {
+            "ins": self.ins,
+            "time": self.time,
+            "queueing_ms": self.queueing * 1000,
+            "service_ms": self.service * 1000,
+            "status": self.status,
+        }
+
+
+@dataclass
+class ReplayReport:
+    """Class representing the result of a replay."""
+
+    requests: List[RequestTiming] = field(default_factory=list)
+    skipped: int = 0
+
+    @property
+    def signatures(self) -> List[RequestTiming]:
+        """Timings of the signing requests."""
+        return [request for request in self.requests if request.ins in SIGN_INSTRUCTIONS]
+
+    @property
+    def queueing(self) -> BenchmarkResult:
+        """Queueing times of the signing requests.
+
+        The queueing time is the delay between the time a request was
+        sent in the trace and the time it is sent during the replay,
+        while the previous requests are being served."""
+        return BenchmarkResult("replay_queueing", "trace",
+                               [request.queueing for request in self.signatures])
+
+    @property
+    def service(self) -> BenchmarkResult:
+        """Service times of the signing requests.
+
+        The service time runs from the sending of the first packet of a
+        request to the response of its last packet."""
+        return BenchmarkResult("replay_service", "trace",
+                               [request.service for request in self.signatures])
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Return the report as a JSON serializable dictionary."""
+        report: Dict[str, Any] = {
+            "requests": len(self.requests),
+            "skipped": self.skipped,
+            "signatures": [request.to_dict() for request in self.signatures],
+        }
+        if self.signatures:
+            report["queueing"] = self.queueing.to_dict()
+            report["service"] = self.service.to_dict()
+        return report
+
+
+def replay(client: TezosClient,
+           entries: List[TraceEntry],
+           speed: float = 1.0,
+           on_prompt: Optional[Callable[[TraceEntry], Any]] = None) -> ReplayReport:
+    """Replay a trace, preserving the inter-arrival times of its APDUs.
+
+    Each APDU is sent at its time in the trace, divided by `speed`, or
+    as soon as the previous one is answered if it is late.
+
+    The instructions of `PROMPT_INSTRUCTIONS` are handed to `on_prompt`,
+    which must send them and navigate, and are not timed. They are
+    skipped if `on_prompt` is not given."""
+    report = ReplayReport()
+    start = time.perf_counter()
+    request_scheduled: Optional[float] = None
+    request_sent: float = 0.0
+
+    for entry in entries:
+        if entry.ins in PROMPT_INSTRUCTIONS:
+            if on_prompt is None:
+                report.skipped += 1
+            else:
+                on_prompt(entry)
+                # The time spent by the user is not part of the traffic
+                start = time.perf_counter() - entry.time / speed
+            continue
+
+        scheduled = start + entry.time / speed
+        delay = scheduled - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+
+        sent = time.perf_counter()
+        status = exchange_entry(client, entry)
+        done = time.perf_counter()
+
+        if request_scheduled is None:
+            request_scheduled = scheduled
+            request_sent = sent
+
+        if entry.ends_request or status != StatusCode.OK:
+            report.requests.append(RequestTiming(
+                ins=entry.ins,
+                time=entry.time,
+                queueing=max(request_sent - request_scheduled, 0.0),
+                service=done - request_sent,
+                status=status))
+            request_scheduled = None
+
+    return report